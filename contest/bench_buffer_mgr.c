@@ -0,0 +1,482 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "storage_mgr_backend.h"
+#include "test_helper.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// var to store the current test's name
+char *testName;
+
+#define BENCH_FILE "bench_buffer.bin"
+// the same database kept by the in-memory backend, no file system under the pool
+#define BENCH_MEM_FILE "mem:bench_buffer.bin"
+#define NUM_PINS 1000000
+
+// "large database + small buffer": the file is far bigger than the pool so
+// nearly every pin is a miss that goes to the storage manager
+#define LARGE_DB_PAGES 25600
+#define SMALL_POOL_PAGES 100
+#define LARGE_DB_PINS 100000
+
+// the large database again, behind the simulated disk
+#define BENCH_SIM_FILE "sim:bench_buffer.bin"
+
+// scans mixed with a hot working set smaller than the pool: SCAN_ROUNDS rounds of
+// HOT_PINS random pins over HOT_PAGES pages, then a scan of SCAN_PAGES pages
+#define HOT_PAGES 60
+#define HOT_PINS 1000
+#define SCAN_PAGES 2000
+#define SCAN_ROUNDS 10
+
+// the page accesses of the contest workloads (contest.c) replayed against the
+// pool: a table of records at CONTEST_SLOTS_PER_PAGE per page (about what
+// record_mgr fits of the contest schema) after its header page. Every
+// scanFreq-th request on average is a scan of every table page. Of the others
+// percInserts% insert into the last page, percDeletes% delete from a random
+// page and the rest are point lookups, which read one random page.
+#define BENCH_CONTEST_FILE "mem:bench_contest.bin"
+#define CONTEST_SLOTS_PER_PAGE 200
+
+// insert-like workload: every pin is a new page past the end of the file
+#define APPEND_PAGES 50000
+
+// threads pinning random pages of THREAD_PAGES pages through a pool of
+// THREAD_POOL_PAGES frames (split into partitions), THREAD_PINS pins each
+#define THREAD_POOL_PAGES 1024
+#define THREAD_PAGES 2048
+#define THREAD_PINS 200000
+#define MAX_THREADS 8
+
+// names by ReplacementStrategy
+static const char *strategyNames[] = { "FIFO", "LRU", "CLOCK", "LFU", "LRU-K", "GCLOCK", "ARC", "ADAPTIVE" };
+
+// benchmark methods
+static void benchPinLatency (int numPages, ReplacementStrategy strategy);
+static void benchIOMode (char *fileName, SM_IOMode ioMode);
+static void benchAppend (int extentPages, SM_ExtentMode extentMode);
+static void benchReadahead (char *fileName, int raPages);
+static void benchScanRing (char *fileName, int ringPages);
+static void benchThreads (int numThreads);
+static void benchContest (ReplacementStrategy strategy, int records, int numRequests, int numPages,
+			  int percInserts, int percDeletes, int scanFreq);
+
+// helpers
+static double elapsedNs (struct timespec *start, struct timespec *end);
+static void createLargeDatabase (char *fileName);
+
+// main method
+int
+main (void)
+{
+  int i;
+
+  initStorageManager();
+  testName = "pin latency";
+
+  printf("%-10s %-8s %12s\n", "numPages", "strategy", "ns/pin");
+  benchPinLatency(100, RS_FIFO);
+  benchPinLatency(1000, RS_FIFO);
+  benchPinLatency(10000, RS_FIFO);
+  benchPinLatency(100000, RS_FIFO);
+
+  benchPinLatency(100, RS_LRU);
+  benchPinLatency(1000, RS_LRU);
+  benchPinLatency(10000, RS_LRU);
+  benchPinLatency(100000, RS_LRU);
+
+  benchPinLatency(100, RS_CLOCK);
+  benchPinLatency(1000, RS_CLOCK);
+  benchPinLatency(10000, RS_CLOCK);
+  benchPinLatency(100000, RS_CLOCK);
+
+  testName = "io mode";
+  createLargeDatabase(BENCH_FILE);
+  createLargeDatabase(BENCH_MEM_FILE);
+  printf("\n%-10s %12s %12s %12s\n", "ioMode", "ns/pin", "readIO", "writeIO");
+  benchIOMode(BENCH_FILE, SM_IO_BUFFERED);
+  benchIOMode(BENCH_FILE, SM_IO_DIRECT);
+  benchIOMode(BENCH_FILE, SM_IO_MAPPED);
+  benchIOMode(BENCH_MEM_FILE, SM_IO_BUFFERED);
+
+  testName = "readahead";
+  printf("\n%-10s %-8s %12s %12s %12s %12s\n", "disk", "window", "ns/pin", "readIO", "prefetched", "unused");
+  benchReadahead(BENCH_FILE, 0);
+  benchReadahead(BENCH_FILE, 8);
+  benchReadahead(BENCH_FILE, 32);
+  CHECK(setDiskProfile(SM_DISK_SSD));
+  benchReadahead(BENCH_SIM_FILE, 0);
+  benchReadahead(BENCH_SIM_FILE, 8);
+  benchReadahead(BENCH_SIM_FILE, 32);
+
+  testName = "scan ring";
+  printf("\n%-10s %-8s %12s %12s\n", "disk", "ring", "ns/pin", "hotReadIO");
+  benchScanRing(BENCH_FILE, 0);
+  benchScanRing(BENCH_FILE, 16);
+  benchScanRing(BENCH_SIM_FILE, 0);
+  benchScanRing(BENCH_SIM_FILE, 16);
+
+  testName = "threads";
+  printf("\n%-10s %12s %12s\n", "threads", "pins/sec", "readIO");
+  for (i = 1; i <= MAX_THREADS; i *= 2)
+    benchThreads(i);
+  CHECK(destroyPageFile(BENCH_FILE));
+  CHECK(destroyPageFile(BENCH_MEM_FILE));
+
+  testName = "contest";
+  printf("\n%-8s %-10s %-8s %-6s %-8s %-8s %10s %10s %10s %8s\n", "strategy", "N(R)", "requests", "M",
+	 "updates", "scanFreq", "ns/pin", "readIO", "writeIO", "hit%");
+  for (i = RS_FIFO; i <= RS_ADAPTIVE; i++)
+    {
+      // workload 1 as record_mgr runs it (every request scans) and as meant (lookups, 1 in 10 scans)
+      benchContest(i, 10000, 10000, 20, 0, 0, 1);
+      benchContest(i, 1000000, 100, 100, 0, 0, 1);
+      benchContest(i, 100000, 20000, 100, 0, 0, 10);
+      // workload 2
+      benchContest(i, 10000, 100000, 100, 70, 30, 100);
+      benchContest(i, 1000000, 100000, 100, 70, 30, 10000);
+    }
+
+  testName = "append";
+  printf("\n%-10s %-10s %12s\n", "extent", "mode", "ns/page");
+  benchAppend(1, SM_EXTENT_FALLOCATE);
+  benchAppend(SM_DEFAULT_EXTENT_PAGES, SM_EXTENT_FALLOCATE);
+  benchAppend(SM_DEFAULT_EXTENT_PAGES, SM_EXTENT_SPARSE);
+  benchAppend(1024, SM_EXTENT_FALLOCATE);
+
+  return 0;
+}
+
+// pin every page once so the whole file is resident, then time random pins
+// that all hit in the pool. The per-pin cost should not grow with numPages.
+void
+benchPinLatency (int numPages, ReplacementStrategy strategy)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  struct timespec start, end;
+  int i;
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(initBufferPool(bm, BENCH_FILE, numPages, strategy, NULL));
+
+  for (i = 0; i < numPages; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+
+  srand(0);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < NUM_PINS; i++)
+    {
+      CHECK(pinPage(bm, h, rand() % numPages));
+      CHECK(unpinPage(bm, h));
+    }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  printf("%-10i %-8s %12.1f\n", numPages, strategyNames[strategy],
+	 elapsedNs(&start, &end) / NUM_PINS);
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(BENCH_FILE));
+
+  free(bm);
+  free(h);
+}
+
+// random pins over a file much larger than the pool, every fifth page is
+// dirtied so evictions write back as well
+void
+benchIOMode (char *fileName, SM_IOMode ioMode)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  struct timespec start, end;
+  int i;
+
+  CHECK(initBufferPoolMode(bm, fileName, SMALL_POOL_PAGES, RS_LRU, NULL, ioMode));
+
+  srand(0);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < LARGE_DB_PINS; i++)
+    {
+      CHECK(pinPage(bm, h, rand() % LARGE_DB_PAGES));
+      if (i % 5 == 0)
+	{
+	  h->data[0]++;
+	  CHECK(markDirty(bm, h));
+	}
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(forceFlushPool(bm));
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  printf("%-10s %12.1f %12i %12i\n",
+	 (strncmp(fileName, "mem:", 4) == 0) ? "memory" : (ioMode == SM_IO_BUFFERED) ? "buffered"
+	 : (ioMode == SM_IO_DIRECT) ? "direct" : "mapped",
+	 elapsedNs(&start, &end) / LARGE_DB_PINS, getNumReadIO(bm), getNumWriteIO(bm));
+
+  CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+  free(h);
+}
+
+// a full scan of the large database, every page pinned once in order
+void
+benchReadahead (char *fileName, int raPages)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  struct timespec start, end;
+  int i;
+
+  CHECK(initBufferPool(bm, fileName, SMALL_POOL_PAGES, RS_LRU, NULL));
+  CHECK(setReadahead(bm, raPages));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < LARGE_DB_PAGES; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h));
+    }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  printf("%-10s %-8i %12.1f %12i %12i %12i\n",
+	 (strncmp(fileName, "sim:", 4) == 0) ? "ssd" : "file", raPages,
+	 elapsedNs(&start, &end) / LARGE_DB_PAGES, getNumReadIO(bm),
+	 getNumPrefetched(bm), getNumPrefetchUnused(bm));
+
+  CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+  free(h);
+}
+
+// hot pins and scans taking turns, the scans read through a ring of ringPages
+// frames (0: no ring). hotReadIO counts the hot set's misses, with the ring the
+// hot pages should stay resident across the scans.
+void
+benchScanRing (char *fileName, int ringPages)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  // pins through a ring never started go to the shared pool
+  BM_Ring ring = { 0, 0, NULL };
+  struct timespec start, end;
+  int round, i, before, hotReads = 0;
+
+  CHECK(initBufferPool(bm, fileName, SMALL_POOL_PAGES, RS_LRU, NULL));
+
+  srand(0);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (round = 0; round < SCAN_ROUNDS; round++)
+    {
+      before = getNumReadIO(bm);
+      for (i = 0; i < HOT_PINS; i++)
+	{
+	  CHECK(pinPage(bm, h, rand() % HOT_PAGES));
+	  CHECK(unpinPage(bm, h));
+	}
+      hotReads += getNumReadIO(bm) - before;
+
+      if (ringPages > 0)
+	CHECK(startRingAccess(bm, &ring, ringPages));
+      for (i = 0; i < SCAN_PAGES; i++)
+	{
+	  CHECK(pinPageRing(bm, h, HOT_PAGES + (round * SCAN_PAGES + i) % (LARGE_DB_PAGES - HOT_PAGES), &ring));
+	  CHECK(unpinPage(bm, h));
+	}
+      if (ringPages > 0)
+	CHECK(endRingAccess(bm, &ring));
+    }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  printf("%-10s %-8i %12.1f %12i\n",
+	 (strncmp(fileName, "sim:", 4) == 0) ? "ssd" : "file", ringPages,
+	 elapsedNs(&start, &end) / (SCAN_ROUNDS * (HOT_PINS + SCAN_PAGES)), hotReads);
+
+  CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+  free(h);
+}
+
+// one thread of benchThreads
+static void *
+threadPins (void *arg)
+{
+  BM_BufferPool *bm = (BM_BufferPool *) arg;
+  BM_PageHandle h;
+  unsigned int seed = (unsigned int) (size_t) &h;
+  int i;
+
+  for (i = 0; i < THREAD_PINS; i++)
+    {
+      CHECK(pinPage(bm, &h, rand_r(&seed) % THREAD_PAGES));
+      CHECK(unpinPage(bm, &h));
+    }
+  return NULL;
+}
+
+// numThreads threads sharing one pool over the in-memory database, the pages
+// twice the pool so half the pins miss. Pages of different partitions are
+// pinned without contending for the same latch.
+void
+benchThreads (int numThreads)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  pthread_t threads[MAX_THREADS];
+  struct timespec start, end;
+  int i;
+
+  CHECK(initBufferPool(bm, BENCH_MEM_FILE, THREAD_POOL_PAGES, RS_CLOCK, NULL));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < numThreads; i++)
+    pthread_create(&threads[i], NULL, threadPins, bm);
+  for (i = 0; i < numThreads; i++)
+    pthread_join(threads[i], NULL);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  printf("%-10i %12.0f %12i\n", numThreads,
+	 numThreads * (double) THREAD_PINS * 1e9 / elapsedNs(&start, &end), getNumReadIO(bm));
+
+  CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+}
+
+// the contest workloads with the given strategy on an in-memory file, so the
+// time is the pool's own and the I/O counts are what it would cost on a disk
+void
+benchContest (ReplacementStrategy strategy, int records, int numRequests, int numPages,
+	      int percInserts, int percDeletes, int scanFreq)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  struct timespec start, end;
+  int lastPage = 1 + (records - 1) / CONTEST_SLOTS_PER_PAGE;
+  int lastSlots = records - (lastPage - 1) * CONTEST_SLOTS_PER_PAGE;
+  long pins = 0;
+  int i, j, op;
+
+  CHECK(createPageFile(BENCH_CONTEST_FILE));
+  CHECK(openPageFile(BENCH_CONTEST_FILE, &fh));
+  CHECK(ensureCapacity(lastPage + 1, &fh));
+  CHECK(closePageFile(&fh));
+  CHECK(initBufferPool(bm, BENCH_CONTEST_FILE, numPages, strategy, NULL));
+
+  srand(0);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < numRequests; i++)
+    {
+      if (rand() % scanFreq == 0)
+	{
+	  for (j = 1; j <= lastPage; j++)
+	    {
+	      CHECK(pinPage(bm, h, j));
+	      CHECK(unpinPage(bm, h));
+	    }
+	  pins += lastPage;
+	  continue;
+	}
+      op = rand() % 100;
+      if (op < percInserts)
+	{
+	  if (lastSlots == CONTEST_SLOTS_PER_PAGE)
+	    {
+	      lastPage++;
+	      lastSlots = 0;
+	    }
+	  lastSlots++;
+	  CHECK(pinPage(bm, h, lastPage));
+	}
+      else
+	CHECK(pinPage(bm, h, 1 + rand() % lastPage));
+      if (op < percInserts + percDeletes)
+	CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm, h));
+      pins++;
+    }
+  CHECK(forceFlushPool(bm));
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  printf("%-8s %-10i %-8i %-6i %-8i %-8i %10.1f %10i %10i %8.1f\n", strategyNames[strategy], records,
+	 numRequests, numPages, percInserts + percDeletes, scanFreq, elapsedNs(&start, &end) / pins,
+	 getNumReadIO(bm), getNumWriteIO(bm), 100.0 * (pins - getNumReadIO(bm)) / pins);
+  if (strategy == RS_ADAPTIVE)
+    printf("%-8s ended as %s after %i switches\n", "", strategyNames[getActiveStrategy(bm)],
+	   getNumStrategySwitches(bm));
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(BENCH_CONTEST_FILE));
+
+  free(bm);
+  free(h);
+}
+
+// pins APPEND_PAGES new pages one after the other and dirties each, so the
+// file grows through ensureCapacity on every pin
+void
+benchAppend (int extentPages, SM_ExtentMode extentMode)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  struct timespec start, end;
+  int i;
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(initBufferPool(bm, BENCH_FILE, SMALL_POOL_PAGES, RS_FIFO, NULL));
+  CHECK(setExtentPolicy(((BM_mgmtinfo *) bm->mgmtData)->fh, extentPages, extentMode));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 1; i <= APPEND_PAGES; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      h->data[0] = 1;
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(shutdownBufferPool(bm));
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  printf("%-10i %-10s %12.1f\n", extentPages,
+	 (extentMode == SM_EXTENT_SPARSE) ? "sparse" : "fallocate",
+	 elapsedNs(&start, &end) / APPEND_PAGES);
+
+  CHECK(destroyPageFile(BENCH_FILE));
+  free(bm);
+  free(h);
+}
+
+// writes every page of the large database once so reads hit real blocks
+void
+createLargeDatabase (char *fileName)
+{
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  int i;
+
+  memset(page, 0, PAGE_SIZE);
+  CHECK(createPageFile(fileName));
+  CHECK(openPageFile(fileName, &fh));
+  for (i = 0; i < LARGE_DB_PAGES; i++)
+    {
+      page[1] = (char) i;
+      CHECK(writeBlock(i, &fh, page));
+    }
+  CHECK(closePageFile(&fh));
+}
+
+double
+elapsedNs (struct timespec *start, struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
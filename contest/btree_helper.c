@@ -17,17 +17,50 @@
 #include "btree_mgr.h"
 #include "btree_helper.h"
 
+/* Function to pin a node for writing, its page latch is held exclusively until releaseNode */
+static RC pinNode(BTreeMgmt *tree_mgmt, BM_PageHandle *page, PageNumber page_number) {
+    return pinPageExclusive(&tree_mgmt->bMgr, page, page_number);
+}
+
+/* Function to mark a node pinned by pinNode dirty and drop its latch and pin */
+static RC releaseNode(BTreeMgmt *tree_mgmt, BM_PageHandle *page) {
+    RC return_code = markDirty(&tree_mgmt->bMgr, page);
+    if( return_code != RC_OK )
+        printf("releaseNode mark dirty: ERROR %d\n", return_code);
+    return_code = unlatchPage(&tree_mgmt->bMgr, page);
+    if( return_code != RC_OK )
+        printf("releaseNode unlatch page: ERROR %d\n", return_code);
+    return unpinPage(&tree_mgmt->bMgr, page);
+}
+
 
 /* Function for creating new b tree node */
 static int addBTNode(BTreeHandle *tree) {
     printf("addBTNode ==> START\n");
     BTreeMgmt *hndlMgmtData = (BTreeMgmt*) (tree->mgmtData);
-    BM_mgmtinfo* bmMgmtInfo= (BM_mgmtinfo *)hndlMgmtData->bMgr.mgmtData;
+    BM_PageHandle page_handler;
+    PageNumber page_number;
+    RC return_code;
     hndlMgmtData->nodeCount = hndlMgmtData->nodeCount + 1;
     printf("Total Node Count :%d\n", hndlMgmtData->nodeCount);
     printf("B-Tree Order level :%d\n", hndlMgmtData->bTreeOrder);
+    
+    // a page given back by an earlier merge, or a new one at the end of the file
+    return_code = allocatePoolPage(&hndlMgmtData->bMgr, &page_number);
+    if( return_code != RC_OK)
+        printf("addBTNode allocate page: ERROR %d\n", return_code);
+    
+    // a reused page still holds the merged node, start from an empty one
+    return_code = pinNode(hndlMgmtData, &page_handler, page_number);
+    if( return_code != RC_OK)
+        printf("addBTNode pin page: ERROR %d\n", return_code);
+    fillMemory(page_handler.data, 0, hndlMgmtData->bMgr.pageSize);
+    return_code = releaseNode(hndlMgmtData, &page_handler);
+    if( return_code != RC_OK)
+        printf("addBTNode unpin page: ERROR %d\n", return_code);
+    
     printf("addBTNode ==> END\n");
-    return bmMgmtInfo->fh->totalNumPages-1;
+    return page_number;
 }
 
 /* Function to fill a block of memory */
@@ -46,101 +79,78 @@ int moveMemory(void *destination, void *source, int size){
     return RC_OK;
 }
 
-/* Function to locate key */
-RC locateKey (BTreeHandle *tree, NewNode *temp_nn1, Value *key, int *epislon_value, int *temp_pn2, bool matched){
-    printf("Locate Key: START \n");
-    
-    BM_PageHandle page_handler ;
-    
-    int greater;
-    NewNode *temp_new_node; // n: temp_new_node
-    PageNumber temp_pg_no; // pn1: temp_pg_no
+/* Function to find the leaf a key belongs in */
+RC findLeaf (BTreeHandle *tree, Value *key, PageNumber *leaf, bool *found, long long *ptr){
+    printf("Find Leaf: START \n");
     
-    BTreeMgmt *tree_mgmt = (BTreeMgmt*)tree->mgmtData; // tm: tree_mgmt
-    RC return_code = 0;
-    
-    printf("Locate Key: checking for key \n");
-    if( ! temp_nn1 -> keyNumber )
-        return NULL;
+    BTreeMgmt *tree_mgmt = (BTreeMgmt*)tree->mgmtData;
+    BM_PageHandle page_handler, child_handler;
+    unsigned int version;
+    RC return_code;
     
+    NewNode *temp_nn1;
     Node *temp_node;
-    temp_node = &temp_nn1 -> node;
+    PageNumber child;
+    int counter;
+    int key_number;
+    int max_keys = BT_NODE_KEYS(tree_mgmt->bMgr.pageSize);
+    bool is_leaf;
     
-    int counter = 0;
+    return_code = pinPage(&tree_mgmt->bMgr, &page_handler, tree_mgmt->pageNumber);
+    if( return_code != RC_OK)
+        return return_code;
     
-    while(counter < temp_nn1 -> keyNumber) {
-        
-        // Value smaller check
-        printf("Locate Key value smaller check \n");
-        Value result;
-        valueSmaller(&temp_node[counter].key, key, &result);
-        
-        // Value equals
-        printf("Locate Key value equals check \n");
-        Value equal;
-        valueEquals(&temp_node[counter].key, key, &equal);
-        
-        greater = !result.v.boolV && !equal.v.boolV;
-        
-        if(temp_nn1 -> isLeaf) {
-            if(equal.v.boolV) {
-                *epislon_value = counter;
-                return temp_nn1;
-            }
-            if(greater) {
-                if(matched) {
-                    *epislon_value = counter;
-                    return temp_nn1;
-                }
-                *epislon_value = -1;
-                *temp_pn2 = -1;
-                return NULL;
-            }
-        } else if(greater) {
-            PageNumber page_no = (PageNumber) temp_node[counter].ptr;
-            return_code = pinPage(&tree_mgmt->bMgr, &page_handler, page_no);
-            if( return_code != RC_OK){
-                printf("Locate Key failed ERROR CODE %d\n", return_code);
-            }
-            temp_new_node = (NewNode*)page_handler.data;
-            *temp_pn2 = page_no;
-            temp_nn1 = locateKey(tree, temp_new_node, key, epislon_value, temp_pn2, matched);
-            return_code = unpinPage(&tree_mgmt->bMgr, &page_handler);
+    // every node on the way down is searched without its latch and searched again if a writer
+    // changed it meanwhile. The pin keeps the frame, the child is pinned before the node is let go
+    while(1) {
+        temp_nn1 = (NewNode*) page_handler.data;
+        temp_node = &temp_nn1 -> node;
+        do {
+            return_code = beginOptimisticRead(&tree_mgmt->bMgr, &page_handler, &version);
             if( return_code != RC_OK){
-                printf("Locate Key failed ERROR CODE %d\n", return_code);
+                unpinPage(&tree_mgmt->bMgr, &page_handler);
+                return return_code;
             }
+            key_number = temp_nn1 -> keyNumber;
+            is_leaf = temp_nn1 -> isLeaf;
+            child = temp_nn1 -> pageNumber1;
+            *found = 0;
             
-            return(temp_nn1);
-        }
-        counter++;
-    }
-    
-    if(temp_nn1-> isLeaf) {
-        if(matched) {
-            *epislon_value = counter;
-            return(temp_nn1);
+            // a torn key count must not take the search off the page
+            if( key_number < 0 || key_number > max_keys )
+                key_number = 0;
+            
+            for(counter = 0; counter < key_number; counter++) {
+                Value result;
+                valueSmaller(&temp_node[counter].key, key, &result);
+                Value equal;
+                valueEquals(&temp_node[counter].key, key, &equal);
+                
+                if(is_leaf && equal.v.boolV) {
+                    *found = 1;
+                    *ptr = temp_node[counter].ptr;
+                    break;
+                }
+                if(!result.v.boolV && !equal.v.boolV) {
+                    if(!is_leaf)
+                        child = (PageNumber) temp_node[counter].ptr;
+                    break;
+                }
+            }
+        } while( !validateOptimisticRead(&tree_mgmt->bMgr, &page_handler, version) );
+        
+        if(is_leaf || child < 0) {
+            *leaf = page_handler.pageNum;
+            printf("Find Leaf: COMPLETED \n");
+            return unpinPage(&tree_mgmt->bMgr, &page_handler);
         }
-        *epislon_value = *temp_pn2 = -1;
-        return(NULL);
+        
+        return_code = pinPage(&tree_mgmt->bMgr, &child_handler, child);
+        unpinPage(&tree_mgmt->bMgr, &page_handler);
+        if( return_code != RC_OK)
+            return return_code;
+        page_handler = child_handler;
     }
-    
-    temp_pg_no = temp_nn1 -> pageNumber1;
-    
-    return_code = pinPage(&tree_mgmt->bMgr, &page_handler, temp_pg_no);
-    if( return_code != RC_OK)
-        printf("Locate Key failed ERROR %d\n", return_code);
-    
-    temp_new_node = (NewNode*)page_handler.data;
-    *temp_pn2 = temp_pg_no;
-    printf(" Locate Key : Calling search key again \n");
-    temp_nn1 = locateKey(tree, temp_new_node, key, epislon_value, temp_pn2, matched);
-    return_code = unpinPage(&tree_mgmt->bMgr, &page_handler);
-    if( return_code != RC_OK)
-        printf("Locate Key failed ERROR %d\n", return_code);
-    
-    printf("Locate Key: COMPLETED \n");
-    
-    return(temp_nn1);
 }
 
 /* Function to put key in root */
@@ -189,42 +199,47 @@ static RC updateRoot(BTreeHandle *tree, PageNumber pagNum1, PageNumber pagNum2,
     RC return_code;
     
     BTreeMgmt *hndlMgmtData = (BTreeMgmt*)tree->mgmtData;
-    return_code= pinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle, pagNum1);
+    BM_PageHandle left_handle;
+    BM_PageHandle right_handle;
+    BM_PageHandle parent_handle;
+    NewNode *new_node1;
+    PageNumber tempPageNum;
+    NewNode *new_node2;
+    NewNode *new_node3;
+    
+    return_code= pinNode(hndlMgmtData, &left_handle, pagNum1);
     if( return_code != RC_OK){
         printf(" updateRoot pin page 1: ERROR %d\n", return_code);
     }
+    new_node2 = (NewNode*) left_handle.data;
     
-    return_code = pinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle, pagNum2);
+    return_code = pinNode(hndlMgmtData, &right_handle, pagNum2);
     if( return_code != RC_OK){
         printf(" updateRoot pin page 2: ERROR %d\n", return_code);
     }
-    
-    NewNode *new_node1;
-    PageNumber tempPageNum;
-    NewNode *new_node2;
+    new_node3 = (NewNode*) right_handle.data;
     
     if(new_node2->pageNumber == -1){
         tempPageNum = addBTNode(tree);
         hndlMgmtData->pageNumber = tempPageNum;
         
-        return_code = pinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle, tempPageNum);
+        return_code = pinNode(hndlMgmtData, &parent_handle, tempPageNum);
         if( return_code != RC_OK){
             printf(" updateRoot pin page 3: ERROR %d\n", return_code);
         }
-        new_node1 = (NewNode*) ((hndlMgmtData->pHandle).data);
+        new_node1 = (NewNode*) parent_handle.data;
         new_node1->pageNumber = -1;
         new_node1->pageNumber1 = -1;
         new_node1->isLeaf = 0;
     } else {
         tempPageNum = new_node2->pageNumber;
-        return_code = pinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle, tempPageNum);
+        return_code = pinNode(hndlMgmtData, &parent_handle, tempPageNum);
         if( return_code != RC_OK){
             printf(" updateRoot pin page 4: ERROR %d\n", return_code);
         }
-        new_node1 = (NewNode*) ((hndlMgmtData->pHandle).data);
+        new_node1 = (NewNode*) parent_handle.data;
     }
     
-    NewNode *new_node3;
     Node *node1;
     if(new_node2->isLeaf){
         node1 = &new_node3->node;
@@ -247,40 +262,26 @@ static RC updateRoot(BTreeHandle *tree, PageNumber pagNum1, PageNumber pagNum2,
     new_node2->pageNumber = tempPageNum;
     new_node3->pageNumber = tempPageNum;
     
-    (&hndlMgmtData->pHandle)->pageNum = tempPageNum;
-    return_code = unpinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle);
+    return_code = releaseNode(hndlMgmtData, &parent_handle);
     if( return_code != RC_OK){
         printf(" updateRoot unpin page 1: ERROR %d\n", return_code);
     }
     
-    (&hndlMgmtData->pHandle)->pageNum = pagNum1;
-    return_code = unpinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle);
+    return_code = releaseNode(hndlMgmtData, &left_handle);
     if( return_code != RC_OK){
         printf(" updateRoot unpin page 2: ERROR %d\n", return_code);
     }
     
-    (&hndlMgmtData->pHandle)->pageNum = pagNum2;
-    return_code = unpinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle);
+    return_code = releaseNode(hndlMgmtData, &right_handle);
     if( return_code != RC_OK){
         printf(" updateRoot unpin page 3: ERROR %d\n", return_code);
     }
     
     if(keyNum <= hndlMgmtData->bTreeOrder){
-        (&hndlMgmtData->pHandle)->pageNum = tempPageNum;
-        return_code = unpinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle);
-        if( return_code != RC_OK){
-            printf(" updateRoot unpin page 4: ERROR %d\n", return_code);
-        }
         printf("updateRoot check btreeorder==> END\n");
         return RC_OK;
     }
     
-    (&hndlMgmtData->pHandle)->pageNum = tempPageNum;
-    return_code = unpinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle);
-    if( return_code != RC_OK){
-        printf(" updateRoot unpin page 5: ERROR %d\n", return_code);
-    }
-    
     printf("updateRoot ==> END\n");
     return(splitThenMerge(tree,tempPageNum,0));
 }
@@ -292,13 +293,15 @@ static RC splitThenMerge(BTreeHandle *tree, PageNumber pageN, bool isLeaf) {
     int SIZE_OF_NODE = sizeof(Node);
     
     BTreeMgmt *hndlMgmtData=(BTreeMgmt*)tree->mgmtData;
-    return_code = pinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle, pageN);
+    BM_PageHandle full_handle;
+    BM_PageHandle split_handle;
+    return_code = pinNode(hndlMgmtData, &full_handle, pageN);
     if( return_code != RC_OK){
         printf(" splitThenMerge pin page 1: ERROR %d\n", return_code);
     }
     
     NewNode *newNode1;
-    newNode1 = (NewNode*) ((hndlMgmtData->pHandle).data);
+    newNode1 = (NewNode*) full_handle.data;
     
     Node *node2;
     node2 = &newNode1->node;
@@ -306,13 +309,13 @@ static RC splitThenMerge(BTreeHandle *tree, PageNumber pageN, bool isLeaf) {
     PageNumber pageNum1;
     pageNum1=addBTNode(tree);
     
-    return_code = pinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle, pageNum1);
+    return_code = pinNode(hndlMgmtData, &split_handle, pageNum1);
     if( return_code != RC_OK){
         printf(" splitThenMerge pin page 2: ERROR %d\n", return_code);
     }
     
     NewNode *newNode2;
-    newNode2=(NewNode*)((hndlMgmtData->pHandle).data);
+    newNode2=(NewNode*) split_handle.data;
     newNode2->pageNumber=newNode1->pageNumber;
     newNode2->isLeaf=isLeaf;
     
@@ -349,14 +352,12 @@ static RC splitThenMerge(BTreeHandle *tree, PageNumber pageN, bool isLeaf) {
     }
     newNode1->keyNumber=newNode1->keyNumber-number+temp;
     
-    (&hndlMgmtData->pHandle)->pageNum = pageN;
-    return_code = unpinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle);
+    return_code = releaseNode(hndlMgmtData, &full_handle);
     if( return_code != RC_OK){
         printf(" splitThenMerge unpin page 1: ERROR %d\n", return_code);
     }
     
-    (&hndlMgmtData->pHandle)->pageNum = pageNum1;
-    return_code = unpinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle);
+    return_code = releaseNode(hndlMgmtData, &split_handle);
     if( return_code != RC_OK){
         printf(" splitThenMerge unpin page 2: ERROR %d\n", return_code);
     }
@@ -460,6 +461,7 @@ static RC mergeKeys(BTreeHandle *tree, PageNumber page1, PageNumber page2) {
     printf("mergeKeys ==> START\n");
     RC return_code;
     int SIZE_OF_NODE = (int) sizeof(Node);
+    PageNumber merged_page = page2;
     
     bool isPage1LessThanZero = (page1 < 0);
     if(isPage1LessThanZero)
@@ -468,23 +470,26 @@ static RC mergeKeys(BTreeHandle *tree, PageNumber page1, PageNumber page2) {
     //     page1 = page1;
     
     BTreeMgmt *hndlMgmtData = (BTreeMgmt*) tree->mgmtData;
-    return_code = pinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle, page1);
+    BM_PageHandle left_handle;
+    BM_PageHandle right_handle;
+    BM_PageHandle parent_handle;
+    return_code = pinNode(hndlMgmtData, &left_handle, page1);
     if( return_code != RC_OK){
         printf(" mergeKeys pin page 1: ERROR %d\n", return_code);
     }
     
     NewNode *left;
-    left = (NewNode*) &hndlMgmtData->pHandle.data;
+    left = (NewNode*) left_handle.data;
     
-    return_code = pinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle, page2);
+    return_code = pinNode(hndlMgmtData, &right_handle, page2);
     if( return_code != RC_OK){
         printf(" mergeKeys pin page 2: ERROR %d\n", return_code);
     }
     
     NewNode *right;
     Node *rightNode;
+    right = (NewNode*) right_handle.data;
     rightNode = &right->node;
-    right = (NewNode*) &hndlMgmtData->pHandle.data;
     
     Node *leftNode;
     leftNode = &left->node;
@@ -520,18 +525,18 @@ static RC mergeKeys(BTreeHandle *tree, PageNumber page1, PageNumber page2) {
         
         left->keyNumber = left->keyNumber + right->keyNumber;
         
-        return_code = pinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle, right->pageNumber);
+        return_code = pinNode(hndlMgmtData, &parent_handle, right->pageNumber);
         if( return_code != RC_OK){
             printf(" mergeKeys pin page 3: ERROR %d\n", return_code);
         }
         
         NewNode *hndlData;
-        hndlData = (NewNode*) hndlMgmtData->pHandle.data;
+        hndlData = (NewNode*) parent_handle.data;
         if(hndlData->pageNumber1 == page2) {
             hndlData->pageNumber1 = page1;
         }
         
-        return_code = unpinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle);
+        return_code = releaseNode(hndlMgmtData, &parent_handle);
         if( return_code != RC_OK){
             printf(" mergeKeys unpin page 1: ERROR %d\n", return_code);
         }
@@ -539,35 +544,38 @@ static RC mergeKeys(BTreeHandle *tree, PageNumber page1, PageNumber page2) {
         right->keyNumber = 0;
         hndlMgmtData->nodeCount = hndlMgmtData->nodeCount - 1;
         
-        (&hndlMgmtData->pHandle)->pageNum = page1;
-        
-        return_code = unpinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle);
+        return_code = releaseNode(hndlMgmtData, &left_handle);
         if( return_code != RC_OK){
             printf(" mergeKeys unpin page 2: ERROR %d\n", return_code);
         }
         
-        (&hndlMgmtData->pHandle)->pageNum = page2;
-        return_code = unpinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle);
+        return_code = releaseNode(hndlMgmtData, &right_handle);
         if( return_code != RC_OK){
             printf(" mergeKeys unpin page 3: ERROR %d\n", return_code);
         }
+        
+        // the right node is empty now, its page goes back to the index file
+        return_code = freePoolPage(&hndlMgmtData->bMgr, merged_page);
+        if( return_code != RC_OK){
+            printf(" mergeKeys free page: ERROR %d\n", return_code);
+        }
         printf("mergeKeys if ==> END\n");
         return purgeKey(tree, mergePointer, &mergeKey);
     } else if((left->keyNumber+right->keyNumber) < hndlMgmtData->bTreeOrder) {
-        return_code = pinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle, right->pageNumber);
+        return_code = pinNode(hndlMgmtData, &parent_handle, right->pageNumber);
         if( return_code != RC_OK){
             printf(" mergeKeys pin page 4: ERROR %d\n", return_code);
         }
         
-        NewNode *page2;
-        page2= (NewNode*) hndlMgmtData->pHandle.data;
+        NewNode *parent;
+        parent = (NewNode*) parent_handle.data;
         
         Node *node1;
-        node1=&page2->node;
+        node1=&parent->node;
         
         int counter = 0;
         int index;
-        while(counter < page2->keyNumber) {
+        while(counter < parent->keyNumber) {
             if(node1[counter].ptr == page2){
                 index = counter;
                 break;
@@ -610,41 +618,55 @@ static RC mergeKeys(BTreeHandle *tree, PageNumber page1, PageNumber page2) {
         
         int counter1 = 0;
         NewNode *tmp;
+        BM_PageHandle child_handle;
         while (counter1 < left->keyNumber) {
-            return_code = pinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle, leftNode[counter1].ptr);
+            return_code = pinNode(hndlMgmtData, &child_handle, leftNode[counter1].ptr);
             if( return_code != RC_OK){
                 printf(" mergeKeys pin page 5: ERROR %d\n", return_code);
             }
+            tmp = (NewNode*) child_handle.data;
             tmp->pageNumber = page1;
-            return_code = unpinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle);
+            return_code = releaseNode(hndlMgmtData, &child_handle);
             if( return_code != RC_OK){
                 printf(" mergeKeys unpin page 4: ERROR %d\n", return_code);
             }
             counter1 = counter1 + 1;
         }
         
-        (&hndlMgmtData->pHandle)->pageNum = right->pageNumber;
-        return_code = unpinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle);
+        return_code = releaseNode(hndlMgmtData, &parent_handle);
         if( return_code != RC_OK){
             printf(" mergeKeys unpin page 5: ERROR %d\n", return_code);
         }
         
-        (&hndlMgmtData->pHandle)->pageNum = page1;
-        return_code = unpinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle);
+        return_code = releaseNode(hndlMgmtData, &left_handle);
         if( return_code != RC_OK){
             printf(" mergeKeys unpin page 6: ERROR %d\n", return_code);
         }
         
-        (&hndlMgmtData->pHandle)->pageNum = page2;
-        return_code = unpinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle);
+        return_code = releaseNode(hndlMgmtData, &right_handle);
         if( return_code != RC_OK){
             printf(" mergeKeys unpin page 7: ERROR %d\n", return_code);
         }
         
+        return_code = freePoolPage(&hndlMgmtData->bMgr, merged_page);
+        if( return_code != RC_OK){
+            printf(" mergeKeys free page: ERROR %d\n", return_code);
+        }
+        
         printf("mergeKeys elseif ==> END\n");
         return purgeKey(tree, mergePointer, &mergeKey);
         
     }
+    
+    return_code = releaseNode(hndlMgmtData, &left_handle);
+    if( return_code != RC_OK){
+        printf(" mergeKeys unpin page 8: ERROR %d\n", return_code);
+    }
+    
+    return_code = releaseNode(hndlMgmtData, &right_handle);
+    if( return_code != RC_OK){
+        printf(" mergeKeys unpin page 9: ERROR %d\n", return_code);
+    }
     printf("mergeKeys ==> END\n");
     return RC_OK;
 }
@@ -665,6 +687,8 @@ static RC distributeKeys(BTreeHandle *tree, PageNumber page_number, PageNumber p
     int neg_one = -1;
     
     BTreeMgmt *tree_mgmt=(BTreeMgmt*) tree->mgmtData;
+    BM_PageHandle lt_handle;
+    BM_PageHandle rt_handle;
     
     bool bool_val = (page_number < 0);
     printf("Spread key initalize page_number \n");
@@ -674,19 +698,19 @@ static RC distributeKeys(BTreeHandle *tree, PageNumber page_number, PageNumber p
         page_number = page_number * neg_one;
     
     printf("Spread key initalize pinning page page_number \n");
-    return_code = pinPage(&tree_mgmt->bMgr, &tree_mgmt->pHandle, page_number);
+    return_code = pinNode(tree_mgmt, &lt_handle, page_number);
     if(return_code != RC_OK )
         printf("spreakKeys failed error code %d\n", return_code);
     
     NewNode *new_node_lt;
-    new_node_lt = (NewNode*)&tree_mgmt -> pHandle.data;
+    new_node_lt = (NewNode*) lt_handle.data;
     printf("Spread key initalize pinning page new_node_lt \n");
-    return_code = pinPage(&tree_mgmt -> bMgr, &tree_mgmt -> pHandle, pageNumber);
+    return_code = pinNode(tree_mgmt, &rt_handle, pageNumber);
     if(return_code != RC_OK )
         printf("spreakKeys failed error code %d\n", return_code);
     
     NewNode *new_node_rt;
-    new_node_rt = (NewNode*)&tree_mgmt->pHandle.data;
+    new_node_rt = (NewNode*) rt_handle.data;
     
     Node *node_lt;
     node_lt = &new_node_lt -> node;
@@ -755,17 +779,14 @@ static RC distributeKeys(BTreeHandle *tree, PageNumber page_number, PageNumber p
         temp = temp + 1;
         new_node_rt->keyNumber = temp;
         
-        (&tree_mgmt->pHandle) -> pageNum = page_number;
-        
         printf("spread key unpin page \n");
-        return_code = unpinPage(&tree_mgmt->bMgr, &tree_mgmt->pHandle);
+        return_code = releaseNode(tree_mgmt, &lt_handle);
         if( return_code != RC_OK )
             printf("spreak keys failed error code %d", return_code);
         if( purge_check == false)
             purge_check = true;
         
-        (&tree_mgmt->pHandle) -> pageNum = pageNumber;
-        return_code =  unpinPage(&tree_mgmt->bMgr, &tree_mgmt->pHandle);
+        return_code = releaseNode(tree_mgmt, &rt_handle);
         if( return_code != RC_OK )
             printf("spreak keys failed error code %d", return_code);
         
@@ -775,6 +796,13 @@ static RC distributeKeys(BTreeHandle *tree, PageNumber page_number, PageNumber p
         return return_code;
     }
     
+    return_code = releaseNode(tree_mgmt, &lt_handle);
+    if( return_code != RC_OK )
+        printf("spreak keys failed error code %d", return_code);
+    return_code = releaseNode(tree_mgmt, &rt_handle);
+    if( return_code != RC_OK )
+        printf("spreak keys failed error code %d", return_code);
+    
     printf("Spread key : COMPLETED \n");
     return RC_OK;
 }
@@ -840,6 +868,9 @@ static RC purgeKey(BTreeHandle *tree, PageNumber page_number, Value *key) {
     RC return_code = 0;
     int neg_one = -1;
     BTreeMgmt *tree_mgmt = (BTreeMgmt*) tree->mgmtData;
+    BM_PageHandle node_handle;
+    BM_PageHandle parent_handle;
+    BM_PageHandle child_handle;
     
     printf("delete key calling purge key\n");
     return_code = purgeKey(tree, page_number, key);
@@ -848,33 +879,28 @@ static RC purgeKey(BTreeHandle *tree, PageNumber page_number, Value *key) {
     
     tree_mgmt = (BTreeMgmt*) tree->mgmtData;
     printf("deleteKey pin page \n");
-    return_code = pinPage(&tree_mgmt->bMgr, &tree_mgmt->pHandle, page_number);
+    return_code = pinNode(tree_mgmt, &node_handle, page_number);
     if( return_code != RC_OK )
         printf("delete key failed exit code %d /n", return_code);
     
     NewNode *new_node1;
-    new_node1 = (NewNode*)&tree_mgmt -> pHandle.data;
+    new_node1 = (NewNode*) node_handle.data;
     PageNumber page_number2;
     page_number2 = new_node1 -> pageNumber;
     printf("deleteKey remove node \n");
     int temp3 = deleteNode(tree, new_node1, page_number, key);
     int temp2 = new_node1 -> keyNumber;
     
-    printf("deleteKey unpin page \n");
-    return_code = unpinPage(&tree_mgmt->bMgr, &tree_mgmt->pHandle);
-    if( return_code != RC_OK )
-        printf("delete key failed exit code %d /n", return_code);
-    
     if ( page_number2 <= 0 ){
         printf("delete key issue with delete key function as page_number shoule be > 0 \n");
     } else {
         printf("deleteKey pin page as page_number2 > 0\n");
-        return_code = pinPage(&tree_mgmt->bMgr, &tree_mgmt->pHandle, page_number2);
+        return_code = pinNode(tree_mgmt, &parent_handle, page_number2);
         if( return_code != RC_OK )
             printf("delete key failed exit code %d /n", return_code);
         
         NewNode *new_node3;
-        new_node3=(NewNode*)tree_mgmt -> pHandle.data;
+        new_node3=(NewNode*) parent_handle.data;
         
         if(new_node1->keyNumber == 0 && new_node3->keyNumber==1) {
             printf("deleteKey node1: keyNumber =0 & node3: keyNumber =1\n");
@@ -910,7 +936,7 @@ static RC purgeKey(BTreeHandle *tree, PageNumber page_number, Value *key) {
         }
         
         printf("deleteKey unpin page\n");
-        return_code = unpinPage(&tree_mgmt->bMgr, &tree_mgmt->pHandle);
+        return_code = releaseNode(tree_mgmt, &parent_handle);
         if( return_code != RC_OK )
             printf("deleteKey finsided with error %d\n", return_code);
     }
@@ -929,11 +955,12 @@ static RC purgeKey(BTreeHandle *tree, PageNumber page_number, Value *key) {
         if(new_node1 -> keyNumber == 1 && new_node1 -> pageNumber < 0) {
             printf("deleteKey pin page as keyNumber==1 && pageNumber < 0\n");
             int temp = (int) new_node1->node.ptr;
-            return_code = pinPage(&tree_mgmt->bMgr, &tree_mgmt->pHandle, temp);
+            return_code = pinNode(tree_mgmt, &child_handle, temp);
             if( return_code != RC_OK)
                 printf("delete key failed error code %d\n", return_code);
             
             NewNode *new_node4;
+            new_node4 = (NewNode*) child_handle.data;
             temp = new_node4 -> keyNumber;
             if( temp == 0) {
                 tree_mgmt -> pageNumber = new_node1-> pageNumber1;
@@ -946,17 +973,17 @@ static RC purgeKey(BTreeHandle *tree, PageNumber page_number, Value *key) {
                     new_node4-> pageNumber1 = neg_one;
             }
             printf("deleteKey un pining page \n");
-            return_code = unpinPage(tree, new_node1 -> node.ptr);
+            return_code = releaseNode(tree_mgmt, &child_handle);
             if(return_code != RC_OK )
                 printf("deleteKey failed %d\n", return_code);
             
             printf("deleteKey pin the page\n");
             temp = (int) new_node1 -> pageNumber1;
-            return_code = pinPage(&tree_mgmt->bMgr, &tree_mgmt->pHandle, temp);
+            return_code = pinNode(tree_mgmt, &child_handle, temp);
             if( return_code != RC_OK )
                 printf("deleteKey failed %d\n", return_code);
             
-            new_node4 = (NewNode*)tree_mgmt -> pHandle.data;
+            new_node4 = (NewNode*) child_handle.data;
             temp = new_node4 -> keyNumber;
             if(temp == 0) {
                 tree_mgmt-> pageNumber = (int) new_node1->node.ptr;
@@ -970,17 +997,17 @@ static RC purgeKey(BTreeHandle *tree, PageNumber page_number, Value *key) {
             }
             
             printf("deleteKey unpin the page\n");
-            return_code = unpinPage(&tree_mgmt->bMgr ,&tree_mgmt->pHandle);
+            return_code = releaseNode(tree_mgmt, &child_handle);
             if( return_code != RC_OK )
                 printf("deleteKey failed %d\n", return_code);
             
             printf("deleteKey pin the page pageNumber1\n");
             temp = new_node1-> pageNumber;
-            return_code = pinPage(&tree_mgmt->bMgr, &tree_mgmt->pHandle, temp);
+            return_code = pinNode(tree_mgmt, &child_handle, temp);
             if( return_code != RC_OK )
                 printf("deleteKey failed %d\n", return_code);
             
-            new_node4 = (NewNode*)tree_mgmt -> pHandle.data;
+            new_node4 = (NewNode*) child_handle.data;
             temp = new_node4->keyNumber;
             if( temp == 0) {
                 temp = (int) new_node1 -> node.ptr;
@@ -995,14 +1022,24 @@ static RC purgeKey(BTreeHandle *tree, PageNumber page_number, Value *key) {
             }
             
             printf("deleteKey unpin the page\n");
-            return_code = unpinPage(&tree_mgmt->bMgr, &tree_mgmt->pHandle);
+            return_code = releaseNode(tree_mgmt, &child_handle);
             if( return_code != RC_OK )
                 printf("deleteKey failed %d\n", return_code);
             
         }
+        
+        printf("deleteKey unpin page \n");
+        return_code = releaseNode(tree_mgmt, &node_handle);
+        if( return_code != RC_OK )
+            printf("delete key failed exit code %d /n", return_code);
         return(RC_OK);
     }
     
+    printf("deleteKey unpin page \n");
+    return_code = releaseNode(tree_mgmt, &node_handle);
+    if( return_code != RC_OK )
+        printf("delete key failed exit code %d /n", return_code);
+    
     int temp = 0;
     temp = tree_mgmt -> bTreeOrder;
     temp = temp +1;
@@ -1020,14 +1057,14 @@ static RC purgeKey(BTreeHandle *tree, PageNumber page_number, Value *key) {
         page_neighbour = page_number1 * neg_one;
     
     printf("delete key pin page page_neighbour \n");
-    return_code = pinPage(&tree_mgmt->bMgr,&tree_mgmt->pHandle, page_neighbour);
+    return_code = pinPage(&tree_mgmt->bMgr, &child_handle, page_neighbour);
     if( return_code != RC_OK )
         printf("deleteKey failed %d\n", return_code);
     
-    NewNode *new_node2 = (NewNode*)&tree_mgmt -> pHandle.data;
+    NewNode *new_node2 = (NewNode*) child_handle.data;
     int temp1 = new_node2 -> keyNumber;
     printf("delete key un pin the page\n");
-    return_code = unpinPage(&tree_mgmt->bMgr, &tree_mgmt->pHandle);
+    return_code = unpinPage(&tree_mgmt->bMgr, &child_handle);
     if( return_code != RC_OK )
         printf("deleteKey failed %d\n", return_code);
     
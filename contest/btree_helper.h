@@ -12,6 +12,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include "buffer_mgr.h"
 #include "dberror.h"
 #include "storage_mgr.h"
@@ -41,17 +42,22 @@ typedef struct BTreeScanMgmt {
     int currentPosition;
 }BTreeScanMgmt;
 
+// node header, the key array starting at node runs on to the end of the page
 typedef struct NewNode {
-    Node node;
     PageNumber pageNumber;
     PageNumber pageNumber1;
     int keyNumber;
     bool isLeaf;
+    Node node;
 }NewNode;
 
+// keys a node page of pageSize bytes holds. An insert fills a node to order + 1 keys before it
+// splits and shifts one slot further, so a tree of order n needs BT_NODE_KEYS(pageSize) >= n + 2
+#define BT_NODE_KEYS(pageSize) (((pageSize) - (int) offsetof(NewNode, node)) / (int) sizeof(Node))
+
 static int fillMemory(void *pointer, int value, int size);
 static int moveMemory(void *destination, void * source, int size);
-static RC locateKey (BTreeHandle *tree, NewNode *temp_nn1, Value *key, int *epislon_value, int *temp_pn2, bool matched);
+static RC findLeaf (BTreeHandle *tree, Value *key, PageNumber *leaf, bool *found, long long *ptr);
 static int makeRoot(BTreeHandle *tree, NewNode *newNode1, long long ptr, Value *key );
 static RC updateRoot(BTreeHandle *tree, PageNumber pageN, PageNumber pageNumber, Value key);
 static RC splitThenMerge(BTreeHandle *tree, PageNumber pageN, bool isLeaf);
@@ -62,6 +68,8 @@ static RC distributeKeys(BTreeHandle *tree, PageNumber lp, PageNumber pageNumber
 static PageNumber searchClosestKey(BTreeHandle *tree, PageNumber pageNumber);
 static RC purgeKey(BTreeHandle *tree, PageNumber fp, Value *key);
 static int addBTNode(BTreeHandle *tree);
+static RC pinNode(BTreeMgmt *tree_mgmt, BM_PageHandle *page, PageNumber page_number);
+static RC releaseNode(BTreeMgmt *tree_mgmt, BM_PageHandle *page);
 
 #endif /* btree_helper_h */
 
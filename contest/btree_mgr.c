@@ -21,7 +21,7 @@
 
 /* This will be used to check if index manager is initalized or not
  0: Not initalized 1: Initialized */
-int init_index_manager = 0;
+static int init_index_manager = 0;
 
 /* Initialize index manager if init_index_manager = 0 this means record manager is not initalized */
 extern RC initIndexManager (void *mgmtData){
@@ -53,18 +53,26 @@ extern RC shutdownIndexManager (){
     return RC_OK;
 }
 
-/* Function to create b tree */
+/* Function to create b tree, the index file gets the smallest page size a node of order n fits in */
 extern RC createBtree (char *idxId, DataType keyType, int n){
     printf("createBtree ==> START\n");
     SM_FileHandle fHandle;
-    char pageBlock[PAGE_SIZE];
-    char *off_set=pageBlock;
+    char *pageBlock;
+    char *off_set;
     RC return_code;
     RC PAGE_INDEX = 0;
+    int page_size = SM_MIN_PAGE_SIZE;
+    
+    while( page_size < SM_MAX_PAGE_SIZE && BT_NODE_KEYS(page_size) < n + 2 )
+        page_size = page_size * 2;
+    if( n <= 0 || BT_NODE_KEYS(page_size) < n + 2 )
+        return RC_IM_N_TO_LAGE;
     
+    pageBlock = (char*) malloc(page_size);
+    off_set = pageBlock;
     int SIZE_OF_INT = sizeof(int);
     printf("createBtree fill memory \n");
-    return_code = fillMemory(off_set, PAGE_INDEX, PAGE_SIZE);
+    return_code = fillMemory(off_set, PAGE_INDEX, page_size);
     if( return_code != RC_OK)
         printf("createBtree ERROR RC is :%d\n", return_code);
     
@@ -85,7 +93,7 @@ extern RC createBtree (char *idxId, DataType keyType, int n){
     }
     
     printf("createBtree:  creating file\n");
-    return_code = createPageFile(idxId);
+    return_code = createPageFileSize(idxId, page_size);
     if( return_code != RC_OK)
         printf("createBtree ERROR RC is :%d\n", return_code);
     
@@ -103,6 +111,7 @@ extern RC createBtree (char *idxId, DataType keyType, int n){
     return_code = closePageFile(&fHandle);
     if( return_code != RC_OK)
         printf("createBtree ERROR RC is :%d\n", return_code);
+    free(pageBlock);
     
     printf("createBtree ==> END\n");
     
@@ -292,45 +301,22 @@ RC getKeyType (BTreeHandle *tree, DataType *result) {
 RC findKey (BTreeHandle *tree, Value *key, RID *result) {
     printf("findKey : STARTED \n");
     
-    NewNode *temp_nn2;
     RC return_code = 0;
-    BTreeMgmt *hndlMgmtData= (BTreeMgmt*)tree->mgmtData;
-    PageNumber temp_pn1;
-    temp_pn1 = hndlMgmtData -> pageNumber;
-    
-    printf("findKey ping page \n");
-    return_code = pinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle, (PageNumber)temp_pn1);
-    if( return_code != RC_OK )
-        printf(" findKey ERROR %d", return_code);
-    
-    NewNode *temp_nn1;
-    temp_nn1 = (NewNode*) hndlMgmtData -> pHandle.data;
-    PageNumber temp_pn2;
-    temp_pn2 = temp_pn1;
-    int epislon_value = -1;
+    PageNumber leaf;
+    bool found;
+    long long ptr;
     
-    temp_nn2 = locateKey(tree, temp_nn1, key, &epislon_value, &temp_pn2, 0);
-    
-    printf("findKey unpin the page \n");
-    return_code = unpinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle);
-    if( return_code != RC_OK )
-        printf(" findKey ERROR %d", return_code);
-    
-    printf("findKey pin the page \n");
-    return_code = pinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle, temp_pn2);
-    if( return_code != RC_OK )
-        printf(" findKey ERROR %d", return_code);
-    
-    temp_nn1 = (NewNode*) hndlMgmtData->pHandle.data;
-    Node *temp_n;
-    temp_n = &temp_nn1->node;
-    *result = *((RID*) &temp_n[epislon_value].ptr);
-    
-    printf("findKey unpin the page \n");
-    return_code = unpinPage(&hndlMgmtData->bMgr, &hndlMgmtData->pHandle);
-    if( return_code != RC_OK )
+    // the entry is copied out of the leaf while the leaf validates, the leaf is not visited twice
+    printf("findKey find leaf \n");
+    return_code = findLeaf(tree, key, &leaf, &found, &ptr);
+    if( return_code != RC_OK ){
         printf(" findKey ERROR %d", return_code);
+        return return_code;
+    }
+    if( !found )
+        return RC_IM_KEY_NOT_FOUND;
     
+    *result = *((RID*) &ptr);
     printf("findKey : COMPLETED \n");
     return RC_OK;
 }
@@ -352,7 +338,7 @@ RC insertKey (BTreeHandle *tree, Value *key, RID rid) {
         
         hndlMgmtData->pageNumber = tempPageNumber;
         
-        return_code = pinPage(&hndlMgmtData->bMgr, &pageHandle, tempPageNumber);
+        return_code = pinNode(hndlMgmtData, &pageHandle, tempPageNumber);
         if( return_code != RC_OK){
             printf(" insertKey pin page 1: ERROR %d\n", return_code);
         }
@@ -367,7 +353,7 @@ RC insertKey (BTreeHandle *tree, Value *key, RID rid) {
         int val = makeRoot(tree, secondNode, *((long long*) &rid), key);
         printf("After adding in root, %d\n", val);
         
-        return_code = unpinPage(&hndlMgmtData->bMgr, &pageHandle);
+        return_code = releaseNode(hndlMgmtData, &pageHandle);
         if( return_code != RC_OK){
             printf(" insertKey unpin page 1: ERROR %d\n", return_code);
         }
@@ -377,25 +363,20 @@ RC insertKey (BTreeHandle *tree, Value *key, RID rid) {
     
     printf("Root parent: %d\n", hndlMgmtData->pageNumber);
     
-    return_code = pinPage(&hndlMgmtData->bMgr, &pageHandle,hndlMgmtData->pageNumber);
-    if( return_code != RC_OK){
-        printf(" insertKey pin page 2: ERROR %d\n", return_code);
-    }
-    
     PageNumber pageNumber;
-    pageNumber = hndlMgmtData->pageNumber;
-    
+    bool found;
+    long long ptr;
     NewNode *firstNode;
-    firstNode = (NewNode*) pageHandle.data;
     
-    int tempVal=-1;
-    firstNode = locateKey(tree, firstNode, key, &tempVal, &pageNumber, 1);
-    
-    Node *nodeVal;
-    nodeVal = &firstNode->node;
+    return_code = findLeaf(tree, key, &pageNumber, &found, &ptr);
+    if( return_code != RC_OK){
+        printf(" insertKey find leaf: ERROR %d\n", return_code);
+        return return_code;
+    }
     
+    // the leaf is written under its exclusive latch, readers searching it retry
     printf("before pin page 3\n");
-    return_code = pinPage(&hndlMgmtData->bMgr, &pageHandle,hndlMgmtData->pageNumber);
+    return_code = pinNode(hndlMgmtData, &pageHandle,pageNumber);
     if( return_code != RC_OK){
         printf(" insertKey pin page 3: ERROR %d\n", return_code);
     }
@@ -409,18 +390,15 @@ RC insertKey (BTreeHandle *tree, Value *key, RID rid) {
     printf("hndlMgmtData B-Tree Order :%d \n", hndlMgmtData->bTreeOrder);
     printf("firstNode keyNumber :%d \n", firstNode->keyNumber);
     
-    if(firstNode->keyNumber <= hndlMgmtData->bTreeOrder){
-        return_code = unpinPage(&hndlMgmtData->bMgr,&pageHandle);
-        if( return_code != RC_OK){
-            printf(" insertKey unpin page 2: ERROR %d\n", return_code);
-        }
-        printf("insertKey unpin page 2 ==> END\n");
-        return RC_OK;
+    int keyNum = firstNode->keyNumber;
+    return_code = releaseNode(hndlMgmtData, &pageHandle);
+    if( return_code != RC_OK){
+        printf(" insertKey unpin page 2: ERROR %d\n", return_code);
     }
     
-    return_code = unpinPage(&hndlMgmtData->bMgr, &pageHandle);
-    if( return_code != RC_OK){
-        printf(" insertKey unpin page 3: ERROR %d\n", return_code);
+    if(keyNum <= hndlMgmtData->bTreeOrder){
+        printf("insertKey unpin page 2 ==> END\n");
+        return RC_OK;
     }
     
     printf("insertKey ==> END\n");
@@ -431,34 +409,23 @@ RC insertKey (BTreeHandle *tree, Value *key, RID rid) {
 RC deleteKey(BTreeHandle *tree, Value *key) {
     printf("delete key: START \n");
     
-    BTreeMgmt *tree_mgmt = (BTreeMgmt*) tree->mgmtData;
     RC return_code = 0;
-    
-    printf("delete key pin page \n");
-    return_code = pinPage(&tree_mgmt -> bMgr, &tree_mgmt -> pHandle, tree_mgmt -> pageNumber);
-    if( return_code != RC_OK )
-        printf("delete key Failed RC: %d\n", return_code);
-    
-    NewNode *temp_node1;
-    temp_node1 = (NewNode*) tree_mgmt -> pHandle.data;
     PageNumber page_number;
-    page_number = tree_mgmt -> pageNumber;
-    
-    NewNode *temp_node2 = NULL;
-    int episilon_value;
-    printf("delete key locate key \n");
-    temp_node2 = locateKey(tree, temp_node1, key, &episilon_value, &page_number, 0);
+    bool found;
+    long long ptr;
     
-    printf("delete key un pinning page \n");
-    return_code = unpinPage(&tree_mgmt -> bMgr, &tree_mgmt -> pHandle);
-    if(return_code != RC_OK )
+    printf("delete key find leaf \n");
+    return_code = findLeaf(tree, key, &page_number, &found, &ptr);
+    if( return_code != RC_OK ){
         printf("delete key failed %d \n", return_code);
+        return return_code;
+    }
     
     printf("delete key checking if key not found \n");
-    if(!temp_node1)
+    if(!found)
         return(RC_IM_KEY_NOT_FOUND);
     
-    return_code = purgeKey(tree_mgmt, page_number, key);
+    return_code = purgeKey(tree, page_number, key);
     if( return_code != RC_OK )
         printf("delete key failed %d \n", return_code);
     
@@ -577,9 +544,10 @@ extern RC nextEntry (BT_ScanHandle *handle, RID *result) {
     }
     
     Node *tempNode;
-    scanMgmtData->currentPosition = scanMgmtData->currentPosition + 1;
+    newNode = scanMgmtData->currentNode;
     tempNode = &newNode->node;
     *result = *((RID*)&tempNode[scanMgmtData->currentPosition].ptr);
+    scanMgmtData->currentPosition = scanMgmtData->currentPosition + 1;
     
     printf("nextEntry ==> END\n");
     return RC_OK;
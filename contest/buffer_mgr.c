@@ -7,461 +7,1822 @@
 #include "buffer_mgr.h"
 #include "dberror.h"
 #include "storage_mgr.h"
-//#include <pthread.h>
-
-int node_count=1;
-int k=3;
-
-/*typedef struct node
-{
-	BM_PageHandle *pg;
-	int fixcount;
-	bool is_dirty;
-	int storage_pg_number;
-	struct node *next;
-	struct node *prev;
-}node_dll;
-
-typedef struct mgmtinfo {
-	SM_FileHandle *fh;
-	int read_io;
-	int write_io;
-	node_dll *head;
-	//pthread_mutex_t bm_mutex;
-}BM_mgmtinfo;*/
-
-//#define BM_LOCK()   pthread_mutex_lock((pthread_mutex_t *)&((BM_mgmtinfo *)bm->mgmtData)->bm_mutex);
-//#define BM_UNLOCK() pthread_mutex_unlock((pthread_mutex_t *)&((BM_mgmtinfo *)bm->mgmtData)->bm_mutex);
-
-node_dll *GetNewNode(int x) {
-	node_dll *newNode=(node_dll*)malloc(sizeof(node_dll));
-	newNode->storage_pg_number = x;
-	newNode->is_dirty=0;
-	newNode->fixcount=0;
-	newNode->prev = NULL;
-	newNode->next = NULL;
-	newNode->pg = (BM_PageHandle*)malloc(sizeof(BM_PageHandle));
-	newNode->pg->pageNum=x;
-	newNode->pg->data=0;
-	return newNode;
- }
-
-//Inserts a Node at tail of Doubly linked list
-node_dll *InsertAtTail(node_dll *head, int pageNum) {
-	node_dll *temp = head;
-	node_dll *newNode = GetNewNode(pageNum);
-	if(head == NULL) {
-		head = newNode;
-		return head;
-	}
-	while(temp->next != NULL)
-		temp = temp->next; // Go To last Node
-	temp->next = newNode;
-	newNode->prev = temp;
-	node_count +=1;
-	return head;
-}
-
-RC strategy(BM_BufferPool *const bm, int pageNum) // k is only for LRU-K
-{
-	int if_fix=0;
-	int k_iterations=1;
-	node_dll *temp=((BM_mgmtinfo *)bm->mgmtData)->head;
-	node_dll *temp1=((BM_mgmtinfo *)bm->mgmtData)->head;
-	if(bm->strategy==RS_FIFO || bm->strategy==RS_LRU)
-	{
-		while(temp->fixcount!=0)
+#include "buffer_mgr_hash.h"
+#include "buffer_mgr_lruk.h"
+#include "buffer_mgr_arc.h"
+#include "storage_mgr_async.h"
+#include <pthread.h>
+
+#define MGMT(bm) ((BM_mgmtinfo *)(bm)->mgmtData)
+
+#define BM_LOCK(part)   pthread_mutex_lock(&(part)->latch)
+#define BM_UNLOCK(part) pthread_mutex_unlock(&(part)->latch)
+
+// page I/O on the pool's file, shared against the growth of the file
+#define FILE_SHARED(mgmt)    pthread_rwlock_rdlock(&(mgmt)->pool->file_latch)
+#define FILE_EXCLUSIVE(mgmt) pthread_rwlock_wrlock(&(mgmt)->pool->file_latch)
+#define FILE_RELEASE(mgmt)   pthread_rwlock_unlock(&(mgmt)->pool->file_latch)
+
+#define PIN_FRAME(temp)   __atomic_add_fetch(&(temp)->fixcount, 1, __ATOMIC_ACQ_REL)
+#define UNPIN_FRAME(temp) __atomic_sub_fetch(&(temp)->fixcount, 1, __ATOMIC_ACQ_REL)
+
+//LFU buckets: one list of frames per use count, a frame is appended when it enters a bucket so
+//within a count the oldest goes first. Pins and evictions move a frame between buckets in O(1).
+void LfuInsert(BM_mgmtinfo *mgmt, node_dll *temp, int freq) {
+	temp->lfu_freq = freq;
+	temp->lfu_next = NULL;
+	temp->lfu_prev = mgmt->lfu_tail[freq];
+	if(mgmt->lfu_tail[freq] == NULL)
+		mgmt->lfu_head[freq] = temp;
+	else
+		mgmt->lfu_tail[freq]->lfu_next = temp;
+	mgmt->lfu_tail[freq] = temp;
+	if(freq < mgmt->lfu_min)
+		mgmt->lfu_min = freq;
+}
+
+void LfuRemove(BM_mgmtinfo *mgmt, node_dll *temp) {
+	if(temp->lfu_prev != NULL)
+		temp->lfu_prev->lfu_next = temp->lfu_next;
+	else
+		mgmt->lfu_head[temp->lfu_freq] = temp->lfu_next;
+	if(temp->lfu_next != NULL)
+		temp->lfu_next->lfu_prev = temp->lfu_prev;
+	else
+		mgmt->lfu_tail[temp->lfu_freq] = temp->lfu_prev;
+	temp->lfu_next = NULL;
+	temp->lfu_prev = NULL;
+}
+
+//Aging: halves every count. Bucket f goes to f/2, below f and already done, so one pass in
+//ascending order keeps the age order within each new bucket. O(numPages) once every
+//BM_LFU_AGING_PINS*numPages pins.
+void LfuAge(BM_mgmtinfo *mgmt) {
+	node_dll *temp, *next;
+	int freq;
+	for(freq=1;freq<=BM_LFU_MAX_FREQ;freq++)
+	{
+		temp = mgmt->lfu_head[freq];
+		mgmt->lfu_head[freq] = NULL;
+		mgmt->lfu_tail[freq] = NULL;
+		for(;temp!=NULL;temp=next)
 		{
-			temp=temp->next;
-			if_fix=1;
+			next = temp->lfu_next;
+			LfuInsert(mgmt, temp, freq / 2);
 		}
-				node_dll *temp_first=NULL;
-				node_dll *temp_trav=NULL;
-				node_dll *temp_prev=NULL;
-				node_dll *temp_next=NULL;
-				if(temp->prev != NULL)
-					temp_prev=temp->prev;
-				else
-					temp_prev=((BM_mgmtinfo *)bm->mgmtData)->head;
-
-				if(temp->next != NULL)
-					temp_next=temp->next;
-
-				temp_trav=temp;
-
-				if(if_fix==1)
-				{
-					temp_first=temp_trav;
-					if (temp_next != NULL){
-						temp_prev->next = temp_next;
-						temp_next->prev = temp_prev;
-						temp_first->prev = NULL;
-						temp_first->next = 	((BM_mgmtinfo *)bm->mgmtData)->head ;
-						((BM_mgmtinfo *)bm->mgmtData)->head = temp_first;
-					}
-					else{
-						temp_prev->next = NULL;
-						temp_first->prev = NULL;
-						temp_first->next = 	((BM_mgmtinfo *)bm->mgmtData)->head ;
-						((BM_mgmtinfo *)bm->mgmtData)->head = temp_first;
-					}
-				}
-		temp=((BM_mgmtinfo *)bm->mgmtData)->head;
-		if(temp->is_dirty==1)
+	}
+	mgmt->lfu_pins = 0;
+}
+
+//Registers a resident frame with the structures of the strategy in effect
+void PolicyInsert(BM_mgmtinfo *mgmt, node_dll *newNode) {
+	// a new page has been used once, a ring page not even that
+	if(mgmt->lfu_head != NULL)
+		LfuInsert(mgmt, newNode, newNode->in_ring ? 0 : 1);
+	if(mgmt->lru_k != NULL)
+	{
+		lruKLoad(mgmt->lru_k, newNode);
+		if(newNode->in_ring)
+			lruKDemote(mgmt->lru_k, newNode);
+		if(FIX_COUNT(newNode) == 0)
+			lruKUnpinned(mgmt->lru_k, newNode);
+	}
+	if(mgmt->arc != NULL)
+		arcLoad(mgmt->arc, newNode);
+}
+
+//Inserts a Node at tail of Doubly linked list and registers it in the page table
+void InsertAtTail(BM_mgmtinfo *mgmt, node_dll *newNode) {
+	newNode->next = NULL;
+	newNode->prev = mgmt->tail;
+	if(mgmt->tail == NULL)
+		mgmt->head = newNode;
+	else
+		mgmt->tail->next = newNode;
+	mgmt->tail = newNode;
+	insertPageTable(mgmt->page_table, newNode->storage_pg_number, newNode);
+	PolicyInsert(mgmt, newNode);
+}
+
+//Unlinks a Node from the Doubly linked list without freeing it
+void RemoveNode(BM_mgmtinfo *mgmt, node_dll *temp) {
+	if(temp->prev != NULL)
+		temp->prev->next = temp->next;
+	else
+		mgmt->head = temp->next;
+	if(temp->next != NULL)
+		temp->next->prev = temp->prev;
+	else
+		mgmt->tail = temp->prev;
+	temp->prev = NULL;
+	temp->next = NULL;
+}
+
+//Moves a Node to the head of the Doubly linked list, the first the strategies evict
+void MoveToHead(BM_mgmtinfo *mgmt, node_dll *temp) {
+	if(mgmt->head == temp)
+		return;
+	RemoveNode(mgmt, temp);
+	temp->next = mgmt->head;
+	mgmt->head->prev = temp;
+	mgmt->head = temp;
+}
+
+//Moves a Node to the tail of the Doubly linked list (most recently used end)
+void MoveToTail(BM_mgmtinfo *mgmt, node_dll *temp) {
+	if(mgmt->tail == temp)
+		return;
+	RemoveNode(mgmt, temp);
+	temp->prev = mgmt->tail;
+	mgmt->tail->next = temp;
+	mgmt->tail = temp;
+}
+
+//Looks up the frame holding pageNum, NULL if the page is not in the pool
+node_dll *FindNode(BM_BufferPool *const bm, int pageNum) {
+	return (node_dll *)lookupPageTable(MGMT(bm)->page_table, pageNum);
+}
+
+//Takes the file latch for writing pages up to lastPage: shared while they are all inside the file,
+//exclusive if the write grows it, as ReadFrame does for a new page. Released with FILE_RELEASE.
+void FileLatchWrite(BM_mgmtinfo *mgmt, int lastPage) {
+	FILE_SHARED(mgmt);
+	if(lastPage < mgmt->fh->totalNumPages)
+		return;
+	FILE_RELEASE(mgmt);
+	FILE_EXCLUSIVE(mgmt);
+}
+
+//Writes a dirty frame back to the page file
+RC WriteBackFrame(BM_mgmtinfo *mgmt, node_dll *temp) {
+	RC rc;
+	FileLatchWrite(mgmt, temp->storage_pg_number);
+	rc = writeBlock (temp->storage_pg_number, mgmt->fh, temp->pg->data);
+	FILE_RELEASE(mgmt);
+	if(rc != RC_OK)
+		return rc;
+	temp->is_dirty=0;
+	mgmt->write_io += 1;
+	return RC_OK;
+}
+
+//Collects finished asynchronous write-backs and puts their staging pages back on the free list,
+//blocking until at least one finished if wait is set
+void ReapWriteBacks(BM_mgmtinfo *mgmt, bool wait) {
+	SM_IORequest *done[BM_WRITEBACK_SLOTS];
+	int n, i;
+	if(wait)
+		n = waitCompletions(mgmt->aio, done, 1, BM_WRITEBACK_SLOTS);
+	else
+		n = pollCompletions(mgmt->aio, done, BM_WRITEBACK_SLOTS);
+	for(i=0;i<n;i++)
+	{
+		if(done[i]->result != RC_OK && mgmt->wb_error == RC_OK)
+			mgmt->wb_error = done[i]->result;
+		done[i]->pageNum = NO_PAGE;
+		done[i]->next = mgmt->wb_free;
+		mgmt->wb_free = done[i];
+		mgmt->wb_in_flight--;
+	}
+}
+
+//Waits until no write-back of pageNum is in flight, so reading the page back never sees the old content.
+//Only evicted pages are ever in flight, a resident page never has an outstanding write.
+void WaitWriteBack(BM_mgmtinfo *mgmt, int pageNum) {
+	int i;
+	if(mgmt->aio == NULL || mgmt->wb_in_flight == 0)
+		return;
+	for(i=0;i<BM_WRITEBACK_SLOTS;i++)
+		while(mgmt->wb_reqs[i].pageNum == pageNum)
+			ReapWriteBacks(mgmt, 1);
+}
+
+//Starts the write-back of a dirty victim: the page is copied to a staging page and written asynchronously,
+//so the frame can be refilled by the miss read while the write is still in flight
+RC WriteBackAsync(BM_mgmtinfo *mgmt, node_dll *temp) {
+	SM_IORequest *req;
+	if(mgmt->wb_free == NULL)
+		ReapWriteBacks(mgmt, 0);
+	while(mgmt->wb_free == NULL)
+		ReapWriteBacks(mgmt, 1);
+	req = mgmt->wb_free;
+	mgmt->wb_free = req->next;
+
+	memcpy(req->memPage, temp->pg->data, mgmt->fh->pageSize);
+	req->pageNum = temp->storage_pg_number;
+	req->isWrite = 1;
+	mgmt->wb_in_flight++;
+	// the page's location in the file is looked up on submission, a page past the end grows the file there
+	FileLatchWrite(mgmt, req->pageNum);
+	submitBlocks(mgmt->aio, &req, 1);
+	FILE_RELEASE(mgmt);
+	temp->is_dirty=0;
+	mgmt->write_io += 1;
+	return RC_OK;
+}
+
+//Waits for every asynchronous write-back, returns the first error any of them hit
+RC DrainWriteBacks(BM_mgmtinfo *mgmt) {
+	RC rc;
+	if(mgmt->aio == NULL)
+		return RC_OK;
+	while(mgmt->wb_in_flight > 0)
+		ReapWriteBacks(mgmt, 1);
+	rc = mgmt->wb_error;
+	mgmt->wb_error = RC_OK;
+	return rc;
+}
+
+//Empties an unpinned frame: writes it back if dirty and detaches it from the pool
+RC EvictFrame(BM_mgmtinfo *mgmt, node_dll *temp)
+{
+	RC rc;
+	if(temp->prefetched)
+	{
+		mgmt->prefetch_unused += 1;
+		temp->prefetched = 0;
+	}
+	if(temp->is_dirty==1)
+	{
+		if(mgmt->aio != NULL)
+			rc = WriteBackAsync(mgmt, temp);
+		else
+			rc = WriteBackFrame(mgmt, temp);
+		if(rc != RC_OK)
+			return rc;
+	}
+	RemoveNode(mgmt, temp);
+	if(mgmt->lfu_head != NULL)
+		LfuRemove(mgmt, temp);
+	if(mgmt->lru_k != NULL)
+		lruKEvict(mgmt->lru_k, temp);
+	// a ring page is not worth remembering, its ghost would only pull p towards the scan
+	if(mgmt->arc != NULL)
+		arcEvict(mgmt->arc, temp, !temp->in_ring);
+	removePageTable(mgmt->page_table, temp->storage_pg_number);
+	temp->storage_pg_number = NO_PAGE;
+	temp->pg->pageNum = NO_PAGE;
+	temp->in_ring = 0;
+	return RC_OK;
+}
+
+//CLOCK and GCLOCK: the hand sweeps the frame array, a frame with references left is passed
+//over and loses one, the first unpinned frame without any is the victim. Every frame runs out
+//of references within clock_max+1 turns of the hand, so the sweep is bounded.
+node_dll *ClockVictim(BM_BufferPool *const bm)
+{
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	node_dll *temp;
+	int sweeps = bm->numPages * (mgmt->clock_max + 1);
+
+	while(sweeps-- > 0)
+	{
+		temp = &mgmt->frames[mgmt->clock_hand];
+		mgmt->clock_hand = (mgmt->clock_hand + 1) % bm->numPages;
+		// frames between owners (taken but not filled yet) and pinned ones are not candidates
+		if(temp->storage_pg_number == NO_PAGE || FIX_COUNT(temp) != 0)
+			continue;
+		if(temp->ref_count > 0)
 		{
-			forcePage(bm,temp->pg);
+			temp->ref_count -= 1;
+			continue;
 		}
+		return temp;
+	}
+	return NULL;
+}
 
-		((BM_mgmtinfo *)bm->mgmtData)->head=temp->next;
-		((BM_mgmtinfo *)bm->mgmtData)->head->prev=NULL;
-		temp->next=NULL;
-		((BM_mgmtinfo *)bm->mgmtData)->head=InsertAtTail(((BM_mgmtinfo *)bm->mgmtData)->head, pageNum);
+//LFU: the oldest unpinned frame of the lowest count. Buckets found empty on the way up are
+//not looked at again until a frame enters one of them.
+node_dll *LfuVictim(BM_mgmtinfo *mgmt)
+{
+	node_dll *temp;
+	int freq;
+	bool empty_below = 1;
+
+	for(freq=mgmt->lfu_min;freq<=BM_LFU_MAX_FREQ;freq++)
+	{
+		for(temp=mgmt->lfu_head[freq];temp!=NULL;temp=temp->lfu_next)
+			if(FIX_COUNT(temp) == 0)
+				return temp;
+		if(empty_below && mgmt->lfu_head[freq] == NULL)
+			mgmt->lfu_min = freq + 1;
+		else
+			empty_below = 0;
 	}
-	else if(bm->strategy==RS_LRU_K)
+	return NULL;
+}
+
+//Picks an unpinned victim frame, writes it back if dirty and detaches it from the pool
+RC strategy(BM_BufferPool *const bm, node_dll **victim)
+{
+	RC rc;
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	node_dll *temp=mgmt->head;
+
+	if(mgmt->policy==RS_FIFO || mgmt->policy==RS_LRU)
 	{
-		temp=((BM_mgmtinfo *)bm->mgmtData)->head;
-		while(k_iterations < k )
-		{
-			k_iterations += 1;
+		// oldest unpinned frame is the victim
+		while(temp!=NULL && FIX_COUNT(temp) != 0)
 			temp=temp->next;
+	}
+	else if(mgmt->policy==RS_LRU_K)
+	{
+		// top of the heap: the largest backward K-distance
+		temp = lruKVictim(mgmt->lru_k);
+	}
+	else if(mgmt->policy==RS_ARC)
+	{
+		temp = arcVictim(mgmt->arc);
+	}
+	else if(mgmt->policy==RS_CLOCK || mgmt->policy==RS_GCLOCK)
+	{
+		temp = ClockVictim(bm);
+	}
+	else if(mgmt->policy==RS_LFU)
+	{
+		temp = LfuVictim(mgmt);
+	}
+	if(temp==NULL)
+		return RC_NO_MORE_SPACE_IN_BUFFER;
+
+	rc = EvictFrame(mgmt, temp);
+	if(rc != RC_OK)
+		return rc;
+	*victim = temp;
+	return RC_OK;
+}
+
+//Hands out a frame for a new page: a never used one from the free list, else an evicted victim
+RC TakeSharedFrame(BM_BufferPool *const bm, node_dll **frame)
+{
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	if(mgmt->free_list != NULL)
+	{
+		*frame = mgmt->free_list;
+		mgmt->free_list = (*frame)->next;
+		return RC_OK;
+	}
+	return strategy(bm, frame);
+}
+
+//A ring slot's frame still holds the page the ring put there, so the ring may recycle it
+#define RING_HOLDS(ring, i) ((ring)->frames[i] != NULL && (ring)->frames[i]->in_ring && \
+	(ring)->frames[i]->storage_pg_number == (ring)->pages[i])
+
+//Frame for pageNum. Through a ring, the next ring slot's frame is emptied and reused as long as it
+//still holds the page the ring put there. Slots whose frame is pinned are passed over. Slots not
+//filled yet, or whose frame the strategy took meanwhile, get a frame from the shared pool. So a scan
+//never holds more than ring->size frames of the partition and the rest keeps its pages.
+RC TakeFrame(BM_BufferPool *const bm, BM_RingPart *ring, PageNumber pageNum, node_dll **frame)
+{
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	node_dll *temp = NULL;
+	int tries;
+	RC rc;
+
+	if(ring == NULL)
+		return TakeSharedFrame(bm, frame);
+
+	for(tries=0;tries<ring->size;tries++)
+	{
+		if(!RING_HOLDS(ring, ring->pos) || FIX_COUNT(ring->frames[ring->pos]) == 0)
+			break;
+		ring->pos = (ring->pos + 1) % ring->size;
+	}
+	// every ring frame pinned: the page goes to the shared pool
+	if(tries == ring->size)
+		return TakeSharedFrame(bm, frame);
+
+	temp = ring->frames[ring->pos];
+	if(RING_HOLDS(ring, ring->pos))
+		rc = EvictFrame(mgmt, temp);
+	else
+		rc = TakeSharedFrame(bm, &temp);
+	if(rc != RC_OK)
+		return rc;
+
+	temp->in_ring = 1;
+	ring->frames[ring->pos] = temp;
+	ring->pages[ring->pos] = pageNum;
+	ring->pos = (ring->pos + 1) % ring->size;
+	*frame = temp;
+	return RC_OK;
+}
+
+//Puts a frame that did not get a page back on the free list
+void ReturnFrame(BM_mgmtinfo *mgmt, node_dll *frame)
+{
+	frame->in_ring = 0;
+	frame->next = mgmt->free_list;
+	mgmt->free_list = frame;
+}
+
+//Sets up what the strategy needs next to the frame list: the CLOCK limit, the LFU buckets, the
+//LRU-K histories or the ARC lists. stratData is the one given to initBufferPool.
+RC InitPolicy(BM_mgmtinfo *mgmt, ReplacementStrategy policy, void *stratData, int numPages)
+{
+	RC rc = RC_OK;
+	mgmt->policy = policy;
+	mgmt->clock_hand=0;
+	mgmt->clock_max=1;
+	if(policy==RS_GCLOCK)
+		mgmt->clock_max = (stratData != NULL && *(int *)stratData > 0) ? *(int *)stratData : BM_GCLOCK_MAX;
+	mgmt->lfu_min=0;
+	mgmt->lfu_pins=0;
+	if(policy==RS_LFU)
+	{
+		mgmt->lfu_head = (node_dll **)calloc(BM_LFU_MAX_FREQ + 1, sizeof(node_dll *));
+		mgmt->lfu_tail = (node_dll **)calloc(BM_LFU_MAX_FREQ + 1, sizeof(node_dll *));
+		if(mgmt->lfu_head == NULL || mgmt->lfu_tail == NULL)
+			rc = RC_NO_MORE_SPACE_IN_BUFFER;
+	}
+	if(policy==RS_LRU_K)
+	{
+		mgmt->lru_k = (BM_LruK *)malloc(sizeof(BM_LruK));
+		rc = initLruK(mgmt->lru_k, (stratData != NULL && *(int *)stratData > 0) ? *(int *)stratData : BM_LRU_K_DEFAULT, numPages);
+		if(rc != RC_OK)
+		{
+			free(mgmt->lru_k);
+			mgmt->lru_k = NULL;
 		}
-		while(temp->fixcount!=0)
+	}
+	if(policy==RS_ARC)
+	{
+		mgmt->arc = (BM_Arc *)malloc(sizeof(BM_Arc));
+		rc = initArc(mgmt->arc, numPages);
+		if(rc != RC_OK)
 		{
-			temp=temp->prev;
-			if_fix=1;
+			free(mgmt->arc);
+			mgmt->arc = NULL;
 		}
+	}
+	return rc;
+}
 
-		node_dll *temp_first;
-		node_dll *temp_trav;
-		node_dll *temp_prev;
-		node_dll *temp_next;
+void FreePolicy(BM_mgmtinfo *mgmt)
+{
+	free(mgmt->lfu_head);
+	free(mgmt->lfu_tail);
+	mgmt->lfu_head = NULL;
+	mgmt->lfu_tail = NULL;
+	if(mgmt->lru_k != NULL)
+	{
+		freeLruK(mgmt->lru_k);
+		free(mgmt->lru_k);
+		mgmt->lru_k = NULL;
+	}
+	if(mgmt->arc != NULL)
+	{
+		freeArc(mgmt->arc);
+		free(mgmt->arc);
+		mgmt->arc = NULL;
+	}
+}
 
-		if(temp->prev != NULL)
-			temp_prev=temp->prev;
-		else
-			temp_prev=((BM_mgmtinfo *)bm->mgmtData)->head;
+//What a pin tells the strategy in effect: a hit moves the frame in the LRU order, counts a
+//CLOCK reference or moves it up an LFU bucket, then every pin counts for LFU aging, LRU-K and ARC
+void PolicyPin(BM_BufferPool *const bm, node_dll *temp, bool hit)
+{
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	if(!hit)
+		;
+	else if(mgmt->policy==RS_LRU)
+	{
+		MoveToTail(mgmt, temp);
+	}
+	else if(mgmt->policy==RS_CLOCK || mgmt->policy==RS_GCLOCK)
+	{
+		// a hit only counts a reference, the frame stays where it is
+		if(temp->ref_count < mgmt->clock_max)
+			temp->ref_count += 1;
+	}
+	else if(mgmt->policy==RS_LFU && !temp->prefetched && temp->lfu_freq < BM_LFU_MAX_FREQ)
+	{
+		// one bucket up; the first pin of a read ahead page is its first use, counted on load
+		LfuRemove(mgmt, temp);
+		LfuInsert(mgmt, temp, temp->lfu_freq + 1);
+	}
+	if(mgmt->policy==RS_LFU && ++mgmt->lfu_pins >= BM_LFU_AGING_PINS * bm->numPages)
+		LfuAge(mgmt);
+	if(mgmt->lru_k != NULL)
+		lruKReference(mgmt->lru_k, temp);
+	if(mgmt->arc != NULL)
+		arcReference(mgmt->arc, temp);
+}
+
+//Makes policy the strategy in effect. The resident pages are handed to it oldest first, each
+//counting as referenced once, so it starts from the recency order the list kept. If its state
+//cannot be allocated the pool falls back to LRU, which needs none.
+RC SwitchPolicy(BM_BufferPool *const bm, ReplacementStrategy policy)
+{
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	node_dll *temp;
+	RC rc;
+
+	FreePolicy(mgmt);
+	rc = InitPolicy(mgmt, policy, NULL, bm->numPages);
+	if(rc != RC_OK)
+	{
+		FreePolicy(mgmt);
+		InitPolicy(mgmt, RS_LRU, NULL, bm->numPages);
+	}
+	for(temp=mgmt->head;temp!=NULL;temp=temp->next)
+	{
+		temp->khist = NULL;
+		temp->arc = NULL;
+		PolicyInsert(mgmt, temp);
+		if(mgmt->lru_k != NULL)
+		{
+			lruKReference(mgmt->lru_k, temp);
+			if(FIX_COUNT(temp) == 0)
+				lruKUnpinned(mgmt->lru_k, temp);
+		}
+	}
+	return rc;
+}
+
+//RS_ADAPTIVE: the candidate strategies and a shadow pool running each of them. A shadow pool is
+//an ordinary pool without file, arena or data, so the strategies run on it unchanged and their
+//hits are the ones they would have on the pages sampled.
+#define BM_ADAPTIVE_CANDIDATES 5
+static const ReplacementStrategy AdaptiveCandidates[BM_ADAPTIVE_CANDIDATES] = {
+	RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC
+};
+
+typedef struct BM_Adaptive {
+	unsigned int sample_mask;	// a page is sampled when these bits of its hash are clear
+	int epoch;			// sampled pins between two decisions
+	BM_BufferPool shadow[BM_ADAPTIVE_CANDIDATES];
+	long hits[BM_ADAPTIVE_CANDIDATES];	// shadow hits since the pool started
+	long refs;			// sampled pins since the pool started
+	long epoch_hits[BM_ADAPTIVE_CANDIDATES];
+	long epoch_refs;
+	int switches;
+} BM_Adaptive;
+
+void FreeShadowPool(BM_BufferPool *const sbm)
+{
+	BM_mgmtinfo *mgmt = MGMT(sbm);
+	if(mgmt == NULL)
+		return;
+	FreePolicy(mgmt);
+	if(mgmt->page_table != NULL)
+		freePageTable(mgmt->page_table);
+	free(mgmt->page_table);
+	free(mgmt->frames);
+	free(mgmt->handles);
+	free(mgmt);
+	sbm->mgmtData = NULL;
+}
+
+RC InitShadowPool(BM_BufferPool *const sbm, ReplacementStrategy policy, int numPages)
+{
+	BM_mgmtinfo *mgmt = (BM_mgmtinfo *)calloc(1, sizeof(BM_mgmtinfo));
+	int i;
+
+	sbm->pageFile = NULL;
+	sbm->numPages = numPages;
+	sbm->pageSize = 0;
+	sbm->strategy = policy;
+	sbm->mgmtData = mgmt;
+	if(mgmt == NULL)
+		return RC_NO_MORE_SPACE_IN_BUFFER;
+	mgmt->page_table = (BM_PageTable *)malloc(sizeof(BM_PageTable));
+	mgmt->frames = (node_dll *)calloc(numPages, sizeof(node_dll));
+	mgmt->handles = (BM_PageHandle *)calloc(numPages, sizeof(BM_PageHandle));
+	if(mgmt->page_table == NULL || initPageTable(mgmt->page_table, numPages) != RC_OK)
+	{
+		free(mgmt->page_table);
+		mgmt->page_table = NULL;
+		FreeShadowPool(sbm);
+		return RC_NO_MORE_SPACE_IN_BUFFER;
+	}
+	if(mgmt->frames == NULL || mgmt->handles == NULL || InitPolicy(mgmt, policy, NULL, numPages) != RC_OK)
+	{
+		FreeShadowPool(sbm);
+		return RC_NO_MORE_SPACE_IN_BUFFER;
+	}
+	for(i=numPages-1;i>=0;i--)
+	{
+		mgmt->handles[i].pageNum = NO_PAGE;
+		mgmt->frames[i].pg = &mgmt->handles[i];
+		mgmt->frames[i].storage_pg_number = NO_PAGE;
+		mgmt->frames[i].next = mgmt->free_list;
+		mgmt->free_list = &mgmt->frames[i];
+	}
+	return RC_OK;
+}
+
+//A pin and unpin of pageNum on a shadow pool, returns whether it was a hit
+bool ShadowAccess(BM_BufferPool *const sbm, PageNumber pageNum)
+{
+	BM_mgmtinfo *mgmt = MGMT(sbm);
+	node_dll *temp = FindNode(sbm, pageNum);
+	bool hit = (temp != NULL);
 
-		if(temp->next != NULL)
-			temp_next=temp->next;
+	if(!hit)
+	{
+		if(mgmt->arc != NULL)
+			arcPrepare(mgmt->arc, pageNum);
+		if(TakeFrame(sbm, NULL, pageNum, &temp) != RC_OK)
+			return 0;
+		temp->storage_pg_number = pageNum;
+		temp->pg->pageNum = pageNum;
+		temp->ref_count = 1;
+		InsertAtTail(mgmt, temp);
+	}
+	PolicyPin(sbm, temp, hit);
+	if(mgmt->lru_k != NULL)
+		lruKUnpinned(mgmt->lru_k, temp);
+	return hit;
+}
 
-		temp_trav=temp;
+void FreeAdaptive(BM_mgmtinfo *mgmt)
+{
+	int i;
+	if(mgmt->adaptive == NULL)
+		return;
+	for(i=0;i<BM_ADAPTIVE_CANDIDATES;i++)
+		FreeShadowPool(&mgmt->adaptive->shadow[i]);
+	free(mgmt->adaptive);
+	mgmt->adaptive = NULL;
+}
+
+//Pages are sampled by a hash of their number, a sampled page is seen on every one of its pins.
+//A shadow pool of numPages/rate frames then behaves as the pool would on all pages, at 1/rate
+//of the cost.
+RC InitAdaptive(BM_BufferPool *const bm)
+{
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	BM_Adaptive *ad;
+	int rate = 1;
+	int i;
+	RC rc;
+
+	while(rate < BM_ADAPTIVE_SAMPLE && bm->numPages / (rate * 2) >= BM_ADAPTIVE_MIN_SHADOW)
+		rate *= 2;
+	ad = (BM_Adaptive *)calloc(1, sizeof(BM_Adaptive));
+	mgmt->adaptive = ad;
+	if(ad == NULL)
+		return RC_NO_MORE_SPACE_IN_BUFFER;
+	ad->sample_mask = rate - 1;
+	ad->epoch = BM_ADAPTIVE_EPOCH;
+	if(ad->epoch < 4 * (bm->numPages / rate))
+		ad->epoch = 4 * (bm->numPages / rate);
+	for(i=0;i<BM_ADAPTIVE_CANDIDATES;i++)
+	{
+		rc = InitShadowPool(&ad->shadow[i], AdaptiveCandidates[i], bm->numPages / rate);
+		if(rc != RC_OK)
+		{
+			FreeAdaptive(mgmt);
+			return rc;
+		}
+	}
+	return RC_OK;
+}
 
-		temp_first=temp_trav;
-		temp_prev->next=temp_next;
-		temp_next->prev=temp_prev;
-		temp_first->prev=NULL;
-		temp_first->next=((BM_mgmtinfo *)bm->mgmtData)->head;
-		((BM_mgmtinfo *)bm->mgmtData)->head=temp_first;
+//Replays a pin on the shadow pools if its page is sampled. At the end of an epoch the pool
+//switches to the candidate with the most hits in it, provided it beat the strategy in effect by
+//the margin: a small lead is as likely noise, and a switch loses the old strategy's history.
+void AdaptiveSample(BM_BufferPool *const bm, PageNumber pageNum)
+{
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	BM_Adaptive *ad = mgmt->adaptive;
+	unsigned int hash = (unsigned int)pageNum * 2654435769u;
+	int i, best = 0, current = 0;
 
-		temp=((BM_mgmtinfo *)bm->mgmtData)->head;
-		if(temp->is_dirty==1)
+	if((hash >> 24) & ad->sample_mask)
+		return;
+	ad->refs += 1;
+	ad->epoch_refs += 1;
+	for(i=0;i<BM_ADAPTIVE_CANDIDATES;i++)
+		if(ShadowAccess(&ad->shadow[i], pageNum))
 		{
-			forcePage(bm,temp->pg);
+			ad->hits[i] += 1;
+			ad->epoch_hits[i] += 1;
 		}
-		((BM_mgmtinfo *)bm->mgmtData)->head=temp->next;
-		((BM_mgmtinfo *)bm->mgmtData)->head->prev=NULL;
-		temp->next=NULL;
-		((BM_mgmtinfo *)bm->mgmtData)->head=InsertAtTail(((BM_mgmtinfo *)bm->mgmtData)->head, pageNum);
+	if(ad->epoch_refs < ad->epoch)
+		return;
 
+	for(i=0;i<BM_ADAPTIVE_CANDIDATES;i++)
+	{
+		if(AdaptiveCandidates[i] == mgmt->policy)
+			current = i;
+		if(ad->epoch_hits[i] > ad->epoch_hits[best])
+			best = i;
 	}
-return RC_OK;
+	if(best != current && (ad->epoch_hits[best] - ad->epoch_hits[current]) * 100 > ad->epoch_refs * BM_ADAPTIVE_MARGIN
+	   && SwitchPolicy(bm, AdaptiveCandidates[best]) == RC_OK)
+		ad->switches += 1;
+	for(i=0;i<BM_ADAPTIVE_CANDIDATES;i++)
+		ad->epoch_hits[i] = 0;
+	ad->epoch_refs = 0;
 }
 
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
 		  const int numPages, ReplacementStrategy strategy,
 		  void *stratData)
 {
+	return initBufferPoolMode(bm, pageFileName, numPages, strategy, stratData, SM_IO_BUFFERED);
+}
+
+//Partition of pageNum: stripes of BM_PARTITION_STRIPE adjacent pages spread by a Fibonacci hash
+BM_Partition *PartitionOf(BM_mgmtinfo *mgmt, PageNumber pageNum)
+{
+	unsigned int hash = (unsigned int)(pageNum / BM_PARTITION_STRIPE) * 2654435769u;
+	return &mgmt->parts[(hash >> 16) % mgmt->num_parts];
+}
+
+//Releases a partition, also one InitPartition gave up on half way
+void FreePartition(BM_Partition *part)
+{
+	BM_mgmtinfo *mgmt = MGMT(&part->pool);
+	if(mgmt != NULL)
+	{
+		if(mgmt->aio != NULL)
+		{
+			shutdownAsyncIO(mgmt->aio);
+			free(mgmt->wb_reqs);
+			free(mgmt->wb_arena);
+		}
+		if(mgmt->page_table != NULL)
+			freePageTable(mgmt->page_table);
+		free(mgmt->page_table);
+		free(mgmt->flush_batch);
+		FreePolicy(mgmt);
+		FreeAdaptive(mgmt);
+		free(mgmt);
+		part->pool.mgmtData = NULL;
+	}
+	pthread_cond_destroy(&part->loaded);
+	pthread_mutex_destroy(&part->latch);
+}
+
+//Sets up a partition over count frames of the pool from first on. It runs the pool's strategy
+//on its frames alone and has its own write-back engine: an engine's completions go to whoever
+//reaps them, so it cannot be shared between latches.
+RC InitPartition(BM_BufferPool *const bm, BM_Partition *part, int first, int count,
+		 ReplacementStrategy strategy, void *stratData)
+{
+	BM_mgmtinfo *pool = MGMT(bm);
+	BM_mgmtinfo *mgmt = (BM_mgmtinfo *)calloc(1, sizeof(BM_mgmtinfo));
+	BM_BufferPool *pbm = &part->pool;
+	void *arena;
+	int i, fd;
+	off_t offset;
+	RC rc;
+
+	pthread_mutex_init(&part->latch, NULL);
+	pthread_cond_init(&part->loaded, NULL);
+	pbm->pageFile = bm->pageFile;
+	pbm->numPages = count;
+	pbm->pageSize = bm->pageSize;
+	pbm->strategy = strategy;
+	pbm->mgmtData = mgmt;
+	if(mgmt == NULL)
+	{
+		FreePartition(part);
+		return RC_NO_MORE_SPACE_IN_BUFFER;
+	}
+
+	mgmt->fh = pool->fh;
+	mgmt->pool = pool;
+	mgmt->frames = pool->frames + first;
+	mgmt->handles = pool->handles + first;
+	mgmt->arena = pool->arena + (size_t)first * bm->pageSize;
+	mgmt->page_table = (BM_PageTable *)malloc(sizeof(BM_PageTable));
+	mgmt->flush_batch = (node_dll **)malloc(sizeof(node_dll *) * count);
+	if(mgmt->page_table == NULL || initPageTable(mgmt->page_table, count) != RC_OK)
+	{
+		free(mgmt->page_table);
+		mgmt->page_table = NULL;
+		FreePartition(part);
+		return RC_NO_MORE_SPACE_IN_BUFFER;
+	}
+	if(mgmt->flush_batch == NULL)
+	{
+		FreePartition(part);
+		return RC_NO_MORE_SPACE_IN_BUFFER;
+	}
+	mgmt->free_list = NULL;
+	for(i=count-1;i>=0;i--)
+	{
+		mgmt->frames[i].next = mgmt->free_list;
+		mgmt->free_list = &mgmt->frames[i];
+	}
+
+	// asynchronous eviction write-back, the pool stays synchronous if no engine can be started.
+	// Mapped files gain nothing from it and files without a descriptor (mem:) cannot use it.
+	mgmt->wb_error = RC_OK;
+	if(getPageLocation(mgmt->fh, 0, &fd, &offset) == RC_OK && initAsyncIO(&mgmt->aio, mgmt->fh, BM_WRITEBACK_SLOTS) == RC_OK)
+	{
+		mgmt->wb_reqs = (SM_IORequest *)malloc(sizeof(SM_IORequest) * BM_WRITEBACK_SLOTS);
+		if(mgmt->wb_reqs != NULL && posix_memalign(&arena, PAGE_SIZE, (size_t)BM_WRITEBACK_SLOTS * mgmt->fh->pageSize) == 0)
+		{
+			mgmt->wb_arena = (char *)arena;
+			for(i=BM_WRITEBACK_SLOTS-1;i>=0;i--)
+			{
+				mgmt->wb_reqs[i].pageNum = NO_PAGE;
+				mgmt->wb_reqs[i].memPage = mgmt->wb_arena + (size_t)i * mgmt->fh->pageSize;
+				mgmt->wb_reqs[i].next = mgmt->wb_free;
+				mgmt->wb_free = &mgmt->wb_reqs[i];
+			}
+		}
+		else
+		{
+			free(mgmt->wb_reqs);
+			mgmt->wb_reqs = NULL;
+			shutdownAsyncIO(mgmt->aio);
+			mgmt->aio = NULL;
+		}
+	}
+	mgmt->ra_last=NO_PAGE;
+
+	// RS_ADAPTIVE starts out as LRU
+	if(strategy==RS_ADAPTIVE)
+	{
+		rc = InitPolicy(mgmt, RS_LRU, NULL, count);
+		if(rc == RC_OK)
+			rc = InitAdaptive(pbm);
+	}
+	else
+		rc = InitPolicy(mgmt, strategy, stratData, count);
+	if(rc != RC_OK)
+		FreePartition(part);
+	return rc;
+}
+
+//Same as initBufferPool but opens the page file with the given storage manager I/O mode.
+//With SM_IO_MAPPED a miss is a memcpy out of the mapping, no syscall. With SM_IO_DIRECT
+//the pool is the only cache, the page aligned arena lets frames go to the device without a copy.
+RC initBufferPoolMode(BM_BufferPool *const bm, const char *const pageFileName,
+		  const int numPages, ReplacementStrategy strategy,
+		  void *stratData, SM_IOMode ioMode)
+{
+	int i, first, count;
+	RC rc;
 	BM_mgmtinfo *mgmt;
-	mgmt = (BM_mgmtinfo *)malloc(sizeof(BM_mgmtinfo));
+	void *arena = NULL;
+
+	if(numPages <= 0)
+		return RC_INVALID_BM;
+
+	mgmt = (BM_mgmtinfo *)calloc(1, sizeof(BM_mgmtinfo));
 	mgmt->fh = (SM_FileHandle *)malloc(sizeof(SM_FileHandle));
 
-	openPageFile(pageFileName, mgmt->fh);
-	mgmt->read_io=0;
-	mgmt->write_io=0;
-	mgmt->head=NULL;
-	bm->pageFile= pageFileName;
+	rc = openPageFileMode((char *)pageFileName, mgmt->fh, ioMode);
+	// one page aligned allocation backs every frame for the lifetime of the pool, frames are as big as the file's pages
+	if(rc == RC_OK && posix_memalign(&arena, PAGE_SIZE, (size_t)numPages * mgmt->fh->pageSize) != 0)
+	{
+		closePageFile(mgmt->fh);
+		rc = RC_NO_MORE_SPACE_IN_BUFFER;
+	}
+	if(rc != RC_OK)
+	{
+		free(mgmt->fh);
+		free(mgmt);
+		return rc;
+	}
+
+	mgmt->pool = mgmt;
+	mgmt->arena = (char *)arena;
+	mgmt->frames = (node_dll *)malloc(sizeof(node_dll) * numPages);
+	mgmt->handles = (BM_PageHandle *)malloc(sizeof(BM_PageHandle) * numPages);
+	for(i=numPages-1;i>=0;i--)
+	{
+		mgmt->handles[i].pageNum = NO_PAGE;
+		mgmt->handles[i].data = mgmt->arena + (size_t)i * mgmt->fh->pageSize;
+		mgmt->frames[i].pg = &mgmt->handles[i];
+		mgmt->frames[i].fixcount = 0;
+		mgmt->frames[i].is_dirty = 0;
+		pthread_rwlock_init(&mgmt->frames[i].latch, NULL);
+		mgmt->frames[i].version = 0;
+		mgmt->frames[i].latch_exclusive = 0;
+		mgmt->frames[i].loading = 0;
+		mgmt->frames[i].prefetched = 0;
+		mgmt->frames[i].in_ring = 0;
+		mgmt->frames[i].ref_count = 0;
+		mgmt->frames[i].lfu_freq = 0;
+		mgmt->frames[i].lfu_next = NULL;
+		mgmt->frames[i].lfu_prev = NULL;
+		mgmt->frames[i].khist = NULL;
+		mgmt->frames[i].arc = NULL;
+		mgmt->frames[i].storage_pg_number = NO_PAGE;
+		mgmt->frames[i].prev = NULL;
+		mgmt->frames[i].next = NULL;
+	}
+	pthread_rwlock_init(&mgmt->file_latch, NULL);
+	pthread_mutex_init(&mgmt->pool_latch, NULL);
+	mgmt->ra_last=NO_PAGE;
+	bm->pageFile= (char *)pageFileName;
 	bm->numPages= numPages;
+	bm->pageSize= mgmt->fh->pageSize;
 	bm->strategy= strategy;
 	bm->mgmtData = mgmt;
-	node_count=1;
+
+	// small pools stay in one partition, so eviction order is the strategy's over the whole pool
+	mgmt->num_parts = 1;
+	while(mgmt->num_parts < BM_MAX_PARTITIONS && numPages / (mgmt->num_parts * 2) >= BM_PARTITION_FRAMES)
+		mgmt->num_parts *= 2;
+	mgmt->parts = (BM_Partition *)calloc(mgmt->num_parts, sizeof(BM_Partition));
+	if(mgmt->parts == NULL)
+	{
+		mgmt->num_parts = 0;
+		shutdownBufferPool(bm);
+		return RC_NO_MORE_SPACE_IN_BUFFER;
+	}
+	for(i=0, first=0; i<mgmt->num_parts; i++, first+=count)
+	{
+		count = numPages / mgmt->num_parts + (i < numPages % mgmt->num_parts);
+		rc = InitPartition(bm, &mgmt->parts[i], first, count, strategy, stratData);
+		if(rc != RC_OK)
+		{
+			// the failed partition cleaned up after itself, unwind the ones set up before it
+			mgmt->num_parts = i;
+			shutdownBufferPool(bm);
+			return rc;
+		}
+	}
 	return RC_OK;
 }
 
 RC shutdownBufferPool(BM_BufferPool *const bm)
 {
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	RC rc;
+	int i;
+	for(i=0;i<bm->numPages;i++)
+		mgmt->frames[i].fixcount = 0;
+
+	rc = forceFlushPool(bm);
+	if(rc != RC_OK)
+		return rc;
+
+	for(i=0;i<mgmt->num_parts;i++)
+		FreePartition(&mgmt->parts[i]);
+	free(mgmt->parts);
+	closePageFile(mgmt->fh);
+	pthread_rwlock_destroy(&mgmt->file_latch);
+	pthread_mutex_destroy(&mgmt->pool_latch);
+	for(i=0;i<bm->numPages;i++)
+		pthread_rwlock_destroy(&mgmt->frames[i].latch);
+	free(mgmt->frames);
+	free(mgmt->handles);
+	free(mgmt->arena);
+	free(mgmt->fh);
+	free(mgmt);
+	bm->mgmtData = NULL;
+
+	return RC_OK;
+}
+//Orders frames by page number so forceFlushPool can find runs of adjacent pages
+int CompareFramePage(const void *a, const void *b) {
+	int pa = (*(node_dll *const *)a)->storage_pg_number;
+	int pb = (*(node_dll *const *)b)->storage_pg_number;
+	return (pa > pb) - (pa < pb);
+}
+
+//Writes back all dirty unpinned frames of a partition. They are sorted by page number and every run of
+//adjacent pages goes out as a single writeBlocksv, the write IO count stays per page.
+RC FlushPartition(BM_BufferPool *const pbm)
+{
+	BM_mgmtinfo *mgmt = MGMT(pbm);
 	node_dll *temp;
-	int page_found=0;
-	temp = ((BM_mgmtinfo *)bm->mgmtData)->head;
-	while(temp!=NULL)
+	node_dll **batch = mgmt->flush_batch;
+	SM_PageHandle pages[SM_MAX_IOV];
+	int count = 0;
+	int i, j, run;
+	RC rc;
+
+	rc = DrainWriteBacks(mgmt);
+	if(rc != RC_OK)
+		return rc;
+
+	for(temp = mgmt->head; temp != NULL; temp = temp->next)
 	{
-		temp->fixcount =0;
-		temp=temp->next;
+		if (temp->is_dirty==1 && FIX_COUNT(temp) == 0)
+			batch[count++] = temp;
 	}
+	qsort(batch, count, sizeof(node_dll *), CompareFramePage);
 
-	forceFlushPool(bm);
-	((BM_mgmtinfo *)bm->mgmtData)->fh = NULL;
-	bm->mgmtData = NULL;
+	for(i = 0; i < count; i += run)
+	{
+		run = 0;
+		do
+		{
+			pages[run] = batch[i+run]->pg->data;
+			run++;
+		} while(i+run < count && run < SM_MAX_IOV
+			&& batch[i+run]->storage_pg_number == batch[i]->storage_pg_number + run);
 
+		FileLatchWrite(mgmt, batch[i]->storage_pg_number + run - 1);
+		rc = writeBlocksv(batch[i]->storage_pg_number, run, mgmt->fh, pages);
+		FILE_RELEASE(mgmt);
+		if(rc != RC_OK)
+			return rc;
+		for(j = i; j < i+run; j++)
+			batch[j]->is_dirty = 0;
+		mgmt->write_io += run;
+	}
 	return RC_OK;
 }
+
+//Writes back all dirty unpinned frames, one partition at a time
 RC forceFlushPool(BM_BufferPool *const bm)
 {
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	BM_Partition *part;
+	RC rc;
+	int i;
+	for(i=0;i<mgmt->num_parts;i++)
+	{
+		part = &mgmt->parts[i];
+		BM_LOCK(part);
+		rc = FlushPartition(&part->pool);
+		BM_UNLOCK(part);
+		if(rc != RC_OK)
+			return rc;
+	}
+	return RC_OK;
+}
+
+//Hands out a page of the pool's file for new data: the lowest free page, or a new one at the end
+RC allocatePoolPage(BM_BufferPool *const bm, PageNumber *pageNum)
+{
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	RC rc;
+	FILE_EXCLUSIVE(mgmt);
+	rc = allocatePage(mgmt->fh, pageNum);
+	FILE_RELEASE(mgmt);
+	return rc;
+}
+
+//Gives a page of the pool's file back to the free page map. Its frame is emptied without a write,
+//nobody wants the content any more, and a write-back after the page was reused would be wrong.
+RC freePoolPage(BM_BufferPool *const bm, const PageNumber pageNum)
+{
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	BM_Partition *part = PartitionOf(mgmt, pageNum);
+	BM_mgmtinfo *pmgmt = MGMT(&part->pool);
 	node_dll *temp;
-	int page_found=0;
-	temp = ((BM_mgmtinfo *)bm->mgmtData)->head;
-	while(temp!=NULL)
+	RC rc;
+
+	BM_LOCK(part);
+	temp = FindNode(&part->pool, pageNum);
+	if(temp != NULL)
 	{
-		if (temp->is_dirty==1)
+		if(temp->loading || FIX_COUNT(temp) != 0)
 		{
-			if (temp->fixcount==0)
-			{
-				writeBlock (temp->storage_pg_number, ((BM_mgmtinfo *)bm->mgmtData)->fh,(SM_PageHandle) temp->pg->data);
-				temp->is_dirty=0;
-				((BM_mgmtinfo *)bm->mgmtData)->write_io += 1;
-			}
+			BM_UNLOCK(part);
+			return RC_PAGE_PINNED;
 		}
-		temp=temp->next;
-	}
-		//BM_UNLOCK();
-		return RC_OK;
+		temp->is_dirty = 0;
+		EvictFrame(pmgmt, temp);
+		ReturnFrame(pmgmt, temp);
 	}
+	BM_UNLOCK(part);
+
+	FILE_EXCLUSIVE(mgmt);
+	rc = freePage(mgmt->fh, pageNum);
+	FILE_RELEASE(mgmt);
+	return rc;
+}
+
+//Writes the pool back, then returns the space of the file's free pages to the file system. The
+//flush drains the write-backs in flight, none of them can grow the file again behind the trim.
+RC trimPoolFile(BM_BufferPool *const bm)
+{
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	RC rc = forceFlushPool(bm);
+	if(rc != RC_OK)
+		return rc;
+	FILE_EXCLUSIVE(mgmt);
+	rc = trimPageFile(mgmt->fh);
+	FILE_RELEASE(mgmt);
+	return rc;
+}
+
+//Finds the frame of a handle pinPage filled from where its data points in the arena, without a latch.
+//NULL if the handle does not point at the frame of its page.
+node_dll *HandleFrame(BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	node_dll *temp;
+	size_t offset;
+	if(page->data < mgmt->arena || page->data >= mgmt->arena + (size_t)bm->numPages * bm->pageSize)
+		return NULL;
+	offset = page->data - mgmt->arena;
+	if(offset % bm->pageSize != 0)
+		return NULL;
+	temp = &mgmt->frames[offset / bm->pageSize];
+	if(temp->storage_pg_number != page->pageNum)
+		return NULL;
+	return temp;
+}
 
 // Buffer Manager Interface Access Pages
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page)
 {
+	BM_Partition *part = PartitionOf(MGMT(bm), page->pageNum);
 	node_dll *temp;
-	int page_found=0;
-	temp = ((BM_mgmtinfo *)bm->mgmtData)->head;
-	while(temp!=NULL)
+	BM_LOCK(part);
+	temp = FindNode(&part->pool, page->pageNum);
+	if(temp!=NULL)
+		temp->is_dirty=1;
+	BM_UNLOCK(part);
+	if(temp==NULL)
+		return -1;
+	return RC_OK;
+}
+
+//The pin count drops without the latch. Only LRU-K keeps the unpinned frames apart (its victim
+//heap), a last unpin takes the latch for it and checks again: the page may be pinned once more.
+void DropPin(BM_Partition *part, node_dll *temp)
+{
+	BM_mgmtinfo *pmgmt = MGMT(&part->pool);
+	if(UNPIN_FRAME(temp) == 0 && (part->pool.strategy == RS_LRU_K || part->pool.strategy == RS_ADAPTIVE))
 	{
-		if (temp->storage_pg_number==page->pageNum)
-		{
-			temp->is_dirty=1;
-			page_found=1;
-			break;
-		}
-		temp=temp->next;
+		BM_LOCK(part);
+		if(FIX_COUNT(temp) == 0 && pmgmt->lru_k != NULL && temp->khist != NULL)
+			lruKUnpinned(pmgmt->lru_k, temp);
+		BM_UNLOCK(part);
 	}
-	//BM_UNLOCK();
-	if(page_found==1)
-		return RC_OK;
-	else
-		return -1;
 }
 
 RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page)
 {
-	node_dll *temp;
-	int page_found=0;
-	temp = ((BM_mgmtinfo *)bm->mgmtData)->head;
-	while(temp!=NULL)
+	BM_Partition *part = PartitionOf(MGMT(bm), page->pageNum);
+	node_dll *temp = HandleFrame(bm, page);
+	if(temp==NULL)
 	{
-		if (temp->storage_pg_number==page->pageNum)
-		{
-			temp->fixcount -= 1;
-			page_found=1;
-			break;
-		}
-		temp=temp->next;
+		BM_LOCK(part);
+		temp = FindNode(&part->pool, page->pageNum);
+		BM_UNLOCK(part);
+		if(temp==NULL)
+			return -1;
+	}
+	DropPin(part, temp);
+	return RC_OK;
+}
+
+//Latches the page of a handle pinPage filled. The partition latch is not taken: a latch holder may
+//pin more pages, and its pin keeps the frame, and so the page latch, from going to another page.
+RC latchPage (BM_BufferPool *const bm, BM_PageHandle *const page, BM_LatchMode mode)
+{
+	node_dll *temp = HandleFrame(bm, page);
+	if(temp==NULL || FIX_COUNT(temp) == 0)
+		return RC_NON_EXISTING_PAGE_IN_FRAME;
+	if(mode == BM_LATCH_EXCLUSIVE)
+	{
+		pthread_rwlock_wrlock(&temp->latch);
+		temp->latch_exclusive = 1;
+		// odd version: optimistic readers of the page retry, the writes come after it
+		__atomic_store_n(&temp->version, temp->version + 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
 	}
-	//BM_UNLOCK();
-	if(page_found==1)
-		return RC_OK;
 	else
-		return -1;
+		pthread_rwlock_rdlock(&temp->latch);
+	return RC_OK;
+}
+
+RC unlatchPage (BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+	node_dll *temp = HandleFrame(bm, page);
+	if(temp==NULL)
+		return RC_NON_EXISTING_PAGE_IN_FRAME;
+	if(temp->latch_exclusive)
+	{
+		temp->latch_exclusive = 0;
+		__atomic_store_n(&temp->version, temp->version + 1, __ATOMIC_RELEASE);
+	}
+	pthread_rwlock_unlock(&temp->latch);
+	return RC_OK;
+}
+
+//A seqlock over the page latch: the version is even unless a writer holds the latch. Waiting for a
+//writer is done on the latch (taken shared and dropped at once), not by spinning.
+RC beginOptimisticRead (BM_BufferPool *const bm, BM_PageHandle *const page, unsigned int *version)
+{
+	node_dll *temp = HandleFrame(bm, page);
+	if(temp==NULL || FIX_COUNT(temp) == 0)
+		return RC_NON_EXISTING_PAGE_IN_FRAME;
+	while((*version = __atomic_load_n(&temp->version, __ATOMIC_ACQUIRE)) % 2 != 0)
+	{
+		pthread_rwlock_rdlock(&temp->latch);
+		pthread_rwlock_unlock(&temp->latch);
+	}
+	return RC_OK;
+}
+
+bool validateOptimisticRead (BM_BufferPool *const bm, BM_PageHandle *const page, unsigned int version)
+{
+	node_dll *temp = HandleFrame(bm, page);
+	if(temp==NULL)
+		return 0;
+	// the reads of the page are done before the version is looked at again
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&temp->version, __ATOMIC_RELAXED) == version;
+}
+
+//pinPage and latchPage in one, the page is unpinned again if it cannot be latched
+RC PinLatched(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum, BM_LatchMode mode)
+{
+	RC rc = pinPage(bm, page, pageNum);
+	if(rc != RC_OK)
+		return rc;
+	rc = latchPage(bm, page, mode);
+	if(rc != RC_OK)
+		unpinPage(bm, page);
+	return rc;
+}
+
+RC pinPageShared (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+{
+	return PinLatched(bm, page, pageNum, BM_LATCH_SHARED);
+}
+
+RC pinPageExclusive (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+{
+	return PinLatched(bm, page, pageNum, BM_LATCH_EXCLUSIVE);
 }
 
-//data from the buffer to file
+//data from the buffer to file. The frame is pinned for the write and its page latch taken shared, so
+//a writer holding the page exclusively is done before the page goes out. The page latch comes before
+//the partition latch, as for a latch holder that pins pages: the caller must not hold it exclusively.
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page)
 {
+	BM_Partition *part = PartitionOf(MGMT(bm), page->pageNum);
 	node_dll *temp;
-	int page_found=0;
-	temp = ((BM_mgmtinfo *)bm->mgmtData)->head;
+	RC rc = -1;
+	BM_LOCK(part);
+	temp = FindNode(&part->pool, page->pageNum);
+	if(temp!=NULL && temp->is_dirty==1)
+		PIN_FRAME(temp);
+	else
+		temp = NULL;
+	BM_UNLOCK(part);
+	if(temp==NULL)
+		return rc;
+
+	// cleaned by someone else meanwhile is as good as written here
+	pthread_rwlock_rdlock(&temp->latch);
+	BM_LOCK(part);
+	rc = RC_OK;
+	if(temp->is_dirty==1)
+		rc = WriteBackFrame(MGMT(&part->pool), temp);
+	BM_UNLOCK(part);
+	pthread_rwlock_unlock(&temp->latch);
+	DropPin(part, temp);
+	return rc;
+}
+
+//Makes pageNum resident in a frame of the partition before its content is read: the frame is pinned
+//and flagged loading, so the latch can be let go for the read without the frame being evicted, and
+//pins of the page from other threads wait for it. Called with the latch held, like LoadDone.
+//ring is the partition's part of the caller's ring, NULL for a frame of the shared pool.
+RC ClaimFrame(BM_BufferPool *const pbm, PageNumber pageNum, bool prefetch, BM_RingPart *ring, node_dll **frame)
+{
+	BM_mgmtinfo *mgmt = MGMT(pbm);
+	node_dll *temp;
+	RC rc;
 
-	while(temp!=NULL)
+	if(mgmt->arc != NULL && !prefetch)
+		arcPrepare(mgmt->arc, pageNum);
+	rc = TakeFrame(pbm, ring, pageNum, &temp);
+	if(rc != RC_OK)
+		return rc;
+	// the read must not overtake a write-back of the page's old content
+	WaitWriteBack(mgmt, pageNum);
+
+	temp->storage_pg_number = pageNum;
+	temp->pg->pageNum = pageNum;
+	temp->is_dirty = 0;
+	temp->prefetched = prefetch;
+	temp->fixcount = 1;
+	temp->loading = 1;
+	mgmt->loads += 1;
+	// a ring page gets no reference, the CLOCK hand may take it on its first turn
+	temp->ref_count = temp->in_ring ? 0 : 1;
+	InsertAtTail(mgmt, temp);
+	*frame = temp;
+	return RC_OK;
+}
+
+//Ends the read of a claimed frame and wakes the threads waiting for it. A frame whose read failed
+//is given back, a prefetched one loses the pin ClaimFrame took, a pinned one keeps it.
+void LoadDone(BM_Partition *part, node_dll *temp, RC rc)
+{
+	BM_mgmtinfo *mgmt = MGMT(&part->pool);
+	temp->loading = 0;
+	mgmt->loads -= 1;
+	if(rc != RC_OK)
 	{
-		if (temp->storage_pg_number==page->pageNum)
-		{
-			if(temp->is_dirty==1)
-			{
-				writeBlock (temp->storage_pg_number, ((BM_mgmtinfo *)bm->mgmtData)->fh,page->data);
-				temp->is_dirty=0;
-				page_found=1;
-				break;
-			}
-		}
-		temp=temp->next;
+		temp->prefetched = 0;
+		temp->fixcount = 0;
+		EvictFrame(mgmt, temp);
+		ReturnFrame(mgmt, temp);
 	}
-	//BM_UNLOCK();
-	if(page_found==1)
+	else if(temp->prefetched)
 	{
-		((BM_mgmtinfo *)bm->mgmtData)->write_io += 1;
-		return RC_OK;
+		temp->fixcount = 0;
+		if(mgmt->lru_k != NULL)
+			lruKUnpinned(mgmt->lru_k, temp);
 	}
-	else
-		return -1;
+	pthread_cond_broadcast(&part->loaded);
+}
+
+//Fills a claimed frame from the file, without the partition latch. A page past the end of the file
+//is new: the file grows to it, with the file latch held exclusively, and the frame starts out empty.
+RC ReadFrame(BM_mgmtinfo *mgmt, node_dll *temp)
+{
+	int pageNum = temp->storage_pg_number;
+	RC rc;
+
+	FILE_SHARED(mgmt);
+	if(pageNum < mgmt->fh->totalNumPages)
+	{
+		rc = readBlock (pageNum, mgmt->fh, temp->pg->data);
+		FILE_RELEASE(mgmt);
+		__atomic_add_fetch(&mgmt->read_io, 1, __ATOMIC_RELAXED);
+		return rc;
+	}
+	FILE_RELEASE(mgmt);
+
+	// new page: extending the file already gives us its (empty) content
+	FILE_EXCLUSIVE(mgmt);
+	rc = ensureCapacity (pageNum+1, mgmt->fh);
+	FILE_RELEASE(mgmt);
+	memset(temp->pg->data, 0, mgmt->fh->pageSize);
+	return rc;
+}
+
+//Sequential detection: pins of ascending adjacent pages (repeated pins of the same page do not
+//break the run) start readahead once BM_READAHEAD_TRIGGER pages were seen. The window is kept
+//ahead of the scan, refilled when the scan gets within half a window of its end.
+//Readahead is a hint, a failed or partial prefetch is left to the pins that follow.
+//Through a ring the window shrinks to what prefetchPagesRing takes from it.
+void Readahead(BM_BufferPool *const bm, const PageNumber pageNum, BM_Ring *ring)
+{
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	int window, start = NO_PAGE;
+
+	pthread_mutex_lock(&mgmt->pool_latch);
+	window = mgmt->ra_pages;
+	if(pageNum != mgmt->ra_last)
+	{
+		if(mgmt->ra_last != NO_PAGE && pageNum == mgmt->ra_last + 1)
+			mgmt->ra_run += 1;
+		else
+		{
+			mgmt->ra_run = 1;
+			mgmt->ra_next = pageNum + 1;
+		}
+		mgmt->ra_last = pageNum;
+
+		if(ring != NULL && window > ring->size / 2)
+			window = ring->size / 2;
+		if(mgmt->ra_run >= BM_READAHEAD_TRIGGER && mgmt->ra_next - pageNum <= window / 2)
+		{
+			if(mgmt->ra_next <= pageNum)
+				mgmt->ra_next = pageNum + 1;
+			start = mgmt->ra_next;
+			mgmt->ra_next += window;
+		}
+	}
+	pthread_mutex_unlock(&mgmt->pool_latch);
+	if(start != NO_PAGE)
+		prefetchPagesRing(bm, start, window, ring);
 }
 
+//The ring's slots in partition part, NULL without a ring
+BM_RingPart *RingPartOf(BM_mgmtinfo *mgmt, BM_Ring *ring, BM_Partition *part)
+{
+	if(ring == NULL)
+		return NULL;
+	return &ring->parts[part - mgmt->parts];
+}
+
+//Pins go to the page's partition. A miss claims a frame with the latch held and reads the page
+//without it, so pins of other pages of the partition go on meanwhile.
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page,
 	    const PageNumber pageNum)
 {
-char emptyblock[PAGE_SIZE];
-int i;
-//BM_LOCK();
+	return pinPageRing(bm, page, pageNum, NULL);
+}
+
+//pinPage for a scan reading through its ring (see startRingAccess): a miss, and the readahead it
+//triggers, take the frame from the ring. A hit pins the page where it is. The scan's pins are not
+//sampled by RS_ADAPTIVE, they would make it pick a strategy for the scan instead of for the pool.
+RC pinPageRing (BM_BufferPool *const bm, BM_PageHandle *const page,
+	    const PageNumber pageNum, BM_Ring *ring)
+{
+RC rc;
+BM_mgmtinfo *mgmt = MGMT(bm);
+BM_Partition *part;
+BM_mgmtinfo *pmgmt;
 node_dll *temp;
-	temp = ((BM_mgmtinfo *)bm->mgmtData)->head;
-	int PAGE_FOUND=0;
-	if(pageNum >= ((BM_mgmtinfo *)bm->mgmtData)->fh->totalNumPages) //typecast void to the management info structure
+bool hit;
+
+	if(pageNum < 0)
+		return RC_INVALID_PAGE_NUMBER;
+	if(ring != NULL && ring->parts == NULL)
+		ring = NULL;
+	part = PartitionOf(mgmt, pageNum);
+	pmgmt = MGMT(&part->pool);
+
+	BM_LOCK(part);
+	for(;;)
 	{
-		ensureCapacity (pageNum+1, ((BM_mgmtinfo *)bm->mgmtData)->fh);
+		// a page another thread is reading: wait, the read may also fail and the page be gone
+		temp = FindNode(&part->pool, pageNum);
+		if(temp != NULL && temp->loading)
+		{
+			pthread_cond_wait(&part->loaded, &part->latch);
+			continue;
+		}
+		if(temp != NULL)
+			break;
+		// miss: take a free frame or evict one, then fill it from the file
+		rc = ClaimFrame(&part->pool, pageNum, 0, RingPartOf(mgmt, ring, part), &temp);
+		if(rc == RC_OK)
+			break;
+		// frames pinned only while a read (readahead mostly) is in flight are free again soon
+		if(rc != RC_NO_MORE_SPACE_IN_BUFFER || pmgmt->loads == 0)
+		{
+			BM_UNLOCK(part);
+			return rc;
+		}
+		pthread_cond_wait(&part->loaded, &part->latch);
 	}
+	hit = !temp->loading;
+	if(hit)
+		PIN_FRAME(temp);
 	else
 	{
-		if(temp!=NULL)
+		BM_UNLOCK(part);
+		rc = ReadFrame(pmgmt, temp);
+		BM_LOCK(part);
+		LoadDone(part, temp, rc);
+		if(rc != RC_OK)
 		{
-			while (temp!=NULL)
-				{
-					if(temp->storage_pg_number==pageNum)
-					{
-						PAGE_FOUND=1;
-						break;
-					}
-					else
-					{
-						temp=temp->next;
-					}
-				}
-
+			BM_UNLOCK(part);
+			return rc;
 		}
 	}
-	if(PAGE_FOUND==0)
+	PolicyPin(&part->pool, temp, hit);
+	temp->prefetched = 0;
+	if(pmgmt->adaptive != NULL && ring == NULL)
+		AdaptiveSample(&part->pool, pageNum);
+	BM_UNLOCK(part);
+
+	page->data=temp->pg->data;
+	page->pageNum = pageNum;
+
+	// the page is pinned now, reading ahead cannot evict it
+	if(mgmt->ra_pages > 0)
+		Readahead(bm, pageNum, ring);
+	return RC_OK;
+}
+
+//prefetchPages within one partition, called with its latch held. Each run of adjacent missing
+//pages is claimed, read with one readBlocksv without the latch, then handed to the strategy.
+RC PrefetchPartition(BM_Partition *part, const PageNumber startPage, int count, BM_RingPart *ring)
+{
+	BM_BufferPool *pbm = &part->pool;
+	BM_mgmtinfo *mgmt = MGMT(pbm);
+	node_dll *frames[SM_MAX_IOV];
+	SM_PageHandle pages[SM_MAX_IOV];
+	int pageNum = startPage;
+	int end, run, j;
+	bool pool_full = 0;
+	RC rc;
+
+	// through a ring the frames it fills come out of the ring
+	if(ring != NULL && count > ring->size / 2)
+		count = ring->size / 2;
+	if(count > pbm->numPages / 2)
+		count = pbm->numPages / 2;
+	end = startPage + count;
+	FILE_SHARED(mgmt);
+	if(end > mgmt->fh->totalNumPages)
+		end = mgmt->fh->totalNumPages;
+	FILE_RELEASE(mgmt);
+
+	while(pageNum < end && !pool_full)
 	{
-		if(node_count < bm->numPages)
+		if(FindNode(pbm, pageNum) != NULL)
 		{
-			((BM_mgmtinfo *)bm->mgmtData)->head = InsertAtTail(((BM_mgmtinfo *)bm->mgmtData)->head, pageNum);
-			temp = ((BM_mgmtinfo *)bm->mgmtData)->head;
-			if(temp->next!=NULL)
-			{
-				while(temp->next!=NULL)
-				{
-					temp=temp->next;
-				}
-			}
+			pageNum++;
+			continue;
 		}
-		else
+
+		run = 0;
+		while(pageNum+run < end && run < SM_MAX_IOV && FindNode(pbm, pageNum+run) == NULL)
 		{
-			strategy(bm, pageNum);
-			temp = ((BM_mgmtinfo *)bm->mgmtData)->head;
-			while(temp->next!=NULL)
+			if(ClaimFrame(pbm, pageNum+run, 1, ring, &frames[run]) != RC_OK)
 			{
-				temp=temp->next;
+				pool_full = 1;
+				break;
 			}
+			pages[run] = frames[run]->pg->data;
+			run++;
 		}
+		if(run == 0)
+			break;
+
+		BM_UNLOCK(part);
+		FILE_SHARED(mgmt);
+		rc = readBlocksv(pageNum, run, mgmt->fh, pages);
+		FILE_RELEASE(mgmt);
+		BM_LOCK(part);
+		for(j = 0; j < run; j++)
+			LoadDone(part, frames[j], rc);
+		if(rc != RC_OK)
+			return rc;
+		__atomic_add_fetch(&mgmt->read_io, run, __ATOMIC_RELAXED);
+		mgmt->prefetched += run;
+		pageNum += run;
 	}
-	temp->fixcount += 1;
+	return RC_OK;
+}
 
-	//Read file data into the Buffer
-	for (i=0;i<PAGE_SIZE;i++)
-		emptyblock[i]=0;
+//Reads the pages of [startPage, startPage+count) that are not resident into unpinned frames,
+//each run of adjacent missing pages with one readBlocksv. Sequential scans call it so the pins
+//that follow are hits. It fills at most half the pool so it never evicts what it just loaded,
+//and stops early without an error when every frame is pinned.
+//Pages it reads count as prefetched until their first pin, see getNumPrefetchUnused.
+RC prefetchPages(BM_BufferPool *const bm, const PageNumber startPage, int count)
+{
+	return prefetchPagesRing(bm, startPage, count, NULL);
+}
 
-	temp->pg->data=emptyblock;
-	readBlock (pageNum, ((BM_mgmtinfo *)bm->mgmtData)->fh,  temp->pg->data);
-	page->data=temp->pg->data;
-	page->pageNum = pageNum;
+//prefetchPages into the frames of a ring, at most half of them so the pages are not recycled
+//before the scan gets to them
+RC prefetchPagesRing(BM_BufferPool *const bm, const PageNumber startPage, int count, BM_Ring *ring)
+{
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	BM_Partition *part;
+	int pageNum, end, chunk;
+	RC rc = RC_OK;
 
-	if(PAGE_FOUND==0)
+	if(startPage < 0)
+		return RC_INVALID_PAGE_NUMBER;
+	if(ring != NULL && ring->parts == NULL)
+		ring = NULL;
+	if(ring != NULL && count > ring->size / 2)
+		count = ring->size / 2;
+	if(count > bm->numPages / 2)
+		count = bm->numPages / 2;
+	end = startPage + count;
+
+	// every partition reads its own stripes
+	for(pageNum = startPage; pageNum < end && rc == RC_OK; pageNum += chunk)
 	{
-		((BM_mgmtinfo *)bm->mgmtData)->read_io +=  1;
+		chunk = end - pageNum;
+		if(mgmt->num_parts > 1 && chunk > BM_PARTITION_STRIPE - pageNum % BM_PARTITION_STRIPE)
+			chunk = BM_PARTITION_STRIPE - pageNum % BM_PARTITION_STRIPE;
+		part = PartitionOf(mgmt, pageNum);
+		BM_LOCK(part);
+		rc = PrefetchPartition(part, pageNum, chunk, RingPartOf(mgmt, ring, part));
+		BM_UNLOCK(part);
 	}
+	return rc;
+}
 
-	node_dll *temp_last;
-	node_dll *temp_trav;
-	node_dll *temp_prev;
-	node_dll *temp_next;
-
-	if(temp->prev != NULL)
-		temp_prev=temp->prev;
-
-	if(temp->next != NULL)
-		temp_next=temp->next;
+//Turns sequential detection on with a window of pages read ahead, 0 turns it off (the default)
+RC setReadahead(BM_BufferPool *const bm, int pages)
+{
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	if(mgmt == NULL)
+		return RC_INVALID_BM;
+	pthread_mutex_lock(&mgmt->pool_latch);
+	mgmt->ra_pages = (pages > 0) ? pages : 0;
+	mgmt->ra_run = 0;
+	mgmt->ra_last = NO_PAGE;
+	pthread_mutex_unlock(&mgmt->pool_latch);
+	return RC_OK;
+}
 
-	temp_trav=temp;
-	if(bm->strategy==RS_LRU ||bm->strategy==RS_LRU_K )
+//Sets up a ring of ringPages frames for one scan (at most half the pool) and pinPageRing reads
+//through it until endRingAccess: pages read on a miss (or read ahead) go to frames the ring
+//recycles in turn, see TakeFrame. Large scans use it so they do not flush the pages everyone else
+//needs. Every scan has a ring of its own, any number of them may run at once.
+RC startRingAccess(BM_BufferPool *const bm, BM_Ring *ring, int ringPages)
+{
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	BM_RingPart *rp;
+	int i;
+	if(mgmt == NULL)
+		return RC_INVALID_BM;
+	if(ringPages > bm->numPages / 2)
+		ringPages = bm->numPages / 2;
+	if(ringPages < 1)
+		ringPages = 1;
+	ring->size = ringPages;
+	ring->num_parts = mgmt->num_parts;
+	ring->parts = (BM_RingPart *)calloc(mgmt->num_parts, sizeof(BM_RingPart));
+	if(ring->parts == NULL)
+		return RC_NO_MORE_SPACE_IN_BUFFER;
+	for(i=0;i<mgmt->num_parts;i++)
 	{
-		if(temp->next!=NULL)
+		rp = &ring->parts[i];
+		rp->size = ringPages;
+		if(rp->size > mgmt->parts[i].pool.numPages / 2)
+			rp->size = mgmt->parts[i].pool.numPages / 2;
+		if(rp->size < 1)
+			rp->size = 1;
+		rp->frames = (node_dll **)calloc(rp->size, sizeof(node_dll *));
+		rp->pages = (PageNumber *)malloc(sizeof(PageNumber) * rp->size);
+		if(rp->frames == NULL || rp->pages == NULL)
 		{
-			while(temp_trav->next!=NULL)
-			{
-				temp_trav=temp_trav->next;
-			}
+			endRingAccess(bm, ring);
+			return RC_NO_MORE_SPACE_IN_BUFFER;
+		}
+	}
+	return RC_OK;
+}
 
-			if(temp->prev != NULL)
-			{
-				temp_last=temp_trav;
-				temp_prev->next=temp_next;
-				temp_next->prev=temp_prev;
-				temp->prev=temp_last;
-				temp_last->next=temp;
-				temp->next=NULL;
-			}
-			else
+//endRingAccess within one partition, called with its latch held
+void EndRing(BM_BufferPool *const pbm, BM_RingPart *ring)
+{
+	BM_mgmtinfo *mgmt = MGMT(pbm);
+	node_dll *temp;
+	int i;
+	for(i=0;i<ring->size;i++)
+	{
+		if(!RING_HOLDS(ring, i))
+			continue;
+		temp = ring->frames[i];
+		temp->in_ring = 0;
+		temp->ref_count = 0;
+		if(FIX_COUNT(temp) == 0)
+		{
+			MoveToHead(mgmt, temp);
+			if(mgmt->lfu_head != NULL)
 			{
-				temp_next=temp->next;
-				temp_last=temp_trav;
-				temp->next=NULL;
-				temp_next->prev=NULL;
-				temp_last->next=temp;
-				temp->prev=temp_last;
-				((BM_mgmtinfo *)bm->mgmtData)->head = temp_next;
+				LfuRemove(mgmt, temp);
+				LfuInsert(mgmt, temp, 0);
 			}
+			if(mgmt->lru_k != NULL)
+				lruKDemote(mgmt->lru_k, temp);
+			if(mgmt->arc != NULL)
+				arcDemote(mgmt->arc, temp);
 		}
 	}
+}
 
-	 //BM_UNLOCK();
+//Ends a ring. Its unpinned pages move to the eviction end of the pool and of every strategy's
+//order, so the next misses reuse them first.
+RC endRingAccess(BM_BufferPool *const bm, BM_Ring *ring)
+{
+	BM_mgmtinfo *mgmt = MGMT(bm);
+	int i;
+	if(mgmt == NULL || ring->parts == NULL)
+		return RC_INVALID_BM;
+	for(i=0;i<ring->num_parts;i++)
+	{
+		if(ring->parts[i].frames != NULL && ring->parts[i].pages != NULL)
+		{
+			BM_LOCK(&mgmt->parts[i]);
+			EndRing(&mgmt->parts[i].pool, &ring->parts[i]);
+			BM_UNLOCK(&mgmt->parts[i]);
+		}
+		free(ring->parts[i].frames);
+		free(ring->parts[i].pages);
+	}
+	free(ring->parts);
+	ring->parts = NULL;
+	ring->num_parts = 0;
 	return RC_OK;
 }
 
 //returns the number of read IO done
 int getNumReadIO (BM_BufferPool *const bm)
 {
+	int i, n = 0;
 	if(bm->mgmtData != NULL)
-		return ((BM_mgmtinfo *)bm->mgmtData)->read_io;
-	else
-		return 0;
+		for(i=0;i<MGMT(bm)->num_parts;i++)
+			n += MGMT(&MGMT(bm)->parts[i].pool)->read_io;
+	return n;
 }
 // returns the number of writes IO done
 int getNumWriteIO (BM_BufferPool *const bm)
 {
+	int i, n = 0;
+	if(bm->mgmtData != NULL)
+		for(i=0;i<MGMT(bm)->num_parts;i++)
+			n += MGMT(&MGMT(bm)->parts[i].pool)->write_io;
+	return n;
+}
+
+//returns the number of pages read ahead
+int getNumPrefetched (BM_BufferPool *const bm)
+{
+	int i, n = 0;
 	if(bm->mgmtData != NULL)
-		return ((BM_mgmtinfo *)bm->mgmtData)->write_io;
+		for(i=0;i<MGMT(bm)->num_parts;i++)
+			n += MGMT(&MGMT(bm)->parts[i].pool)->prefetched;
+	return n;
+}
+
+//returns the number of pages read ahead and evicted before anyone pinned them
+int getNumPrefetchUnused (BM_BufferPool *const bm)
+{
+	int i, n = 0;
+	if(bm->mgmtData != NULL)
+		for(i=0;i<MGMT(bm)->num_parts;i++)
+			n += MGMT(&MGMT(bm)->parts[i].pool)->prefetch_unused;
+	return n;
+}
+
+//returns how many partitions the pool is split into, 0 when it is not initialized
+int getNumPartitions (BM_BufferPool *const bm)
+{
+	if(bm->mgmtData != NULL)
+		return MGMT(bm)->num_parts;
 	else
 		return 0;
 }
 
-PageNumber *getFrameContents (BM_BufferPool *const bm)
+//strategy partition part runs now, the one RS_ADAPTIVE switched to last in that partition
+ReplacementStrategy getPartitionStrategy (BM_BufferPool *const bm, int part)
 {
-	node_dll *temp=((BM_mgmtinfo *)bm->mgmtData)->head;
-	int i = bm->numPages;
-	PageNumber *pn;//array that should be return
-
-	if(((BM_mgmtinfo *)bm->mgmtData)->head == NULL)
-		return (PageNumber)-1;
-		//return NO_PAGE;
+	BM_Partition *p;
+	ReplacementStrategy policy;
+	if(bm->mgmtData == NULL || part < 0 || part >= MGMT(bm)->num_parts)
+		return bm->strategy;
+	p = &MGMT(bm)->parts[part];
+	pthread_mutex_lock(&p->latch);
+	policy = MGMT(&p->pool)->policy;
+	pthread_mutex_unlock(&p->latch);
+	return policy;
+}
 
-	pn = (PageNumber *)malloc(sizeof(PageNumber)*bm->numPages);
-	while(i >= 0)
+//strategy the pool runs now: the one most partitions run, on a tie the one of the first of them.
+//RS_ADAPTIVE switches each partition on its own pins, getPartitionStrategy tells them apart.
+ReplacementStrategy getActiveStrategy (BM_BufferPool *const bm)
+{
+	int count[RS_ADAPTIVE+1] = {0};
+	ReplacementStrategy policy, best;
+	int i;
+	if(bm->mgmtData == NULL)
+		return bm->strategy;
+	best = getPartitionStrategy(bm, 0);
+	for(i=0;i<MGMT(bm)->num_parts;i++)
 	{
-		pn[i] = -1;
-		i--;
+		policy = getPartitionStrategy(bm, i);
+		if(++count[policy] > count[best])
+			best = policy;
 	}
+	return best;
+}
 
-	i = 0;
-	while (temp!= NULL)//going to each node
+//returns how many times RS_ADAPTIVE switched strategies, in all partitions
+int getNumStrategySwitches (BM_BufferPool *const bm)
+{
+	BM_mgmtinfo *pmgmt;
+	int i, n = 0;
+	if(bm->mgmtData != NULL)
+		for(i=0;i<MGMT(bm)->num_parts;i++)
+		{
+			pmgmt = MGMT(&MGMT(bm)->parts[i].pool);
+			if(pmgmt->adaptive != NULL)
+				n += pmgmt->adaptive->switches;
+		}
+	return n;
+}
+
+//hit ratio of strategy's shadow pools on the sampled pins so far, -1 when it is not simulated
+double getSimulatedHitRatio (BM_BufferPool *const bm, ReplacementStrategy strategy)
+{
+	BM_Adaptive *ad;
+	long hits = 0, refs = 0;
+	int i, c;
+	if(bm->mgmtData == NULL || bm->strategy != RS_ADAPTIVE)
+		return -1;
+	for(c=0;c<BM_ADAPTIVE_CANDIDATES && AdaptiveCandidates[c] != strategy;c++)
+		;
+	if(c == BM_ADAPTIVE_CANDIDATES)
+		return -1;
+	for(i=0;i<MGMT(bm)->num_parts;i++)
 	{
-		pn[i] = temp->storage_pg_number;//checking if page handle has a value
-		i++;
-		temp = temp->next;//next
+		ad = MGMT(&MGMT(bm)->parts[i].pool)->adaptive;
+		hits += ad->hits[c];
+		refs += ad->refs;
 	}
+	return (refs > 0) ? (double)hits / refs : 0;
+}
+
+PageNumber *getFrameContents (BM_BufferPool *const bm)
+{
+	int i;
+	PageNumber *pn;//array that should be return
+	BM_mgmtinfo *mgmt = MGMT(bm);
+
+	pn = (PageNumber *)malloc(sizeof(PageNumber)*bm->numPages);
+	for (i = 0; i < bm->numPages; i++)//going to each frame
+		pn[i] = mgmt->frames[i].storage_pg_number;
 
 	return pn;
 }
@@ -469,26 +1830,13 @@ PageNumber *getFrameContents (BM_BufferPool *const bm)
 //returns whether the page is dirty or not
 bool *getDirtyFlags (BM_BufferPool *const bm)
 {
-	int i = 0, n;
+	int i;
 	bool *dirt;//array that should be return
-	node_dll *temp;
-	temp = ((BM_mgmtinfo *)bm->mgmtData)->head;//Initialization to the start of the buffer
-	n = bm->numPages;
+	BM_mgmtinfo *mgmt = MGMT(bm);
 
-	dirt = (bool *)malloc(sizeof(bool)*n);
-	while(i < n)
-	{
-		dirt[i] = FALSE;
-		i++;
-	}
-	i = 0;
-	while (temp != NULL)//going to each node
-	{
-		if(temp->is_dirty)
-			dirt[i] = TRUE;//storing the dirty values in the array
-		i++;
-		temp=temp->next;
-	}
+	dirt = (bool *)malloc(sizeof(bool)*bm->numPages);
+	for (i = 0; i < bm->numPages; i++)//going to each frame
+		dirt[i] = mgmt->frames[i].is_dirty ? TRUE : FALSE;
 
 	return dirt;
 }
@@ -496,27 +1844,13 @@ bool *getDirtyFlags (BM_BufferPool *const bm)
 //returns the number of present request on a particular page
 int *getFixCounts (BM_BufferPool *const bm)
 {
-	node_dll *temp;
-	int i = 0, n;
-    int *fix;//array that should be return
-    temp = ((BM_mgmtinfo *)bm->mgmtData)->head;
-    n = bm->numPages;
-
-    fix = (int *)malloc(sizeof(int)*n);
-	//setting all fix as zero
-    while(i < n)
-    {
-    	fix[i] = 0;
-    	i++;
-    }
-
-    i = 0;
-    while (temp!= NULL)//going to each node
-    {
-    	if(temp->fixcount > 0)
-        	fix[i] = temp->fixcount;//storing the dirty values in the array
-        i++;
-        temp=temp->next;
-    }
-    return fix;
+	int i;
+	int *fix;//array that should be return
+	BM_mgmtinfo *mgmt = MGMT(bm);
+
+	fix = (int *)malloc(sizeof(int)*bm->numPages);
+	for (i = 0; i < bm->numPages; i++)//going to each frame
+		fix[i] = FIX_COUNT(&mgmt->frames[i]);
+
+	return fix;
 }
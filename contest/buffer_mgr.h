@@ -8,27 +8,82 @@
 // Include bool DT
 #include "dt.h"
 
+#include <pthread.h>
+
 // Replacement Strategies
 typedef enum ReplacementStrategy {
   RS_FIFO = 0,
   RS_LRU = 1,
   RS_CLOCK = 2,
   RS_LFU = 3,
-  RS_LRU_K = 4
+  RS_LRU_K = 4,
+  RS_GCLOCK = 5,
+  RS_ARC = 6,
+  RS_ADAPTIVE = 7
 } ReplacementStrategy;
 
 // Data Types and Structures
+// Page numbers are int, here and in SM_FileHandle.totalNumPages and RID.page, so a page file
+// holds at most 2^31 - 1 pages (8 TB at 4 KB pages). Byte offsets are 64-bit off_t throughout.
 typedef int PageNumber;
 #define NO_PAGE -1
 
+// evicted dirty pages that can be written back while the pool goes on reading
+#define BM_WRITEBACK_SLOTS 8
+
+// GCLOCK usage count limit when stratData does not point to an int giving one
+#define BM_GCLOCK_MAX 4
+
+// LFU counts saturate at BM_LFU_MAX_FREQ, all of them are halved every
+// BM_LFU_AGING_PINS pins per frame so popularity that is not renewed fades
+#define BM_LFU_MAX_FREQ 32
+#define BM_LFU_AGING_PINS 16
+
+// LRU-K: K when stratData does not point to an int giving one, and how many
+// pages' reference histories are kept per frame (the rest are of evicted pages)
+#define BM_LRU_K_DEFAULT 2
+#define BM_LRU_K_HISTORY 4
+
+// RS_ADAPTIVE: the pins of 1 in up to BM_ADAPTIVE_SAMPLE pages (as long as that leaves
+// BM_ADAPTIVE_MIN_SHADOW frames to a shadow pool) are replayed on shadow pools, one per
+// candidate strategy, that hold page numbers only. Every BM_ADAPTIVE_EPOCH sampled pins the
+// pool switches to the best candidate if its shadow had more hits than the one of the strategy
+// in effect by BM_ADAPTIVE_MARGIN percent of those pins.
+#define BM_ADAPTIVE_SAMPLE 16
+#define BM_ADAPTIVE_MIN_SHADOW 64
+#define BM_ADAPTIVE_EPOCH 1024
+#define BM_ADAPTIVE_MARGIN 5
+
+// Pools of at least 2*BM_PARTITION_FRAMES frames are split into up to BM_MAX_PARTITIONS
+// partitions, each with its own latch, page table and strategy state, so threads pinning
+// different pages rarely wait for each other. Pages are dealt to partitions
+// BM_PARTITION_STRIPE adjacent pages at a time, which keeps readahead runs vectored.
+// The frames are sliced statically: partition i gets the next numPages / partitions frames
+// (the first numPages % partitions get one more) for the life of the pool. A partition whose
+// pages are hot cannot take frames from a cold one, and the strategy, RS_ADAPTIVE's choice
+// included, evicts within a partition only.
+#define BM_PARTITION_FRAMES 64
+#define BM_MAX_PARTITIONS 8
+#define BM_PARTITION_STRIPE 8
+
+// readahead starts once this many adjacent pages were pinned in ascending order
+#define BM_READAHEAD_TRIGGER 2
+
 typedef struct BM_BufferPool {
   char *pageFile;
   int numPages;
+  int pageSize; // bytes per frame, the page size of pageFile
   ReplacementStrategy strategy;
   void *mgmtData; // use this one to store the bookkeeping info your buffer 
                   // manager needs for a buffer pool
 } BM_BufferPool;
 
+// Page latches, see latchPage
+typedef enum BM_LatchMode {
+  BM_LATCH_SHARED = 0,
+  BM_LATCH_EXCLUSIVE = 1
+} BM_LatchMode;
+
 typedef struct BM_PageHandle {
   PageNumber pageNum;
   char *data;
@@ -37,21 +92,99 @@ typedef struct BM_PageHandle {
 typedef struct node
 {
 	BM_PageHandle *pg;
-	int fixcount;
+	int fixcount;		// atomic, unpinPage changes it without the latch
 	bool is_dirty;
+	pthread_rwlock_t latch;	// page latch, taken by latchPage without the partition latch
+	unsigned int version;	// atomic, odd while the latch is held exclusive, see beginOptimisticRead
+	bool latch_exclusive;	// the latch is held exclusive
+	bool loading;		// being read outside the latch, the reading thread holds a pin
+	bool prefetched;	// read ahead and not pinned since
+	bool in_ring;		// filled through a ring, the ring may recycle it
+	int ref_count;		// CLOCK reference bit, GCLOCK usage count
+	int lfu_freq;		// LFU bucket the frame is in
+	struct node *lfu_next;	// neighbours in the LFU bucket
+	struct node *lfu_prev;
+	struct BM_KHistory *khist;	// LRU-K history of the page
+	struct BM_ArcEntry *arc;	// ARC list entry of the page
 	int storage_pg_number;
 	struct node *next;
 	struct node *prev;
 }node_dll;
 
+// A pool is a set of partitions (see BM_Partition) sharing the file and the frames. The pool's own
+// mgmtinfo keeps the file, the frames and the readahead state, the rest of the fields are used in
+// the partitions' ones.
 typedef struct mgmtinfo {
 	SM_FileHandle *fh;
+	struct mgmtinfo *pool;	// the pool a partition belongs to (the pool itself for the pool)
+	struct BM_Partition *parts;	// pool only
+	int num_parts;
+	pthread_rwlock_t file_latch;	// pool only: page I/O holds it shared, growing the file exclusive
+	pthread_mutex_t pool_latch;	// pool only: readahead state
+	ReplacementStrategy policy;	// strategy in effect, the one RS_ADAPTIVE picked last
 	int read_io;
 	int write_io;
 	node_dll *head;
-	//pthread_mutex_t bm_mutex;
+	node_dll *tail;
+	struct BM_PageTable *page_table; // page number -> node_dll of every resident page
+	node_dll *frames;	// fixed array of numPages frames, frame i holds arena + i*pageSize
+	BM_PageHandle *handles;
+	char *arena;		// page aligned memory backing all frames
+	node_dll *free_list;	// frames not holding a page, chained through next
+	node_dll **flush_batch;	// scratch array of numPages frames for forceFlushPool
+	struct SM_AsyncIO *aio;	// NULL when evictions write back synchronously
+	char *wb_arena;		// BM_WRITEBACK_SLOTS staging pages for evicted dirty frames
+	struct SM_IORequest *wb_reqs;	// one request per staging page, pageNum is NO_PAGE when free
+	struct SM_IORequest *wb_free;	// free staging slots chained through next
+	int wb_in_flight;
+	RC wb_error;		// first failed asynchronous write-back, returned by forceFlushPool
+	int ra_pages;		// readahead window, 0 turns sequential detection off
+	int ra_last;		// last page pinned
+	int ra_run;		// adjacent ascending pages pinned up to ra_last
+	int ra_next;		// first page of the current run not read ahead yet
+	int prefetched;		// pages read by prefetchPages
+	int prefetch_unused;	// of those, evicted without ever being pinned
+	int loads;		// frames being read without the latch, see ClaimFrame
+	int clock_hand;		// next frame the CLOCK hand looks at
+	int clock_max;		// highest ref_count, 1 for CLOCK
+	node_dll **lfu_head;	// LFU only: BM_LFU_MAX_FREQ+1 buckets, oldest frame of each first
+	node_dll **lfu_tail;
+	int lfu_min;		// no bucket below it holds a frame
+	int lfu_pins;		// pins since the counts were last halved
+	struct BM_LruK *lru_k;	// LRU-K only: histories and the victim heap
+	struct BM_Arc *arc;	// ARC only: T1/T2, the ghost lists and the target p
+	struct BM_Adaptive *adaptive;	// RS_ADAPTIVE only: the shadow pools and their hit counts
 }BM_mgmtinfo;
 
+// pin count of a frame: unpinPage drops it without the latch, the latch holder reads it with this
+#define FIX_COUNT(frame) __atomic_load_n(&(frame)->fixcount, __ATOMIC_ACQUIRE)
+
+// A partition is run as a pool of its own over a slice of the frames. Its latch guards the page
+// table, the frame list and the strategy state, page reads are done without it.
+typedef struct BM_Partition {
+	pthread_mutex_t latch;
+	pthread_cond_t loaded;	// broadcast when pages read without the latch are in
+	BM_BufferPool pool;
+} BM_Partition;
+
+// The frames of a ring in one partition. Only the thread that owns the ring uses it, with the
+// partition's latch held.
+typedef struct BM_RingPart {
+	int size;		// slots, at most half the partition's frames
+	int pos;		// next slot to recycle
+	node_dll **frames;	// NULL while a slot was not filled yet
+	PageNumber *pages;	// the page each frame was filled with, the strategy may have reused it since
+} BM_RingPart;
+
+// A ring of frames one scan recycles in turn, see pinPageRing. Frames never leave their partition,
+// so the ring has size slots in each one: a scan over a striped pool can take a full readahead
+// window from whichever partition it is in.
+typedef struct BM_Ring {
+	int size;		// frames per partition, readahead through the ring fills at most half of them
+	int num_parts;
+	BM_RingPart *parts;	// NULL when the ring is not started
+} BM_Ring;
+
 // convenience macros
 #define MAKE_POOL()					\
   ((BM_BufferPool *) malloc (sizeof(BM_BufferPool)))
@@ -63,6 +196,9 @@ typedef struct mgmtinfo {
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
 		  const int numPages, ReplacementStrategy strategy, 
 		  void *stratData);
+RC initBufferPoolMode(BM_BufferPool *const bm, const char *const pageFileName,
+		  const int numPages, ReplacementStrategy strategy,
+		  void *stratData, SM_IOMode ioMode);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
 
@@ -72,6 +208,37 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 	    const PageNumber pageNum);
+RC prefetchPages (BM_BufferPool *const bm, const PageNumber startPage, int count);
+RC setReadahead (BM_BufferPool *const bm, int pages);
+RC startRingAccess (BM_BufferPool *const bm, BM_Ring *ring, int ringPages);
+RC endRingAccess (BM_BufferPool *const bm, BM_Ring *ring);
+RC pinPageRing (BM_BufferPool *const bm, BM_PageHandle *const page,
+	    const PageNumber pageNum, BM_Ring *ring);
+RC prefetchPagesRing (BM_BufferPool *const bm, const PageNumber startPage, int count, BM_Ring *ring);
+
+// Page allocation on the pool's file, under its file latch. freePoolPage drops the page from the
+// pool without writing it back, it fails with RC_PAGE_PINNED while the page is pinned. trimPoolFile
+// flushes the pool, then gives the space of the free pages back (trimPageFile).
+RC allocatePoolPage (BM_BufferPool *const bm, PageNumber *pageNum);
+RC freePoolPage (BM_BufferPool *const bm, const PageNumber pageNum);
+RC trimPoolFile (BM_BufferPool *const bm);
+
+// Page latches: a pin keeps a page in the pool, a latch guards its data. Readers of a pinned page
+// share its latch, a writer holds it alone. The latch must be released with unlatchPage before the
+// page is unpinned. Writers of a page unpinned with a latch never taken race with everyone.
+RC latchPage (BM_BufferPool *const bm, BM_PageHandle *const page, BM_LatchMode mode);
+RC unlatchPage (BM_BufferPool *const bm, BM_PageHandle *const page);
+RC pinPageShared (BM_BufferPool *const bm, BM_PageHandle *const page,
+	    const PageNumber pageNum);
+RC pinPageExclusive (BM_BufferPool *const bm, BM_PageHandle *const page,
+	    const PageNumber pageNum);
+
+// Optimistic reads of a pinned page: beginOptimisticRead waits for a writer holding the latch and
+// gives the page's version, validateOptimisticRead tells whether the page is still at it. If not, a
+// writer came in between and what was read must be read again. Nothing shared is written, so
+// readers of the same page do not slow each other down. Only writers that latch exclusively count.
+RC beginOptimisticRead (BM_BufferPool *const bm, BM_PageHandle *const page, unsigned int *version);
+bool validateOptimisticRead (BM_BufferPool *const bm, BM_PageHandle *const page, unsigned int version);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
@@ -79,5 +246,12 @@ bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
+int getNumPrefetched (BM_BufferPool *const bm);
+int getNumPrefetchUnused (BM_BufferPool *const bm);
+int getNumPartitions (BM_BufferPool *const bm);
+ReplacementStrategy getPartitionStrategy (BM_BufferPool *const bm, int part);
+ReplacementStrategy getActiveStrategy (BM_BufferPool *const bm);
+int getNumStrategySwitches (BM_BufferPool *const bm);
+double getSimulatedHitRatio (BM_BufferPool *const bm, ReplacementStrategy strategy);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,274 @@
+#include <stdlib.h>
+#include "buffer_mgr_arc.h"
+#include "dberror.h"
+
+static void listRemove (BM_Arc *arc, BM_ArcEntry *e)
+{
+	BM_ArcList *l = &arc->lists[e->list];
+
+	if (e->prev != NULL)
+		e->prev->next = e->next;
+	else
+		l->head = e->next;
+	if (e->next != NULL)
+		e->next->prev = e->prev;
+	else
+		l->tail = e->prev;
+	e->next = NULL;
+	e->prev = NULL;
+	l->size--;
+}
+
+static void listAppend (BM_Arc *arc, BM_ArcEntry *e, int list)
+{
+	BM_ArcList *l = &arc->lists[list];
+
+	e->list = list;
+	e->next = NULL;
+	e->prev = l->tail;
+	if (l->tail != NULL)
+		l->tail->next = e;
+	else
+		l->head = e;
+	l->tail = e;
+	l->size++;
+}
+
+static void listPrepend (BM_Arc *arc, BM_ArcEntry *e, int list)
+{
+	BM_ArcList *l = &arc->lists[list];
+
+	e->list = list;
+	e->prev = NULL;
+	e->next = l->head;
+	if (l->head != NULL)
+		l->head->prev = e;
+	else
+		l->tail = e;
+	l->head = e;
+	l->size++;
+}
+
+/*
+ * Function dropGhost()
+ * Forgets the least recently evicted page of a ghost list.
+*/
+static void dropGhost (BM_Arc *arc, int list)
+{
+	BM_ArcEntry *e = arc->lists[list].head;
+
+	listRemove(arc, e);
+	removePageTable(&arc->table, e->pageNum);
+	e->next = arc->free;
+	arc->free = e;
+}
+
+/*
+ * Function initArc()
+ * Allocates the 2c entries ARC ever needs: c resident pages and c ghosts.
+*/
+RC initArc (BM_Arc *arc, int numPages)
+{
+	int records = 2 * numPages;
+	int i;
+
+	arc->entries = (BM_ArcEntry *) malloc(sizeof(BM_ArcEntry) * records);
+	if (arc->entries == NULL || initPageTable(&arc->table, records) != RC_OK)
+	{
+		free(arc->entries);
+		return RC_NO_MORE_SPACE_IN_BUFFER;
+	}
+
+	arc->free = NULL;
+	for (i = records - 1; i >= 0; i--)
+	{
+		arc->entries[i].next = arc->free;
+		arc->free = &arc->entries[i];
+	}
+	for (i = 0; i < 4; i++)
+	{
+		arc->lists[i].head = NULL;
+		arc->lists[i].tail = NULL;
+		arc->lists[i].size = 0;
+	}
+	arc->c = numPages;
+	arc->p = 0;
+	arc->last = NULL;
+	arc->pending = NO_PAGE;
+	arc->pendingList = -1;
+	arc->ghostHits = 0;
+	return RC_OK;
+}
+
+void freeArc (BM_Arc *arc)
+{
+	freePageTable(&arc->table);
+	free(arc->entries);
+}
+
+/*
+ * Function arcPrepare()
+ * A hit on a B1 ghost grows p by |B2|/|B1| (at least 1), one on a B2 ghost shrinks it by |B1|/|B2|,
+ * the smaller ghost list counting for more. arcVictim uses what is remembered here.
+*/
+void arcPrepare (BM_Arc *arc, PageNumber pageNum)
+{
+	BM_ArcEntry *e = (BM_ArcEntry *) lookupPageTable(&arc->table, pageNum);
+	int b1 = arc->lists[BM_ARC_B1].size;
+	int b2 = arc->lists[BM_ARC_B2].size;
+
+	arc->pending = pageNum;
+	arc->pendingList = -1;
+	if (e == NULL || e->frame != NULL)
+		return;
+
+	arc->pendingList = e->list;
+	arc->ghostHits++;
+	if (e->list == BM_ARC_B1)
+		arc->p += (b2 > b1) ? b2 / b1 : 1;
+	else
+		arc->p -= (b1 > b2) ? b1 / b2 : 1;
+	if (arc->p > arc->c)
+		arc->p = arc->c;
+	if (arc->p < 0)
+		arc->p = 0;
+}
+
+/*
+ * Function arcLoad()
+ * A page coming back from a ghost list was referenced before, it goes to T2; a new one to T1,
+ * dropping the oldest B1 ghost if T1 and B1 together would outgrow the pool.
+ * Ring pages go to the LRU end of T1. A load for a pin is the page's reference (arcReference
+ * then sees it as the last one), a read ahead page is referenced on its first pin.
+*/
+RC arcLoad (BM_Arc *arc, node_dll *frame)
+{
+	BM_ArcEntry *e = (BM_ArcEntry *) lookupPageTable(&arc->table, frame->storage_pg_number);
+	int list = BM_ARC_T1;
+
+	if (e != NULL)
+	{
+		listRemove(arc, e);
+		list = BM_ARC_T2;
+	}
+	else
+	{
+		// a new page in T1 must leave |T1|+|B1| <= c
+		if (arc->lists[BM_ARC_T1].size + arc->lists[BM_ARC_B1].size >= arc->c && arc->lists[BM_ARC_B1].size > 0)
+			dropGhost(arc, BM_ARC_B1);
+		e = arc->free;
+		arc->free = e->next;
+		e->pageNum = frame->storage_pg_number;
+		insertPageTable(&arc->table, e->pageNum, e);
+	}
+	e->frame = frame;
+	frame->arc = e;
+
+	if (frame->in_ring)
+		listPrepend(arc, e, BM_ARC_T1);
+	else
+		listAppend(arc, e, list);
+
+	if (!frame->prefetched)
+		arc->last = frame;
+	if (arc->pending == e->pageNum)
+	{
+		arc->pending = NO_PAGE;
+		arc->pendingList = -1;
+	}
+	return RC_OK;
+}
+
+/*
+ * Function arcReference()
+ * Pins of the frame referenced last are one correlated reference (a scan pins a page once per
+ * record), only a new reference moves the page to the MRU end of T2.
+*/
+void arcReference (BM_Arc *arc, node_dll *frame)
+{
+	BM_ArcEntry *e = frame->arc;
+
+	if (arc->last == frame)
+		return;
+	arc->last = frame;
+	if (frame->prefetched)
+		return;
+	listRemove(arc, e);
+	listAppend(arc, e, BM_ARC_T2);
+}
+
+void arcDemote (BM_Arc *arc, node_dll *frame)
+{
+	BM_ArcEntry *e = frame->arc;
+
+	listRemove(arc, e);
+	listPrepend(arc, e, BM_ARC_T1);
+	if (arc->last == frame)
+		arc->last = NULL;
+}
+
+static node_dll *oldestUnpinned (BM_Arc *arc, int list)
+{
+	BM_ArcEntry *e;
+
+	for (e = arc->lists[list].head; e != NULL; e = e->next)
+		if (FIX_COUNT(e->frame) == 0)
+			return e->frame;
+	return NULL;
+}
+
+/*
+ * Function arcVictim()
+ * ARC's REPLACE: the LRU page of T1 while T1 is above its target p (or at it, when the page
+ * being loaded is a B2 ghost), else the LRU page of T2. Pinned pages are passed over, the
+ * other list is tried when one has only pinned pages.
+*/
+node_dll *arcVictim (BM_Arc *arc)
+{
+	int t1 = arc->lists[BM_ARC_T1].size;
+	node_dll *victim;
+
+	if (t1 > 0 && (t1 > arc->p || (arc->pendingList == BM_ARC_B2 && t1 == arc->p)))
+	{
+		victim = oldestUnpinned(arc, BM_ARC_T1);
+		if (victim == NULL)
+			victim = oldestUnpinned(arc, BM_ARC_T2);
+	}
+	else
+	{
+		victim = oldestUnpinned(arc, BM_ARC_T2);
+		if (victim == NULL)
+			victim = oldestUnpinned(arc, BM_ARC_T1);
+	}
+	return victim;
+}
+
+/*
+ * Function arcEvict()
+ * The page becomes a ghost of B1 or B2. The ghosts are kept to |T1|+|B1| <= c and |B1|+|B2| <= c,
+ * which bounds the directory to 2c pages.
+*/
+void arcEvict (BM_Arc *arc, node_dll *frame, bool keepGhost)
+{
+	BM_ArcEntry *e = frame->arc;
+	int list = (e->list == BM_ARC_T1) ? BM_ARC_B1 : BM_ARC_B2;
+
+	listRemove(arc, e);
+	e->frame = NULL;
+	frame->arc = NULL;
+	if (arc->last == frame)
+		arc->last = NULL;
+	if (!keepGhost)
+	{
+		removePageTable(&arc->table, e->pageNum);
+		e->next = arc->free;
+		arc->free = e;
+		return;
+	}
+
+	listAppend(arc, e, list);
+	if (arc->lists[BM_ARC_T1].size + arc->lists[BM_ARC_B1].size > arc->c)
+		dropGhost(arc, BM_ARC_B1);
+	if (arc->lists[BM_ARC_B1].size + arc->lists[BM_ARC_B2].size > arc->c)
+		dropGhost(arc, (arc->lists[BM_ARC_B2].size > 0) ? BM_ARC_B2 : BM_ARC_B1);
+}
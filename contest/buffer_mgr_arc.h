@@ -0,0 +1,65 @@
+#ifndef BUFFER_MGR_ARC_H
+#define BUFFER_MGR_ARC_H
+
+#include "dberror.h"
+#include "buffer_mgr.h"
+#include "buffer_mgr_hash.h"
+
+/************************************************************
+ *  ARC: adaptive replacement cache                         *
+ ************************************************************/
+// Resident pages are in T1 (referenced once lately) or T2 (more than once).
+// Pages evicted from them are remembered, without data, in the ghost lists
+// B1 and B2. A miss on a B1 ghost means T1 was too small, one on a B2 ghost
+// that T2 was, and the target size p of T1 moves accordingly, so the pool
+// settles on its own between recency (scans, new pages) and frequency (hot
+// pages). All lists run from least recently used (head) to most (tail).
+
+#define BM_ARC_T1 0
+#define BM_ARC_T2 1
+#define BM_ARC_B1 2
+#define BM_ARC_B2 3
+
+typedef struct BM_ArcEntry {
+	PageNumber pageNum;
+	int list;			// BM_ARC_T1 .. BM_ARC_B2
+	node_dll *frame;		// frame holding the page, NULL for a ghost
+	struct BM_ArcEntry *next;	// towards the tail of its list, or the free list
+	struct BM_ArcEntry *prev;
+} BM_ArcEntry;
+
+typedef struct BM_ArcList {
+	BM_ArcEntry *head;
+	BM_ArcEntry *tail;
+	int size;
+} BM_ArcList;
+
+typedef struct BM_Arc {
+	int c;				// frames in the pool
+	int p;				// target size of T1, 0..c
+	BM_ArcList lists[4];
+	BM_PageTable table;		// page number -> BM_ArcEntry, resident or ghost
+	BM_ArcEntry *entries;		// 2c records, c pages and c ghosts at most
+	BM_ArcEntry *free;
+	node_dll *last;			// frame referenced last
+	PageNumber pending;		// page the next load is for, see arcPrepare
+	int pendingList;		// its ghost list, -1 if it had no ghost
+	int ghostHits;			// misses on a B1 or B2 ghost
+} BM_Arc;
+
+extern RC initArc (BM_Arc *arc, int numPages);
+extern void freeArc (BM_Arc *arc);
+
+// a pin is about to read pageNum: adapts p if the page is a ghost, before the victim is chosen
+extern void arcPrepare (BM_Arc *arc, PageNumber pageNum);
+// frame got its page (storage_pg_number set)
+extern RC arcLoad (BM_Arc *arc, node_dll *frame);
+// a pin of a resident page, a repeated reference moves it to T2
+extern void arcReference (BM_Arc *arc, node_dll *frame);
+// the page goes to the LRU end of T1, it is the next victim unless someone pins it
+extern void arcDemote (BM_Arc *arc, node_dll *frame);
+extern node_dll *arcVictim (BM_Arc *arc);
+// the frame's page leaves the pool, as a ghost unless keepGhost is 0
+extern void arcEvict (BM_Arc *arc, node_dll *frame, bool keepGhost);
+
+#endif
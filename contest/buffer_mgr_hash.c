@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <string.h>
+#include "buffer_mgr_hash.h"
+#include "dberror.h"
+
+/*
+ * Function hashPage()
+ * Fibonacci hashing of a page number into [0, capacity). The multiplication mixes
+ * the page number into the high bits, so those are the ones kept.
+*/
+static int hashPage (BM_PageTable *table, PageNumber pageNum)
+{
+	unsigned int h = (unsigned int) pageNum * 2654435769u;
+	return (int) (h >> table->shift);
+}
+
+/*
+ * Function initPageTable()
+ * Allocates a table that keeps its load factor at or below one half for maxEntries entries.
+*/
+RC initPageTable (BM_PageTable *table, int maxEntries)
+{
+	int i;
+	int capacity = 8;
+	int shift = 32 - 3;
+
+	while (capacity < 2 * maxEntries)
+	{
+		capacity <<= 1;
+		shift--;
+	}
+
+	table->slots = (BM_HashSlot *) malloc(sizeof(BM_HashSlot) * capacity);
+	if (table->slots == NULL)
+		return RC_WRITE_FAILED;
+
+	for (i = 0; i < capacity; i++)
+	{
+		table->slots[i].pageNum = NO_PAGE;
+		table->slots[i].value = NULL;
+	}
+	table->capacity = capacity;
+	table->shift = shift;
+	table->count = 0;
+	return RC_OK;
+}
+
+/*
+ * Function freePageTable()
+ * Releases the slot array. Values are owned by the caller.
+*/
+void freePageTable (BM_PageTable *table)
+{
+	free(table->slots);
+	table->slots = NULL;
+	table->capacity = 0;
+	table->shift = 0;
+	table->count = 0;
+}
+
+/*
+ * Function lookupPageTable()
+ * Returns the value stored for pageNum or NULL if the page is not in the table.
+*/
+void *lookupPageTable (BM_PageTable *table, PageNumber pageNum)
+{
+	int mask = table->capacity - 1;
+	int i = hashPage(table, pageNum);
+
+	while (table->slots[i].pageNum != NO_PAGE)
+	{
+		if (table->slots[i].pageNum == pageNum)
+			return table->slots[i].value;
+		i = (i + 1) & mask;
+	}
+	return NULL;
+}
+
+/*
+ * Function insertPageTable()
+ * Stores value for pageNum, replacing the previous value if the page is already present.
+*/
+RC insertPageTable (BM_PageTable *table, PageNumber pageNum, void *value)
+{
+	int mask = table->capacity - 1;
+	int i = hashPage(table, pageNum);
+
+	while (table->slots[i].pageNum != NO_PAGE)
+	{
+		if (table->slots[i].pageNum == pageNum)
+		{
+			table->slots[i].value = value;
+			return RC_OK;
+		}
+		i = (i + 1) & mask;
+	}
+
+	if (2 * (table->count + 1) > table->capacity)
+		return RC_NO_MORE_SPACE_IN_BUFFER;
+
+	table->slots[i].pageNum = pageNum;
+	table->slots[i].value = value;
+	table->count++;
+	return RC_OK;
+}
+
+/*
+ * Function removePageTable()
+ * Deletes pageNum and shifts the following entries of its probe run back so lookups never need tombstones.
+*/
+RC removePageTable (BM_PageTable *table, PageNumber pageNum)
+{
+	int mask = table->capacity - 1;
+	int i = hashPage(table, pageNum);
+	int j, home;
+
+	while (table->slots[i].pageNum != pageNum)
+	{
+		if (table->slots[i].pageNum == NO_PAGE)
+			return RC_NON_EXISTING_PAGE_IN_FRAME;
+		i = (i + 1) & mask;
+	}
+
+	j = i;
+	while (1)
+	{
+		j = (j + 1) & mask;
+		if (table->slots[j].pageNum == NO_PAGE)
+			break;
+
+		// an entry may move into the hole only if its home slot is not in (i, j]
+		home = hashPage(table, table->slots[j].pageNum);
+		if ((i <= j) ? (i < home && home <= j) : (i < home || home <= j))
+			continue;
+
+		table->slots[i] = table->slots[j];
+		i = j;
+	}
+
+	table->slots[i].pageNum = NO_PAGE;
+	table->slots[i].value = NULL;
+	table->count--;
+	return RC_OK;
+}
@@ -0,0 +1,32 @@
+#ifndef BUFFER_MGR_HASH_H
+#define BUFFER_MGR_HASH_H
+
+#include "dberror.h"
+#include "buffer_mgr.h"
+
+/************************************************************
+ *  open addressing page number -> value table              *
+ *  (linear probing, backward shift deletion, no tombstones) *
+ ************************************************************/
+typedef struct BM_HashSlot {
+	PageNumber pageNum;	// NO_PAGE marks an empty slot
+	void *value;
+} BM_HashSlot;
+
+typedef struct BM_PageTable {
+	BM_HashSlot *slots;
+	int capacity;		// always a power of two
+	int shift;		// 32 - log2(capacity), picks the top bits of the hash
+	int count;
+} BM_PageTable;
+
+// the capacity is fixed for the lifetime of the table, callers size it for
+// the largest number of entries they will ever hold
+extern RC initPageTable (BM_PageTable *table, int maxEntries);
+extern void freePageTable (BM_PageTable *table);
+
+extern void *lookupPageTable (BM_PageTable *table, PageNumber pageNum);
+extern RC insertPageTable (BM_PageTable *table, PageNumber pageNum, void *value);
+extern RC removePageTable (BM_PageTable *table, PageNumber pageNum);
+
+#endif
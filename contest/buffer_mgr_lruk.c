@@ -0,0 +1,240 @@
+#include <stdlib.h>
+#include <string.h>
+#include "buffer_mgr_lruk.h"
+#include "dberror.h"
+
+/*
+ * Function heapBefore()
+ * Whether a is evicted before b: the older K-th reference first, on a tie the older latest one.
+*/
+static int heapBefore (BM_LruK *lruK, BM_KHistory *a, BM_KHistory *b)
+{
+	if (a->refs[lruK->k - 1] != b->refs[lruK->k - 1])
+		return a->refs[lruK->k - 1] < b->refs[lruK->k - 1];
+	return a->refs[0] < b->refs[0];
+}
+
+static void heapSet (BM_LruK *lruK, int pos, BM_KHistory *h)
+{
+	lruK->heap[pos] = h;
+	h->heapPos = pos;
+}
+
+static void siftUp (BM_LruK *lruK, int pos)
+{
+	BM_KHistory *h = lruK->heap[pos];
+	int parent;
+
+	while (pos > 0)
+	{
+		parent = (pos - 1) / 2;
+		if (!heapBefore(lruK, h, lruK->heap[parent]))
+			break;
+		heapSet(lruK, pos, lruK->heap[parent]);
+		pos = parent;
+	}
+	heapSet(lruK, pos, h);
+}
+
+static void siftDown (BM_LruK *lruK, int pos)
+{
+	BM_KHistory *h = lruK->heap[pos];
+	int child;
+
+	while ((child = 2 * pos + 1) < lruK->heapSize)
+	{
+		if (child + 1 < lruK->heapSize && heapBefore(lruK, lruK->heap[child + 1], lruK->heap[child]))
+			child++;
+		if (!heapBefore(lruK, lruK->heap[child], h))
+			break;
+		heapSet(lruK, pos, lruK->heap[child]);
+		pos = child;
+	}
+	heapSet(lruK, pos, h);
+}
+
+static void heapRemove (BM_LruK *lruK, BM_KHistory *h)
+{
+	int pos = h->heapPos;
+	BM_KHistory *moved;
+
+	if (pos < 0)
+		return;
+	h->heapPos = -1;
+	moved = lruK->heap[--lruK->heapSize];
+	if (moved == h)
+		return;
+	heapSet(lruK, pos, moved);
+	siftUp(lruK, pos);
+	siftDown(lruK, moved->heapPos);
+}
+
+/*
+ * Function unlinkHistory()
+ * Takes a record off the retained list.
+*/
+static void unlinkHistory (BM_LruK *lruK, BM_KHistory *h)
+{
+	if (h->prev != NULL)
+		h->prev->next = h->next;
+	else
+		lruK->retainedHead = h->next;
+	if (h->next != NULL)
+		h->next->prev = h->prev;
+	else
+		lruK->retainedTail = h->prev;
+	h->next = NULL;
+	h->prev = NULL;
+}
+
+/*
+ * Function initLruK()
+ * Allocates BM_LRU_K_HISTORY records per frame, so the history of evicted pages
+ * outlives them by a few pool turnovers, and a heap as big as the pool.
+*/
+RC initLruK (BM_LruK *lruK, int k, int numPages)
+{
+	int records = numPages * BM_LRU_K_HISTORY;
+	int i;
+
+	lruK->k = k;
+	lruK->now = 0;
+	lruK->last = NULL;
+	lruK->histories = (BM_KHistory *) malloc(sizeof(BM_KHistory) * records);
+	lruK->refs = (long *) calloc((size_t) records * k, sizeof(long));
+	lruK->heap = (BM_KHistory **) malloc(sizeof(BM_KHistory *) * numPages);
+	if (lruK->histories == NULL || lruK->refs == NULL || lruK->heap == NULL
+	    || initPageTable(&lruK->table, records) != RC_OK)
+	{
+		free(lruK->histories);
+		free(lruK->refs);
+		free(lruK->heap);
+		return RC_NO_MORE_SPACE_IN_BUFFER;
+	}
+
+	lruK->free = NULL;
+	for (i = records - 1; i >= 0; i--)
+	{
+		lruK->histories[i].refs = lruK->refs + (size_t) i * k;
+		lruK->histories[i].next = lruK->free;
+		lruK->free = &lruK->histories[i];
+	}
+	lruK->retainedHead = NULL;
+	lruK->retainedTail = NULL;
+	lruK->heapSize = 0;
+	return RC_OK;
+}
+
+void freeLruK (BM_LruK *lruK)
+{
+	freePageTable(&lruK->table);
+	free(lruK->histories);
+	free(lruK->refs);
+	free(lruK->heap);
+}
+
+/*
+ * Function lruKLoad()
+ * Attaches the page's history to the frame. A page seen for the first time gets a free record,
+ * or the one of the page evicted longest ago when all are taken: resident pages hold at most
+ * numPages of them, so the retained list is never empty then.
+*/
+RC lruKLoad (BM_LruK *lruK, node_dll *frame)
+{
+	BM_KHistory *h = (BM_KHistory *) lookupPageTable(&lruK->table, frame->storage_pg_number);
+
+	if (h != NULL)
+		unlinkHistory(lruK, h);
+	else
+	{
+		if (lruK->free != NULL)
+		{
+			h = lruK->free;
+			lruK->free = h->next;
+		}
+		else
+		{
+			h = lruK->retainedHead;
+			unlinkHistory(lruK, h);
+			removePageTable(&lruK->table, h->pageNum);
+			if (lruK->last == h)
+				lruK->last = NULL;
+		}
+		h->pageNum = frame->storage_pg_number;
+		memset(h->refs, 0, sizeof(long) * lruK->k);
+		h->next = NULL;
+		h->prev = NULL;
+		insertPageTable(&lruK->table, h->pageNum, h);
+	}
+	h->heapPos = -1;
+	h->frame = frame;
+	frame->khist = h;
+	return RC_OK;
+}
+
+/*
+ * Function lruKReference()
+ * Pins of the page referenced last are one correlated reference (a scan pins a page once per
+ * record), they move its latest time instead of pushing its K-th one back.
+*/
+void lruKReference (BM_LruK *lruK, node_dll *frame)
+{
+	BM_KHistory *h = frame->khist;
+
+	heapRemove(lruK, h);
+	if (lruK->last != h)
+	{
+		memmove(h->refs + 1, h->refs, sizeof(long) * (lruK->k - 1));
+		lruK->last = h;
+	}
+	h->refs[0] = ++lruK->now;
+}
+
+void lruKUnpinned (BM_LruK *lruK, node_dll *frame)
+{
+	BM_KHistory *h = frame->khist;
+
+	if (h->heapPos >= 0)
+		return;
+	h->heapPos = lruK->heapSize++;
+	lruK->heap[h->heapPos] = h;
+	siftUp(lruK, h->heapPos);
+}
+
+void lruKDemote (BM_LruK *lruK, node_dll *frame)
+{
+	BM_KHistory *h = frame->khist;
+
+	memset(h->refs, 0, sizeof(long) * lruK->k);
+	if (lruK->last == h)
+		lruK->last = NULL;
+	if (h->heapPos >= 0)
+		siftUp(lruK, h->heapPos);
+}
+
+/*
+ * Function lruKVictim()
+ * The heap only holds unpinned pages, its top is the victim. NULL when every page is pinned.
+*/
+node_dll *lruKVictim (BM_LruK *lruK)
+{
+	if (lruK->heapSize == 0)
+		return NULL;
+	return lruK->heap[0]->frame;
+}
+
+void lruKEvict (BM_LruK *lruK, node_dll *frame)
+{
+	BM_KHistory *h = frame->khist;
+
+	heapRemove(lruK, h);
+	h->frame = NULL;
+	h->prev = lruK->retainedTail;
+	h->next = NULL;
+	if (lruK->retainedTail != NULL)
+		lruK->retainedTail->next = h;
+	else
+		lruK->retainedHead = h;
+	lruK->retainedTail = h;
+	frame->khist = NULL;
+}
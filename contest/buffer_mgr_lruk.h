@@ -0,0 +1,56 @@
+#ifndef BUFFER_MGR_LRUK_H
+#define BUFFER_MGR_LRUK_H
+
+#include "dberror.h"
+#include "buffer_mgr.h"
+#include "buffer_mgr_hash.h"
+
+/************************************************************
+ *  LRU-K: reference history and victim heap                *
+ ************************************************************/
+// Every resident page and up to (BM_LRU_K_HISTORY-1)*numPages evicted ones keep
+// the times of their last K references, the clock ticks once per reference.
+// The unpinned resident pages sit in a min-heap on the backward K-distance: the
+// page whose K-th most recent reference is the oldest is the victim, pages with
+// fewer than K references count as infinitely far back and go first, least
+// recently used first among them.
+
+typedef struct BM_KHistory {
+	PageNumber pageNum;
+	long *refs;			// last K reference times, refs[0] the latest, 0 for none
+	int heapPos;			// index in the victim heap, -1 when not in it
+	node_dll *frame;		// frame holding the page, NULL once it was evicted
+	struct BM_KHistory *next;	// retained list (oldest eviction first) or free list
+	struct BM_KHistory *prev;
+} BM_KHistory;
+
+typedef struct BM_LruK {
+	int k;
+	long now;			// reference clock
+	BM_KHistory *last;		// history of the page referenced last
+	BM_PageTable table;		// page number -> BM_KHistory
+	BM_KHistory *histories;		// all the records, carved once
+	long *refs;			// their reference times, K per record
+	BM_KHistory *free;
+	BM_KHistory *retainedHead;	// evicted pages, the oldest is dropped when records run out
+	BM_KHistory *retainedTail;
+	BM_KHistory **heap;		// one slot per frame
+	int heapSize;
+} BM_LruK;
+
+extern RC initLruK (BM_LruK *lruK, int k, int numPages);
+extern void freeLruK (BM_LruK *lruK);
+
+// frame got its page (storage_pg_number set), the page's history is picked up again if it was retained
+extern RC lruKLoad (BM_LruK *lruK, node_dll *frame);
+// a pin: counts a reference and takes the frame off the heap
+extern void lruKReference (BM_LruK *lruK, node_dll *frame);
+// the last pin went away, the frame can be a victim
+extern void lruKUnpinned (BM_LruK *lruK, node_dll *frame);
+// forgets the page's references, it is the next victim unless someone pins it
+extern void lruKDemote (BM_LruK *lruK, node_dll *frame);
+extern node_dll *lruKVictim (BM_LruK *lruK);
+// the frame's page leaves the pool, its history is retained
+extern void lruKEvict (BM_LruK *lruK, node_dll *frame);
+
+#endif
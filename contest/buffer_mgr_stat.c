@@ -6,6 +6,7 @@
 
 // local functions
 static void printStrat (BM_BufferPool *const bm);
+static void printStrategyName (ReplacementStrategy strategy);
 
 // external functions
 void 
@@ -81,7 +82,19 @@ sprintPageContent (BM_PageHandle *const page)
 void
 printStrat (BM_BufferPool *const bm)
 {
-  switch (bm->strategy)
+  printStrategyName(bm->strategy);
+  if (bm->strategy == RS_ADAPTIVE)
+    {
+      printf("(");
+      printStrategyName(getActiveStrategy(bm));
+      printf(")");
+    }
+}
+
+void
+printStrategyName (ReplacementStrategy strategy)
+{
+  switch (strategy)
     {
     case RS_FIFO:
       printf("FIFO");
@@ -98,8 +111,17 @@ printStrat (BM_BufferPool *const bm)
     case RS_LRU_K:
       printf("LRU-K");
       break;
+    case RS_GCLOCK:
+      printf("GCLOCK");
+      break;
+    case RS_ARC:
+      printf("ARC");
+      break;
+    case RS_ADAPTIVE:
+      printf("ADAPTIVE");
+      break;
     default:
-      printf("%i", bm->strategy);
+      printf("%i", strategy);
       break;
     }
-}
\ No newline at end of file
+}
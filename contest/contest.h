@@ -7,6 +7,6 @@
 extern RC setUpContest (int numPages);
 extern RC shutdownContest (void);
 
-extern long getContestIOs (BM_BufferPool *const bm);
+extern long getContestIOs (void *tableMgmtData);
 
 #endif
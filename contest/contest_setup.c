@@ -23,10 +23,12 @@ shutdownContest (void)
   return RC_OK;
 }
 
-/* return the total number of I/O operations used after setUpContest */
+/* return the total number of I/O operations used after setUpContest, by the
+   buffer pool of the table whose mgmtData the workload passes */
 long
-getContestIOs (BM_BufferPool *const bm)
+getContestIOs (void *tableMgmtData)
 {
+  BM_BufferPool *bm = getTableBufferPool(tableMgmtData);
   int numReadIO = getNumReadIO(bm);
   int numWriteIO = getNumWriteIO(bm);
   return numReadIO + numWriteIO;
@@ -22,6 +22,12 @@ typedef int RC;
 #define RC_NULL_ARGUMENT 11
 #define RC_READ_FAILED 600
 #define RC_DELETE_FAILED 601
+#define RC_ASYNC_IO_INIT_FAILED 602
+#define RC_INVALID_PAGE_SIZE 603
+#define RC_INVALID_PAGE_FILE 604
+#define RC_PAGE_ALREADY_FREE 605
+#define RC_PAGE_PINNED 606
+#define RC_TOO_MANY_BACKENDS 607
 
 #define RC_NO_TUPLES 206
 
@@ -31,6 +37,7 @@ typedef int RC;
 #define RC_RM_NO_MORE_TUPLES 203
 #define RC_RM_NO_PRINT_FOR_DATATYPE 204
 #define RC_RM_UNKOWN_DATATYPE 205
+#define RC_RM_RECORD_DELETED 207
 
 #define RC_IM_KEY_NOT_FOUND 300
 #define RC_IM_KEY_ALREADY_EXISTS 301
@@ -23,9 +23,15 @@
 
 /* This will be used to check if record manager is initalized or not
  0: Not initalized 1: Initialized */
-int init_record_manager = 0;
-int currentBufSize = DEFAULT_TABLE_BUFFER_SIZE + 1;
-SM_FileHandle file_handle;
+static int init_record_manager = 0;
+/* Pages a sequential scan asks the buffer pool to read ahead in one go, also the pool's readahead window */
+#define SCAN_BATCH_PAGES 8
+// scans of tables over 1/SCAN_RING_FRACTION of the pool read through a ring of SCAN_RING_PAGES frames
+#define SCAN_RING_FRACTION 4
+#define SCAN_RING_PAGES 16
+// frames of the buffer pool openTable gives every table, set by initRecordManager. Everything else
+// about a table is in its own tblManagement and pool, any number of tables can be open at once.
+static int currentBufSize = DEFAULT_TABLE_BUFFER_SIZE + 1;
 
 /* Used in scan functions*/
 typedef struct recInformation {
@@ -37,6 +43,8 @@ typedef struct recInformation {
     int number_of_pages;
     // Search condition used for scanning
     Expr *srch_cond;
+    // frames a large scan reads through, ring.parts is NULL for the others
+    BM_Ring ring;
 }recInformation;
 
 /* Used for storing table information */
@@ -48,13 +56,21 @@ typedef struct tblManagement {
     int rec_start_position;
     int rec_last_position;
     int length_of_schema;
+    // slot positions from the table start up to the last record, deleted slots in between included
+    int no_of_slots;
+    // no page before this one has a deleted slot
+    int free_slot_page;
 }tblManagement;
 
 // Additional functions used in the code
-tblManagement* initTableSchema(tblManagement *table_info, Schema *schema);
+tblManagement* initTableSchema(tblManagement *table_info, Schema *schema, int page_size);
+int writeStringPage(SM_FileHandle file_handle, int page_no, char *string);
 int writePage(SM_FileHandle file_handle, char *tble_in_strng);
 int writeSchema(SM_FileHandle file_handle, char *schema_in_strng);
 int freeMemory( void *pointer);
+RC findFreeSlot(tblManagement *table_data, int page_number, int *slot);
+RC findLastSlot(tblManagement *table_data, int page_number, int *slot);
+RC readRecord (RM_TableData *rel, RID id, Record *record, BM_Ring *ring);
 
 // Main Method
 /* int main(){
@@ -149,15 +165,15 @@ char* tableToString(tblManagement *tbl_mgmt) {
     VarString *string;
     MAKE_VARSTRING(string);
     char *final_string;
-    APPEND(string, "SchemaLength {%i} FirstPage {%i} LastPage {%i} Tuples {%i} SlotLength {%i} MaxSlots {%i} \n", tbl_mgmt->length_of_schema, tbl_mgmt->rec_start_position, tbl_mgmt->rec_last_position, tbl_mgmt->no_of_tuples, tbl_mgmt->lenght_of_slot, tbl_mgmt->maximum_slots);
+    APPEND(string, "SchemaLength {%i} FirstPage {%i} LastPage {%i} Tuples {%i} SlotLength {%i} MaxSlots {%i} Slots {%i} FreeSlotPage {%i} \n", tbl_mgmt->length_of_schema, tbl_mgmt->rec_start_position, tbl_mgmt->rec_last_position, tbl_mgmt->no_of_tuples, tbl_mgmt->lenght_of_slot, tbl_mgmt->maximum_slots, tbl_mgmt->no_of_slots, tbl_mgmt->free_slot_page);
     GET_STRING(final_string, string);
     printf("%s", final_string);
     return (final_string);
 }
 
 
-/* Function used to initialize table and schema information */
-tblManagement* initTableSchema(tblManagement *table_info, Schema *schema){
+/* Function used to initialize table and schema information, slots are laid out in pages of page_size bytes */
+tblManagement* initTableSchema(tblManagement *table_info, Schema *schema, int page_size){
     
     int len_file;
     int len_slot;
@@ -166,9 +182,9 @@ tblManagement* initTableSchema(tblManagement *table_info, Schema *schema){
     
     // Populate information related to table
     len_schema = getSchemaLength(schema);
-    len_file =((int) ((float)len_schema / PAGE_SIZE)) +1;
+    len_file =((int) ((float)len_schema / page_size)) +1;
     len_slot = getSlotSize(schema);
-    max_slot = ((int) ((float)PAGE_SIZE/(float)len_slot)) -1;
+    max_slot = ((int) ((float)page_size/(float)len_slot)) -1;
     
     table_info -> no_of_tuples = 0;
     table_info -> rec_start_position = len_file +1;
@@ -176,15 +192,27 @@ tblManagement* initTableSchema(tblManagement *table_info, Schema *schema){
     table_info -> rec_last_position = len_file + 1;
     table_info -> maximum_slots = max_slot;
     table_info -> length_of_schema = len_schema;
+    table_info -> no_of_slots = 0;
+    table_info -> free_slot_page = len_file + 1;
     
     return table_info;
 }
 
+// Write a string zero padded to a whole page of the file
+int writeStringPage(SM_FileHandle file_handle, int page_no, char *string){
+    int return_code = 0;
+    char *page = (char *) calloc(1, file_handle.pageSize);
+    strncpy(page, string, file_handle.pageSize - 1);
+    return_code = writeBlock(page_no, &file_handle, page);
+    free(page);
+    return return_code;
+}
+
 // Write table data to page 0
 int writePage(SM_FileHandle file_handle, char *tble_in_strng){
     printf("Write Page: START");
     int return_code = 0;
-    return_code = writeBlock(0, &file_handle, tble_in_strng);
+    return_code = writeStringPage(file_handle, 0, tble_in_strng);
     if( return_code != RC_OK)
         return return_code;
     printf("Write Page: Completed");
@@ -195,7 +223,7 @@ int writePage(SM_FileHandle file_handle, char *tble_in_strng){
 int writeSchema(SM_FileHandle file_handle, char *schema_in_strng){
     printf("Write Schema: START");
     int return_code = 0;
-    return_code = writeBlock(1, &file_handle, schema_in_strng);
+    return_code = writeStringPage(file_handle, 1, schema_in_strng);
     if( return_code != RC_OK)
         return return_code;
     printf("Write Schema: Completed");
@@ -204,28 +232,31 @@ int writeSchema(SM_FileHandle file_handle, char *schema_in_strng){
 
 /* Creating a table and store table and schema info as string */
 extern RC createTable (char *name, Schema *schema){
+    return createTableWithPageSize(name, schema, PAGE_SIZE);
+}
+
+/* Creating a table whose page file uses pages of page_size bytes, bigger pages hold more slots */
+extern RC createTableWithPageSize (char *name, Schema *schema, int page_size){
     printf("createTable: STARTED\n");
     // Declare variables to be used in code
-    FILE *file;
     char *tble_in_strng, *schema_in_strng;
+    SM_FileHandle file_handle;
     int return_code = 0, length_of_table = sizeof(tblManagement);
     tblManagement *table_info = (tblManagement *) malloc(length_of_table);
     
     // Checking if file exists or not. If exists return EC:
-    if( (file = fopen(name, "r")) != NULL )
+    if( pageFileExists(name) )
         return RC_TABLE_EXISTS;
-    else
-        fclose(file);
     
     // In the first page(page:0) we need to write file infomration
     // Create a page file
     printf("Calling creating page\n");
-    return_code = createPageFile(name);
+    return_code = createPageFileSize(name, page_size);
     if (return_code != RC_OK)
         return return_code;
     printf("createTable: initTableSchema\n");
     // Initialize table related information
-    table_info = initTableSchema(table_info, schema);
+    table_info = initTableSchema(table_info, schema, page_size);
     
     printf("createTable: Open Page File\n");
     return_code = openPageFile(name, &file_handle);
@@ -272,7 +303,7 @@ tblManagement *strToTableInfo(char *table_string) {
     int BASE = 10, table_mgmt_size = sizeof(tblManagement);
     tblManagement *table_data = (tblManagement*) malloc (table_mgmt_size);
     int table_length = strlen(table_string) ;
-    char table_data_string[table_length];
+    char table_data_string[table_length + 1];
     
     printf(" strToTableInfo: string copy \n");
     strcpy( table_data_string, table_string);
@@ -286,11 +317,18 @@ tblManagement *strToTableInfo(char *table_string) {
     table_data -> length_of_schema = strtol(temp_string1, &temp_string2, BASE);
     
     printf("strToTableInfo: conversion started\n");
-    for( int i=0; i< 5; i++){
+    for( int i=0; i< 7; i++){
         printf("strToTableInfo: string tok started\n");
         temp_string1 = strtok(NULL,"{");
         temp_string1 = strtok(NULL,"}");
         
+        // tables written before deleted slots were tracked have no holes, their slots end at the last tuple
+        if( temp_string1 == NULL){
+            table_data -> no_of_slots = table_data -> no_of_tuples;
+            table_data -> free_slot_page = table_data -> rec_last_position + 1;
+            break;
+        }
+        
         if( i == 0){
             table_data -> rec_start_position = (int) strtol(temp_string1, &temp_string2, BASE);
             printf("strToTableInfo: rec_start_position converted \n");
@@ -306,6 +344,12 @@ tblManagement *strToTableInfo(char *table_string) {
         } else if ( i == 4) {
             table_data -> maximum_slots = (int) strtol(temp_string1, &temp_string2, BASE);
             printf("strToTableInfo: maximum_slots converted \n");
+        } else if ( i == 5) {
+            table_data -> no_of_slots = (int) strtol(temp_string1, &temp_string2, BASE);
+            printf("strToTableInfo: no_of_slots converted \n");
+        } else if ( i == 6) {
+            table_data -> free_slot_page = (int) strtol(temp_string1, &temp_string2, BASE);
+            printf("strToTableInfo: free_slot_page converted \n");
         }
     }
     
@@ -322,7 +366,7 @@ Schema *stringToSchema(char *str_schema) {
     int return_code = 0;
     Schema *schema = (Schema*) malloc(size_of_schema);
     
-    char schema_info[(int)strlen(str_schema)];
+    char schema_info[length_of_str_schema + 1];
     // Copying string_schema into schema_info
     int SIZE_OF_CHAR = sizeof(char);
     int SIZE_OF_CHAR_PTR = sizeof(char *);
@@ -333,6 +377,7 @@ Schema *stringToSchema(char *str_schema) {
         schema_info[counter] = str_schema[counter];
         counter++;
     }while(str_schema[counter] != '\0');
+    schema_info[counter] = '\0';
     
     char *temp_string1 = NULL;
     temp_string1 = strtok(schema_info, "<");
@@ -352,7 +397,7 @@ Schema *stringToSchema(char *str_schema) {
     
     for(int counter = 0; counter < no_attributes; counter++) {
         temp_string1 = strtok(NULL, ": ");
-        schema->attrNames[counter] = (char*) calloc( strlen(temp_string1), SIZE_OF_CHAR);
+        schema->attrNames[counter] = (char*) calloc( strlen(temp_string1) + 1, SIZE_OF_CHAR);
         
         strcpy(schema->attrNames[counter], temp_string1);
         int temp = no_attributes-1;
@@ -361,7 +406,7 @@ Schema *stringToSchema(char *str_schema) {
         else
             temp_string1 = strtok(NULL, ", ");
         
-        reference[counter] = (char *)calloc( strlen(temp_string1), SIZE_OF_CHAR);
+        reference[counter] = (char *)calloc( strlen(temp_string1) + 1, SIZE_OF_CHAR);
         
         if(strcmp(temp_string1, "INT")==0) {
             schema->typeLength[counter]=0;
@@ -384,10 +429,8 @@ Schema *stringToSchema(char *str_schema) {
     if( (temp_string1 = strtok(NULL, "(")) != NULL) {
         char *keystr = strtok(temp_string1 , ", ");
         temp_string1 = strtok(NULL, ")");
-        int temp = strlen(keystr)*SIZE_OF_CHAR;
-        
         while(keystr!=NULL){
-            key_attributes[size]=(char*)malloc(temp);
+            key_attributes[size]=(char*)malloc((strlen(keystr) + 1)*SIZE_OF_CHAR);
             strcpy(key_attributes[size], keystr);
             size = size + 1;
             keystr=strtok(NULL, ", ");
@@ -399,7 +442,7 @@ Schema *stringToSchema(char *str_schema) {
         char* temp_string3 = NULL;
         for(int loop_counter=0; loop_counter< no_attributes; loop_counter++) {
             if(strlen(reference[loop_counter])>0) {
-                temp_string3 = (char*)malloc(SIZE_OF_CHAR*strlen(reference[loop_counter]));
+                temp_string3 = (char*)calloc(strlen(reference[loop_counter]) + 1, SIZE_OF_CHAR);
                 memcpy(temp_string3, reference[loop_counter], strlen(reference[loop_counter]));
                 schema->dataTypes[loop_counter]= DT_STRING;
                 temp_string1 = strtok(temp_string3, "[");
@@ -442,7 +485,6 @@ extern RC openTable (RM_TableData *rel, char *name){
     
     printf(" openTable: START \n");
     // Declare variables to be used in code
-    FILE *file;
     int size_of_page_handle = sizeof(BM_PageHandle);
     int size_of_buffer_pool = sizeof(BM_BufferPool);
     BM_PageHandle *pHandler = (BM_PageHandle *)malloc(size_of_page_handle);
@@ -455,16 +497,17 @@ extern RC openTable (RM_TableData *rel, char *name){
     
     // Checking if file exists or not. If does not exist return EC:
     printf(" openTable: table check \n");
-    if( (file = fopen(name, "r")) == NULL )
+    if( !pageFileExists(name) )
         return RC_TABLE_DOES_NOT_EXIST;
-    else
-        fclose(file);
     
     printf("openTable: Initializing buffer pool \n");
     return_code = initBufferPool(bManager, file_name, currentBufSize, rep_stratergy, NULL);
     if( return_code != 0)
         return return_code;
     
+    // getRecord walks over consecutive RIDs pin the pages in order, let the pool read ahead
+    setReadahead(bManager, SCAN_BATCH_PAGES);
+    
     printf("openTable: pin page \n");
     return_code = pinPage(bManager, pHandler, pin_page_no);
     if( return_code != 0)
@@ -474,7 +517,7 @@ extern RC openTable (RM_TableData *rel, char *name){
     printf("%s\n", pHandler->data);
     tblManagement *table_info = strToTableInfo(pHandler->data);
     
-    if( table_info -> length_of_schema < PAGE_SIZE){
+    if( table_info -> length_of_schema < bManager -> pageSize){
         pin_page_no = pin_page_no +1;
         return_code = pinPage(bManager, pHandler, pin_page_no);
         if( return_code != 0)
@@ -482,7 +525,8 @@ extern RC openTable (RM_TableData *rel, char *name){
     }
     
     printf("openTable: string to schema\n");
-    rel -> name = name;
+    // inserts and deletes persist the table info under this name, a copy outlives the caller's string
+    rel -> name = strdup(name);
     rel -> schema = stringToSchema(pHandler->data);
     table_info -> bm = bManager;
     rel->mgmtData = table_info;
@@ -549,6 +593,11 @@ extern RC closeTable (RM_TableData *rel){
     if( return_code != RC_OK)
         return return_code;
     
+    printf("closeTable rel-> name\n");
+    return_code = freeMemory( rel -> name);
+    if( return_code != RC_OK)
+        return return_code;
+    
     printf("closeTable rel-> mgmtData\n");
     return_code = freeMemory( rel ->  mgmtData);
     if( return_code != RC_OK)
@@ -566,14 +615,11 @@ extern RC closeTable (RM_TableData *rel){
 /* Function to delete Table */
 extern RC deleteTable (char *name){
     printf("deleteTable: START \n");
-    FILE *file;
     int return_code = 0;
     // Checking if file exists or not. If doesn't exist return EC:
     printf("deleteTable table check \n");
-    if( (file = fopen(name, "r")) == NULL )
+    if( !pageFileExists(name) )
         return RC_TABLE_DOES_NOT_EXIST;
-    else
-        fclose(file);
     
     printf("deleteTable for file \n");
     return_code = destroyPageFile(name);
@@ -584,6 +630,18 @@ extern RC deleteTable (char *name){
     return RC_OK;
 }
 
+/* Vacuum a table: the buffer manager writes its pages back, then lets the storage manager cut off
+ the tail pages deleteRecord freed and punch holes for free pages inside the file */
+extern RC vacuumTable (RM_TableData *rel){
+    tblManagement *table_data = (tblManagement *) rel -> mgmtData;
+    return trimPoolFile(table_data -> bm);
+}
+
+/* Function to get the buffer pool of an open table from its mgmtData */
+extern BM_BufferPool *getTableBufferPool (void *tableMgmtData){
+    return ((tblManagement *) tableMgmtData) -> bm;
+}
+
 /* Funtion to get number of tuples */
 extern int getNumTuples (RM_TableData *rel){
     printf("getNumTuples: START \n");
@@ -597,15 +655,13 @@ extern int getNumTuples (RM_TableData *rel){
 /* Writes table data to file*/
 RC persistTable(char *file_name, tblManagement *table_data) {
     printf("persistTable : START \n");
-    FILE *file;
+    SM_FileHandle file_handle;
     int return_code;
     
     // Checking if file exists or not. If does not exist return EC:
     printf("persistTable file name check\n");
-    if( (file = fopen(file_name, "r")) == NULL )
+    if( !pageFileExists(file_name) )
         return -1;
-    else
-        fclose(file);
     
     printf("persistTable open page file\n");
     return_code = openPageFile(file_name, &file_handle);
@@ -639,27 +695,57 @@ extern RC insertRecord (RM_TableData *rel, Record *record){
     
     Schema *schm = rel -> schema;
     int page_number = table_data -> rec_last_position;
-    
-    printf("insertRecord page_number %d\n", page_number);
-    int temp = (page_number - table_data-> rec_start_position)* table_data-> maximum_slots;
-    int slt = (table_data -> no_of_tuples) - temp;
+    int slt = -1;
     char *page_data;
-    temp = table_data -> maximum_slots;
+    int temp;
+    
+    // a slot deleteRecord left in the middle of the table is used before the table grows
+    if( table_data -> no_of_tuples < table_data -> no_of_slots ){
+        while( table_data -> free_slot_page <= table_data -> rec_last_position ){
+            return_code = findFreeSlot(table_data, table_data -> free_slot_page, &slt);
+            if( return_code != RC_OK)
+                return return_code;
+            if( slt >= 0 )
+                break;
+            table_data -> free_slot_page = table_data -> free_slot_page + 1;
+        }
+    }
     
-    if( slt == temp ) {
-        page_number = page_number+1;
-        slt = 0;
+    if( slt >= 0 ){
+        page_number = table_data -> free_slot_page;
+    } else {
+        // no hole: the record goes right after the last slot in use
+        page_number = table_data -> rec_start_position + table_data -> no_of_slots / table_data -> maximum_slots;
+        slt = table_data -> no_of_slots % table_data -> maximum_slots;
+        if( page_number > table_data -> rec_last_position ) {
+            // last page is full: the table goes on with the page right after it. The file hands out its
+            // lowest free page, that one if deleteRecord gave it back. A page further out goes back to the
+            // free map, a free page inside the table would mean the map is broken.
+            return_code = allocatePoolPage(table_data->bm, &page_number);
+            if( return_code != RC_OK)
+                return return_code;
+            if( page_number != table_data -> rec_last_position + 1 ){
+                return_code = freePoolPage(table_data->bm, page_number);
+                if( return_code != RC_OK)
+                    return return_code;
+                if( page_number <= table_data -> rec_last_position )
+                    return RC_INVALID_PAGE_NUMBER;
+                page_number = table_data -> rec_last_position + 1;
+            }
+            table_data -> rec_last_position = page_number;
+        }
+        table_data -> no_of_slots = table_data -> no_of_slots + 1;
     }
+    printf("insertRecord page_number %d\n", page_number);
     
     record->id.slot = slt;
-    table_data -> rec_last_position = page_number;
     record->id.page = page_number;
     
     printf("insertRecord serialize record \n");
     page_data = serializeRecord(record, schm);
     
     printf("insertRecord pin page %d\n", page_number);
-    return_code = pinPage(table_data->bm, pg_handler, page_number);
+    return_code = pinPageExclusive(table_data->bm, pg_handler, page_number);
     if( return_code != RC_OK)
         return return_code;
     
@@ -668,14 +754,17 @@ extern RC insertRecord (RM_TableData *rel, Record *record){
     memcpy( pg_handler->data + temp, page_data, length_page_data );
     
     printf("insertRecord free memory \n");
-    return_code = freeMemory(page_data);
-    if( return_code != RC_OK)
-        return return_code;
+    freeMemory(page_data);
     
     printf("insertRecord mark dirty \n");
     return_code = markDirty(table_data->bm, pg_handler);
-    if( return_code != RC_OK)
+    
+    // the latch and the pin are given back on errors as well
+    unlatchPage(table_data->bm, pg_handler);
+    if( return_code != RC_OK){
+        unpinPage(table_data->bm, pg_handler);
         return return_code;
+    }
     
     printf("insertRecord un pin page \n");
     return_code = unpinPage(table_data->bm, pg_handler);
@@ -702,6 +791,47 @@ extern RC insertRecord (RM_TableData *rel, Record *record){
     return RC_OK;
 }
 
+/* Finds the first deleted slot of a page, deleteRecord zeroes a slot from its first byte on.
+ *slot is -1 when every slot of the page is in use */
+RC findFreeSlot(tblManagement *table_data, int page_number, int *slot) {
+    BM_PageHandle pg_handler;
+    int return_code;
+    int i;
+    
+    return_code = pinPageShared(table_data->bm, &pg_handler, page_number);
+    if( return_code != RC_OK)
+        return return_code;
+    
+    *slot = -1;
+    for(i = 0; i < table_data -> maximum_slots && *slot < 0; i++){
+        if( pg_handler.data[i * table_data -> lenght_of_slot] == '\0')
+            *slot = i;
+    }
+    
+    unlatchPage(table_data->bm, &pg_handler);
+    return unpinPage(table_data->bm, &pg_handler);
+}
+
+/* Finds the last slot of a page still holding a record, *slot is -1 when every slot was deleted */
+RC findLastSlot(tblManagement *table_data, int page_number, int *slot) {
+    BM_PageHandle pg_handler;
+    int return_code;
+    int i;
+    
+    return_code = pinPageShared(table_data->bm, &pg_handler, page_number);
+    if( return_code != RC_OK)
+        return return_code;
+    
+    *slot = -1;
+    for(i = table_data -> maximum_slots - 1; i >= 0 && *slot < 0; i--){
+        if( pg_handler.data[i * table_data -> lenght_of_slot] != '\0')
+            *slot = i;
+    }
+    
+    unlatchPage(table_data->bm, &pg_handler);
+    return unpinPage(table_data->bm, &pg_handler);
+}
+
 /* Function to delete record */
 extern RC deleteRecord (RM_TableData *rel, RID id){
     printf("deleteRecord : START \n");
@@ -709,13 +839,14 @@ extern RC deleteRecord (RM_TableData *rel, RID id){
     int rec_slot_no = id.slot;
     int return_code =0;
     int temp=0;
+    int position, last_slot;
     
     tblManagement *table_data =(tblManagement*)(rel->mgmtData);
     int size_of_bm = sizeof(BM_PageHandle);
     BM_PageHandle *pg = (BM_PageHandle*)malloc(size_of_bm);
     
     printf("deleteRecord pinPage \n");
-    return_code = pinPage(table_data->bm, pg, rec_page_no);
+    return_code = pinPageExclusive(table_data->bm, pg, rec_page_no);
     if(return_code != RC_OK)
         return return_code;
     
@@ -723,12 +854,17 @@ extern RC deleteRecord (RM_TableData *rel, RID id){
     temp = rec_slot_no * table_data-> lenght_of_slot;
     int record_size = (int) strlen( temp + pg-> data);
     temp = rec_slot_no * table_data-> lenght_of_slot;
-    memcpy( pg-> data +temp, "\0", record_size);
+    memset( pg-> data +temp, '\0', record_size);
     
     printf("deleteRecord mark dirty \n");
     return_code = markDirty(table_data->bm, pg);
-    if( return_code != RC_OK)
+    
+    // the latch and the pin are given back on errors as well
+    unlatchPage(table_data->bm, pg);
+    if( return_code != RC_OK){
+        unpinPage(table_data->bm, pg);
         return return_code;
+    }
     
     printf("deleteRecord un pin page \n");
     return_code = unpinPage(table_data-> bm, pg);
@@ -742,6 +878,26 @@ extern RC deleteRecord (RM_TableData *rel, RID id){
     
     // Reduce tuple count
     table_data-> no_of_tuples = table_data -> no_of_tuples - 1;
+    
+    // The slot is a hole insertRecord fills next, unless it was the last one in use. Then the table
+    // ends at the last record still there and the pages behind it go back to the file.
+    position = (rec_page_no - table_data -> rec_start_position) * table_data -> maximum_slots + rec_slot_no;
+    if( position == table_data -> no_of_slots - 1 ){
+        while( 1 ){
+            return_code = findLastSlot(table_data, table_data -> rec_last_position, &last_slot);
+            if( return_code != RC_OK)
+                return return_code;
+            if( last_slot >= 0 || table_data -> rec_last_position == table_data -> rec_start_position )
+                break;
+            return_code = freePoolPage(table_data->bm, table_data -> rec_last_position);
+            if( return_code != RC_OK)
+                return return_code;
+            table_data -> rec_last_position = table_data -> rec_last_position - 1;
+        }
+        table_data -> no_of_slots = (table_data -> rec_last_position - table_data -> rec_start_position) * table_data -> maximum_slots + last_slot + 1;
+    } else if( rec_page_no < table_data -> free_slot_page ){
+        table_data -> free_slot_page = rec_page_no;
+    }
     // Write page data to file
     printf("deleteRecord persist table \n");
     return_code = persistTable(rel->name, table_data);
@@ -767,7 +923,7 @@ extern RC updateRecord (RM_TableData *rel, Record *record){
     char *record_string = serializeRecord(record, rel->schema);
     
     printf("updateRecord pin page \n");
-    return_code = pinPage(table_data->bm, pg, rec_page_no);
+    return_code = pinPageExclusive(table_data->bm, pg, rec_page_no);
     if( return_code != RC_OK)
         return RC_OK;
     
@@ -777,8 +933,13 @@ extern RC updateRecord (RM_TableData *rel, Record *record){
     
     printf("updateRecord mark dirty \n");
     return_code = markDirty(table_data->bm, pg);
-    if( return_code != RC_OK)
+    
+    // the latch and the pin are given back on errors as well
+    unlatchPage(table_data->bm, pg);
+    if( return_code != RC_OK){
+        unpinPage(table_data->bm, pg);
         return return_code;
+    }
     
     printf("updateRecord un pin page \n");
     return_code = unpinPage(table_data-> bm, pg);
@@ -819,7 +980,7 @@ Record *deserializeRecord(char *record_str, RM_TableData *rel)  {
     record->data = (char *)malloc(temp);
     temp = (int) strlen(record_str);
     int BASE = 10;
-    char data[temp];
+    char data[temp + 1];
     strcpy(data, record_str);
     char *temp_string1, *temp_string2;
     
@@ -834,6 +995,9 @@ Record *deserializeRecord(char *record_str, RM_TableData *rel)  {
         } else{
             temp_string1 = strtok (NULL,",");
         }
+        // a string holding a separator cuts the record short, the attributes past it are left empty
+        if(temp_string1 == NULL)
+            temp_string1 = "";
         
         /* set attribute values as per the attributes datatype */
         switch(schema->dataTypes[counter]){
@@ -877,8 +1041,8 @@ Record *deserializeRecord(char *record_str, RM_TableData *rel)  {
     return record;
 }
 
-/* Function to update record */
-extern RC getRecord (RM_TableData *rel, RID id, Record *record){
+/* Reads a record, a scan passes its ring so the pages it reads do not push out everyone else's */
+RC readRecord (RM_TableData *rel, RID id, Record *record, BM_Ring *ring){
     printf("getRecord : START \n");
     int size_of_bm = sizeof(BM_PageHandle);
     BM_PageHandle *pg = (BM_PageHandle*)malloc(size_of_bm);
@@ -890,7 +1054,7 @@ extern RC getRecord (RM_TableData *rel, RID id, Record *record){
     int num_tuple = 0;
     
     tblManagement *table_data =(tblManagement*)(rel->mgmtData);
-    char *record_string = (char*) malloc (SIZE_OF_CHAR * table_data -> lenght_of_slot);
+    char *record_string = (char*) calloc (table_data -> lenght_of_slot + 1, SIZE_OF_CHAR);
     record -> id.page = rec_page_no;
     
     
@@ -900,7 +1064,8 @@ extern RC getRecord (RM_TableData *rel, RID id, Record *record){
     offset = offset + rec_slot_no;
     num_tuple = offset + 1;
     record -> id.slot = rec_slot_no;
-    if ( num_tuple > table_data -> no_of_tuples){
+    if ( num_tuple > table_data -> no_of_slots){
+        freeMemory(record_string);
         return_code = freeMemory(pg);
         if( return_code != RC_OK)
             return return_code;
@@ -909,21 +1074,42 @@ extern RC getRecord (RM_TableData *rel, RID id, Record *record){
     }
     
     printf("getRecord pinnig page \n");
-    return_code = pinPage(table_data->bm, pg, rec_page_no);
-    if( return_code != RC_OK)
+    return_code = pinPageRing(table_data->bm, pg, rec_page_no, ring);
+    if( return_code != RC_OK){
+        freeMemory(record_string);
+        freeMemory(pg);
         return return_code;
+    }
     
+    // scans read without the page latch, the copy is taken again if a writer changed the page meanwhile
     printf("getRecord memory copy  \n");
     offset = rec_slot_no * table_data -> lenght_of_slot;
     printf(" Before %s  \n  Copying %d", record_string, SIZE_OF_CHAR * table_data->lenght_of_slot);
-    printf("Data %s", pg->data+offset);
-    memcpy(record_string, pg->data+offset, SIZE_OF_CHAR * table_data->lenght_of_slot);
+    unsigned int version;
+    do {
+        return_code = beginOptimisticRead(table_data-> bm, pg, &version);
+        if( return_code != RC_OK){
+            // the pin and the handle are given back on errors as well
+            unpinPage(table_data-> bm, pg);
+            freeMemory(record_string);
+            freeMemory(pg);
+            return return_code;
+        }
+        memcpy(record_string, pg->data+offset, SIZE_OF_CHAR * table_data->lenght_of_slot);
+    } while( !validateOptimisticRead(table_data-> bm, pg, version) );
     
     printf("getRecord un pin page  \n");
     return_code = unpinPage(table_data-> bm, pg);
     if( return_code != RC_OK)
         return return_code;
     
+    // the slot lies inside the table but its record was deleted
+    if( record_string[0] == '\0'){
+        freeMemory(record_string);
+        freeMemory(pg);
+        return RC_RM_RECORD_DELETED;
+    }
+    
     printf("getRecord string to record  \n");
     printf(" After%s \n ", record_string);
     Record *temp = deserializeRecord(record_string, rel);
@@ -940,6 +1126,11 @@ extern RC getRecord (RM_TableData *rel, RID id, Record *record){
     return RC_OK;
 }
 
+/* Function to get record */
+extern RC getRecord (RM_TableData *rel, RID id, Record *record){
+    return readRecord(rel, id, record, NULL);
+}
+
 // scans
 extern RC startScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond){
     
@@ -959,15 +1150,28 @@ extern RC startScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond){
     recInfo->current_page = ((tblManagement *)rel->mgmtData)->rec_start_position;
     recInfo->number_of_slots = ((tblManagement *)rel->mgmtData)->maximum_slots;
     recInfo->number_of_pages = ((tblManagement *)rel->mgmtData)->rec_last_position;
+    recInfo->ring.parts = NULL;
     scan->mgmtData = (void *) recInfo;
     scan->rel = rel;
     
+    // a table that does not fit in a fraction of the pool would push every other page out,
+    // read it through a small ring of frames instead
+    BM_BufferPool *bm = ((tblManagement *)rel->mgmtData)->bm;
+    int table_pages = recInfo->number_of_pages - recInfo->current_page + 1;
+    if(table_pages > bm->numPages / SCAN_RING_FRACTION){
+        startRingAccess(bm, &recInfo->ring, SCAN_RING_PAGES);
+    }
+    
     printf("startScan : COMPLETED \n");
     return RC_OK;
 }
 
 extern RC closeScan (RM_ScanHandle *scan){
     
+    recInformation *scanInfo = (recInformation *) scan->mgmtData;
+    if(scanInfo != NULL && scanInfo->ring.parts != NULL){
+        return endRingAccess(((tblManagement *)scan->rel->mgmtData)->bm, &scanInfo->ring);
+    }
     /*printf("Begin--> closeScan\n");
      recInformation *recInfo = (recInformation *) scan->mgmtData;
      free(recInfo->srch_cond);
@@ -991,38 +1195,49 @@ extern RC next (RM_ScanHandle *scan, Record *record){
     recInfo = scan->mgmtData;
     RC status;
     
+    // records not matching the condition are skipped in this loop
+    while(1){
+        record->id.slot = recInfo->current_slot;
+        record->id.page = recInfo->current_page;
     
-    record->id.slot = recInfo->current_slot;
-    record->id.page = recInfo->current_page;
+        // entering a new page: pull it and the following ones into the pool with one vectored read
+        if(recInfo->current_slot == 0){
+            status = prefetchPagesRing(((tblManagement *)scan->rel->mgmtData)->bm, recInfo->current_page, SCAN_BATCH_PAGES, &recInfo->ring);
+            if(status != RC_OK)
+                return status;
+        }
     
-    printf("next get record \n");
-    status = getRecord(scan->rel, record->id, record);
+        printf("next get record \n");
+        status = readRecord(scan->rel, record->id, record, &recInfo->ring);
     
-    if(status == RC_RM_NO_MORE_TUPLES){
-        printf("next NO_TUPLES_FOUND \n");
-        return RC_RM_NO_MORE_TUPLES;
-    } else{
-        printf("next evaluation of expression \n");
-        evalExpr(record, scan->rel->schema, recInfo->srch_cond, &value);
-        if (recInfo->current_slot == recInfo->number_of_slots - 1){
-            recInfo->current_slot = 0;
-            recInfo->current_page = recInfo->current_page +1;
-        }
-        else{
-            recInfo->current_slot =recInfo->current_slot+1;
-        }
-        scan->mgmtData = recInfo;
+        if(status == RC_RM_NO_MORE_TUPLES){
+            printf("next NO_TUPLES_FOUND \n");
+            return RC_RM_NO_MORE_TUPLES;
+        } else if(status != RC_OK && status != RC_RM_RECORD_DELETED){
+            return status;
+        } else{
+            if (recInfo->current_slot == recInfo->number_of_slots - 1){
+                recInfo->current_slot = 0;
+                recInfo->current_page = recInfo->current_page +1;
+            }
+            else{
+                recInfo->current_slot =recInfo->current_slot+1;
+            }
+            scan->mgmtData = recInfo;
+            // deleted slots are skipped like records not matching the condition
+            if(status == RC_RM_RECORD_DELETED)
+                continue;
         
-        printf("====== Recursive Calling next %d", value->v.boolV);
-        if(value->v.boolV != 1){
-            return next(scan, record);
-        }
-        else{
-            printf("next : COMPLETED \n");
-            return RC_OK;
+            printf("next evaluation of expression \n");
+            evalExpr(record, scan->rel->schema, recInfo->srch_cond, &value);
+            if(value->v.boolV == 1){
+                freeVal(value);
+                printf("next : COMPLETED \n");
+                return RC_OK;
+            }
+            freeVal(value);
         }
     }
-    
 }
 
 // dealing with schemas
@@ -1103,7 +1318,7 @@ int getRecordSize(Schema *schema){
 /* Function to create record */
 extern RC createRecord (Record **record, Schema *schema){
     printf("createRecord : START \n");
-    int size_of_record = sizeof(record);
+    int size_of_record = sizeof(Record);
     *record = (Record*)malloc(size_of_record);
     
     int size = getRecordSize(schema);
@@ -1236,7 +1451,8 @@ extern RC setAttr (Record *record, Schema *schema, int attrNum, Value *value){
             memcpy(record->data + offset, &(value->v.boolV), SIZE_OF_BOOL);
             break;
         case DT_STRING:
-            memcpy(record->data + offset, value->v.stringV, schema->typeLength[attrNum]);
+            // shorter strings are padded with zeros, the value need not be typeLength bytes long
+            strncpy(record->data + offset, value->v.stringV, schema->typeLength[attrNum]);
             break;
     }
     
@@ -1,17 +1,24 @@
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <errno.h>
 #include <unistd.h>
+#include <stdint.h>
+#include <pthread.h>
 #include "dberror.h"
 #include "storage_mgr.h"
+#include "storage_mgr_backend.h"
 
-int init=0;
+static int init=0;
 
 /*
  * Function checkinit()
- * Check the value of Global Variable used for initialization of storage manager.
+ * Check whether initStorageManager was called. It is the only state the storage manager keeps
+ * outside the file handles (besides the backends' registries of their files).
 */
 int checkinit (void)
 {
@@ -45,6 +52,767 @@ int delete(const char *fname)
 	return rrem;
 }
 
+/*
+ * Structure SM_FileHeader
+ * Stored at the start of the file, in front of the free page map of segment 0. SM_HEADER_SIZE keeps
+ * the map and page 0 aligned for O_DIRECT.
+*/
+#define SM_HEADER_SIZE 4096
+#define SM_FILE_MAGIC "CS525PGF"
+#define SM_FILE_VERSION 3
+
+typedef struct SM_FileHeader {
+	char magic[8];
+	int version;
+	int pageSize;
+	int numPages;		// pages in use, the file itself is sized by extents and may hold more
+} SM_FileHeader;
+
+/*
+ * Structure SM_Segment
+ * One file of a page file. Page p lives in segment p / segPages at page p % segPages,
+ * segment 0 is the file itself and segment i is "<fileName>.i". Every segment but the last is full.
+ * Each segment starts with the free page map of its own pages (after the file header in segment 0).
+*/
+typedef struct SM_Segment {
+	void *file;			// backend state of the segment file
+	int fd;			// its descriptor, -1 if the backend has none (no SM_IO_MAPPED, no async engine)
+	off_t base;			// bytes in front of the first page: file header and free page map
+	unsigned char *freeMap;	// mapBytes, bit i is set while page i of the segment is free
+	int mapDirty;		// freeMap changed since it was read, written back by closePageFile
+	int allocatedPages;	// pages this segment file has room for
+	char *map;			// SM_IO_MAPPED only: shared mapping of the segment
+	size_t mapSize;		// bytes reserved in the mapping, at least the segment allocation
+} SM_Segment;
+
+/*
+ * Structure SM_FileMgmt
+ * Per open file state kept behind SM_FileHandle->mgmtInfo.
+ * The segments are validated once by openPageFile, the I/O calls only hand positional transfers to the backend.
+*/
+typedef struct SM_FileMgmt {
+	char *fileName;		// own copy, segment names are derived from it
+	const SM_Backend *backend;	// stores every segment, chosen by the file name
+	SM_IOMode mode;
+	int pageSize;
+	int segPages;		// pages per segment file, SM_SEGMENT_SIZE / pageSize
+	int mapBytes;		// free page map of a segment, one bit per page rounded up to SM_DIRECT_ALIGN
+	int freePages;		// set bits over all segment maps
+	int freeHint;		// no page below this one is free
+	SM_Segment *segs;
+	int numSegs;
+	int segCapacity;
+	char *bounce;		// SM_IO_DIRECT only: aligned page for callers whose buffer is not aligned
+	SM_FileHeader *header;	// aligned SM_HEADER_SIZE copy of the file header, rewritten when the page count changes
+	pthread_mutex_t bounceLock;	// one transfer at a time goes through bounce, pool threads share the handle
+	int allocatedPages;	// pages the file physically has room for, totalNumPages <= allocatedPages
+	int openedPages;	// allocatedPages at open, room another handle may have reserved
+	int extentPages;	// the file grows by multiples of this many pages
+	SM_ExtentMode extentMode;
+} SM_FileMgmt;
+
+/************************************************************
+ *                   File backend							*
+ ************************************************************/
+
+/*
+ * Structure SM_DiskFile
+ * State of a plain file opened by the file backend.
+*/
+typedef struct SM_DiskFile {
+	int fd;
+} SM_DiskFile;
+
+/*
+ * Function transferv()
+ * preadv/pwritev of a run of iovecs starting at offset, resuming after short transfers.
+*/
+static RC transferv (int fd, struct iovec *iov, int iovcnt, off_t offset, int isWrite)
+{
+	ssize_t n;
+	while (iovcnt > 0)
+	{
+		n = isWrite ? pwritev(fd, iov, iovcnt, offset) : preadv(fd, iov, iovcnt, offset);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return isWrite ? RC_WRITE_FAILED : RC_READ_FAILED;
+		offset += n;
+		while (iovcnt > 0 && (size_t) n >= iov->iov_len)
+		{
+			n -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt > 0)
+		{
+			iov->iov_base = (char *) iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+	return RC_OK;
+}
+
+/*
+ * Function diskOpen()
+ * Opens the file read/write, with O_DIRECT for SM_IO_DIRECT. File systems without O_DIRECT support (tmpfs)
+ * refuse it with EINVAL, the file is opened for buffered I/O there.
+*/
+static RC diskOpen (const char *name, int flags, SM_IOMode *mode, void **file, off_t *size)
+{
+	SM_DiskFile *f;
+	struct stat st;
+	int openFlags = O_RDWR;
+	int fd;
+
+	if (flags & SM_OPEN_CREATE)
+		openFlags |= O_CREAT | ((flags & SM_OPEN_EXCL) ? O_EXCL : 0);
+	fd = (*mode == SM_IO_DIRECT) ? open(name, openFlags | O_DIRECT, 0644) : -1;
+	if (*mode == SM_IO_DIRECT && fd < 0 && errno == EINVAL)
+		*mode = SM_IO_BUFFERED;
+	if (*mode != SM_IO_DIRECT)
+		fd = open(name, openFlags, 0644);
+	if (fd < 0)
+	{
+		if (errno == EEXIST)
+			return RC_FILE_PRESENT;
+		return (flags & SM_OPEN_CREATE) ? RC_WRITE_FAILED : RC_FILE_NOT_FOUND;
+	}
+	f = (SM_DiskFile *) malloc(sizeof(SM_DiskFile));
+	if (f == NULL || fstat(fd, &st) != 0)
+	{
+		free(f);
+		close(fd);
+		return RC_FILE_NOT_FOUND;
+	}
+	f->fd = fd;
+	*file = f;
+	*size = st.st_size;
+	return RC_OK;
+}
+
+static RC diskRead (void *file, struct iovec *iov, int iovcnt, off_t offset)
+{
+	return transferv(((SM_DiskFile *) file)->fd, iov, iovcnt, offset, 0);
+}
+
+static RC diskWrite (void *file, struct iovec *iov, int iovcnt, off_t offset)
+{
+	return transferv(((SM_DiskFile *) file)->fd, iov, iovcnt, offset, 1);
+}
+
+/*
+ * Function diskExtend()
+ * fallocate reserves the blocks (ftruncate where the file system has no fallocate),
+ * sparse files only change their length.
+*/
+static RC diskExtend (void *file, off_t offset, off_t length, SM_ExtentMode extentMode)
+{
+	int fd = ((SM_DiskFile *) file)->fd;
+	if (extentMode != SM_EXTENT_FALLOCATE || fallocate(fd, 0, offset, length) != 0)
+	{
+		if (ftruncate(fd, offset + length) != 0)
+			return RC_WRITE_FAILED;
+	}
+	return RC_OK;
+}
+
+static RC diskTruncate (void *file, off_t size)
+{
+	return (ftruncate(((SM_DiskFile *) file)->fd, size) == 0) ? RC_OK : RC_WRITE_FAILED;
+}
+
+static RC diskSync (void *file)
+{
+	return (fdatasync(((SM_DiskFile *) file)->fd) == 0) ? RC_OK : RC_WRITE_FAILED;
+}
+
+static void diskClose (void *file)
+{
+	close(((SM_DiskFile *) file)->fd);
+	free(file);
+}
+
+static RC diskRemove (const char *name)
+{
+	if (unlink(name) != 0)
+		return (errno == ENOENT) ? RC_FILE_NOT_FOUND : RC_DELETE_FAILED;
+	return RC_OK;
+}
+
+/*
+ * Function diskDiscard()
+ * Punches a hole, errors are ignored: a file system that cannot punch holes just keeps the blocks.
+*/
+static void diskDiscard (void *file, off_t offset, off_t length)
+{
+	fallocate(((SM_DiskFile *) file)->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, length);
+}
+
+static int diskDescriptor (void *file)
+{
+	return ((SM_DiskFile *) file)->fd;
+}
+
+const SM_Backend SM_fileBackend = {
+	"",
+	diskOpen,
+	diskRead,
+	diskWrite,
+	diskExtend,
+	diskTruncate,
+	diskSync,
+	diskClose,
+	diskRemove,
+	diskDiscard,
+	diskDescriptor
+};
+
+/*
+ * Backends besides the file backend, looked up by file name prefix. Names no prefix matches
+ * use plainBackend, the file backend or the simulated disk (SM_SIMULATED_DISK, see initStorageManager).
+*/
+static const SM_Backend *backends[SM_MAX_BACKENDS] = { &SM_memBackend, &SM_simBackend };
+static int numBackends = 2;
+static const SM_Backend *plainBackend = &SM_fileBackend;
+
+/*
+ * Function readBytes()
+ * Reads exactly size bytes of a backend file at the given offset.
+*/
+static RC readBytes (const SM_Backend *backend, void *file, char *buf, size_t size, off_t offset)
+{
+	struct iovec iov;
+	iov.iov_base = buf;
+	iov.iov_len = size;
+	return backend->read(file, &iov, 1, offset);
+}
+
+/*
+ * Function writeBytes()
+ * Writes exactly size bytes to a backend file at the given offset.
+*/
+static RC writeBytes (const SM_Backend *backend, void *file, const char *buf, size_t size, off_t offset)
+{
+	struct iovec iov;
+	iov.iov_base = (void *) buf;
+	iov.iov_len = size;
+	return backend->write(file, &iov, 1, offset);
+}
+
+/*
+ * Function fileMgmt()
+ * Returns the per file state of an open handle or NULL if the handle was never opened or is already closed.
+*/
+static SM_FileMgmt *fileMgmt (SM_FileHandle *fHandle)
+{
+	if (fHandle == NULL)
+		return NULL;
+	return (SM_FileMgmt *) fHandle->mgmtInfo;
+}
+
+/*
+ * Function segmentName()
+ * Name of segment i of fileName, the file itself for segment 0. The caller frees the result.
+*/
+static char *segmentName (const char *fileName, int i)
+{
+	size_t len = strlen(fileName) + 16;
+	char *name = (char *) malloc(len);
+	if (name == NULL)
+		return NULL;
+	if (i == 0)
+		snprintf(name, len, "%s", fileName);
+	else
+		snprintf(name, len, "%s.%d", fileName, i);
+	return name;
+}
+
+/*
+ * Function pageSegment()
+ * The segment holding pageNum and the byte offset of the page inside it. The page must be allocated.
+*/
+static SM_Segment *pageSegment (SM_FileMgmt *mgmt, int pageNum, off_t *offset)
+{
+	SM_Segment *seg = &mgmt->segs[pageNum / mgmt->segPages];
+	*offset = seg->base + (off_t) (pageNum % mgmt->segPages) * mgmt->pageSize;
+	return seg;
+}
+
+/*
+ * Function mapSegment()
+ * Makes a mapped file's segment mapping cover the segment's allocation. The reservation grows
+ * geometrically up to the segment size so appending page by page is rarely an mremap.
+*/
+static RC mapSegment (SM_FileMgmt *mgmt, SM_Segment *seg)
+{
+	size_t needed = seg->base + (size_t) seg->allocatedPages * mgmt->pageSize;
+	size_t limit = seg->base + (size_t) mgmt->segPages * mgmt->pageSize;
+	size_t reserve;
+	char *map;
+
+	if (mgmt->mode != SM_IO_MAPPED || (seg->map != NULL && needed <= seg->mapSize))
+		return RC_OK;
+
+	// an empty segment still gets one page of address space so mremap always has a mapping to grow
+	reserve = (seg->mapSize > 0) ? seg->mapSize : (size_t) seg->base + mgmt->pageSize;
+	while (reserve < needed)
+		reserve *= 2;
+	if (reserve > limit && needed <= limit)
+		reserve = limit;
+
+	if (seg->map == NULL)
+		map = mmap(NULL, reserve, PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0);
+	else
+		map = mremap(seg->map, seg->mapSize, reserve, MREMAP_MAYMOVE);
+	if (map == MAP_FAILED)
+		return RC_WRITE_FAILED;
+	seg->map = map;
+	seg->mapSize = reserve;
+	return RC_OK;
+}
+
+/*
+ * Function freeMapBytes()
+ * Size of the free page map in front of the pages of each segment of a file with the given page size.
+*/
+static int freeMapBytes (int pageSize)
+{
+	int segPages = (SM_SEGMENT_SIZE > pageSize) ? SM_SEGMENT_SIZE / pageSize : 1;
+	int bytes = (segPages + 7) / 8;
+	return ((bytes + SM_DIRECT_ALIGN - 1) / SM_DIRECT_ALIGN) * SM_DIRECT_ALIGN;
+}
+
+/*
+ * Function countFreePages()
+ * Number of pages marked free in a segment's map.
+*/
+static int countFreePages (SM_FileMgmt *mgmt, SM_Segment *seg)
+{
+	int i, n = 0;
+	for (i = 0; i < mgmt->mapBytes; i++)
+		n += __builtin_popcount(seg->freeMap[i]);
+	return n;
+}
+
+/*
+ * Function openSegment()
+ * Opens the next segment file (creating it if asked to) and appends it to the segment array.
+*/
+static RC openSegment (SM_FileMgmt *mgmt, int create)
+{
+	SM_Segment *seg;
+	void *file;
+	off_t size;
+	char *name;
+	RC rc;
+
+	if (mgmt->numSegs == mgmt->segCapacity)
+	{
+		seg = (SM_Segment *) realloc(mgmt->segs, sizeof(SM_Segment) * (mgmt->segCapacity * 2));
+		if (seg == NULL)
+			return RC_FILE_HANDLE_NOT_INIT;
+		mgmt->segs = seg;
+		mgmt->segCapacity *= 2;
+	}
+
+	name = segmentName(mgmt->fileName, mgmt->numSegs);
+	if (name == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+	rc = mgmt->backend->open(name, create ? SM_OPEN_CREATE : 0, &mgmt->mode, &file, &size);
+	free(name);
+	if (rc != RC_OK)
+		return rc;
+
+	seg = &mgmt->segs[mgmt->numSegs];
+	seg->file = file;
+	seg->fd = (mgmt->backend->fd != NULL) ? mgmt->backend->fd(file) : -1;
+	seg->base = ((mgmt->numSegs == 0) ? SM_HEADER_SIZE : 0) + mgmt->mapBytes;
+	seg->allocatedPages = (size > seg->base) ? (int) ((size - seg->base) / mgmt->pageSize) : 0;
+	seg->map = NULL;
+	seg->mapSize = 0;
+	seg->mapDirty = 0;
+	if (posix_memalign((void **) &seg->freeMap, SM_DIRECT_ALIGN, mgmt->mapBytes) != 0)
+	{
+		mgmt->backend->close(file);
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	// a new segment has no map on disk yet, none of its pages is free
+	memset(seg->freeMap, 0, mgmt->mapBytes);
+	if ((size >= seg->base && readBytes(mgmt->backend, file, (char *) seg->freeMap, mgmt->mapBytes, seg->base - mgmt->mapBytes) != RC_OK)
+		|| mapSegment(mgmt, seg) != RC_OK)
+	{
+		free(seg->freeMap);
+		mgmt->backend->close(file);
+		return RC_FILE_NOT_FOUND;
+	}
+	mgmt->freePages += countFreePages(mgmt, seg);
+	mgmt->numSegs++;
+	return RC_OK;
+}
+
+/*
+ * Function shrinkSegments()
+ * Gives back the space past the first keepPages pages: trailing segments holding none of them are
+ * closed and removed, the others are truncated to the pages they keep. The truncated pages are gone
+ * for good, so pages inside the allocation but past totalNumPages still read back as zeros.
+*/
+static RC shrinkSegments (SM_FileMgmt *mgmt, int keepPages)
+{
+	SM_Segment *seg;
+	char *name;
+	int i, keep;
+	RC rc = RC_OK;
+
+	while (mgmt->numSegs > 1 && (mgmt->numSegs - 1) * mgmt->segPages >= keepPages)
+	{
+		seg = &mgmt->segs[mgmt->numSegs - 1];
+		if (seg->map != NULL)
+			munmap(seg->map, seg->mapSize);
+		free(seg->freeMap);
+		mgmt->backend->close(seg->file);
+		name = segmentName(mgmt->fileName, mgmt->numSegs - 1);
+		if (name != NULL)
+			mgmt->backend->remove(name);
+		free(name);
+		mgmt->numSegs--;
+	}
+
+	for (i = 0; i < mgmt->numSegs; i++)
+	{
+		seg = &mgmt->segs[i];
+		keep = keepPages - i * mgmt->segPages;
+		if (keep < 0)
+			keep = 0;
+		if (keep > mgmt->segPages)
+			keep = mgmt->segPages;
+		if (seg->allocatedPages > keep)
+		{
+			if (mgmt->backend->truncate(seg->file, seg->base + (off_t) keep * mgmt->pageSize) != RC_OK)
+				rc = RC_WRITE_FAILED;
+			else
+				seg->allocatedPages = keep;
+		}
+	}
+	mgmt->allocatedPages = (mgmt->numSegs - 1) * mgmt->segPages + mgmt->segs[mgmt->numSegs - 1].allocatedPages;
+	return rc;
+}
+
+/*
+ * Function closeSegments()
+ * Unmaps and closes every segment. With keepPages >= 0 the file is first shrunk to the pages in use
+ * (see shrinkSegments) and changed free page maps are written back.
+*/
+static void closeSegments (SM_FileMgmt *mgmt, int keepPages)
+{
+	SM_Segment *seg;
+	int i;
+
+	if (keepPages >= 0)
+		shrinkSegments(mgmt, keepPages);
+	for (i = 0; i < mgmt->numSegs; i++)
+	{
+		seg = &mgmt->segs[i];
+		if (seg->map != NULL)
+			munmap(seg->map, seg->mapSize);
+		if (keepPages >= 0 && seg->mapDirty)
+			writeBytes(mgmt->backend, seg->file, (char *) seg->freeMap, mgmt->mapBytes, seg->base - mgmt->mapBytes);
+		free(seg->freeMap);
+		mgmt->backend->close(seg->file);
+	}
+	mgmt->numSegs = 0;
+}
+
+/*
+ * Function freeFileMgmt()
+ * Releases the per file state after its segments are closed.
+*/
+static void freeFileMgmt (SM_FileMgmt *mgmt)
+{
+	free(mgmt->segs);
+	free(mgmt->fileName);
+	free(mgmt->bounce);
+	free(mgmt->header);
+	pthread_mutex_destroy(&mgmt->bounceLock);
+	free(mgmt);
+}
+
+/*
+ * Function isAligned()
+ * O_DIRECT transfers need the user buffer on a SM_DIRECT_ALIGN boundary.
+*/
+static int isAligned (const char *buf)
+{
+	return ((uintptr_t) buf % SM_DIRECT_ALIGN) == 0;
+}
+
+/*
+ * Function readPage()
+ * Reads one allocated page. Mapped files copy out of the mapping, direct handles bounce unaligned buffers
+ * through their aligned page (the buffer pool arena is page aligned so its frames never need the extra copy).
+*/
+static RC readPage (SM_FileMgmt *mgmt, char *memPage, int pageNum)
+{
+	off_t offset;
+	SM_Segment *seg = pageSegment(mgmt, pageNum, &offset);
+	RC rc;
+
+	if (mgmt->mode == SM_IO_MAPPED)
+	{
+		memcpy(memPage, seg->map + offset, mgmt->pageSize);
+		return RC_OK;
+	}
+	if (mgmt->mode != SM_IO_DIRECT || isAligned(memPage))
+		return readBytes(mgmt->backend, seg->file, memPage, mgmt->pageSize, offset);
+	pthread_mutex_lock(&mgmt->bounceLock);
+	rc = readBytes(mgmt->backend, seg->file, mgmt->bounce, mgmt->pageSize, offset);
+	if (rc == RC_OK)
+		memcpy(memPage, mgmt->bounce, mgmt->pageSize);
+	pthread_mutex_unlock(&mgmt->bounceLock);
+	return rc;
+}
+
+/*
+ * Function writePage()
+ * Writes one allocated page, the counterpart of readPage.
+*/
+static RC writePage (SM_FileMgmt *mgmt, const char *memPage, int pageNum)
+{
+	off_t offset;
+	SM_Segment *seg = pageSegment(mgmt, pageNum, &offset);
+	RC rc;
+
+	if (mgmt->mode == SM_IO_MAPPED)
+	{
+		if (seg->map + offset != memPage)
+			memcpy(seg->map + offset, memPage, mgmt->pageSize);
+		return RC_OK;
+	}
+	if (mgmt->mode != SM_IO_DIRECT || isAligned(memPage))
+		return writeBytes(mgmt->backend, seg->file, memPage, mgmt->pageSize, offset);
+	pthread_mutex_lock(&mgmt->bounceLock);
+	memcpy(mgmt->bounce, memPage, mgmt->pageSize);
+	rc = writeBytes(mgmt->backend, seg->file, mgmt->bounce, mgmt->pageSize, offset);
+	pthread_mutex_unlock(&mgmt->bounceLock);
+	return rc;
+}
+
+/*
+ * Function allocatePages()
+ * Makes sure the file has room for at least numberOfPages pages. Room is added a whole extent at a time,
+ * reserved up front or left sparse as the extent mode says (see the backend's extend operation), so pages inside the allocation are already zero and extending the file over them needs no syscall.
+ * Growth that crosses a segment boundary fills the current segment and creates the next one.
+*/
+static RC allocatePages (SM_FileMgmt *mgmt, int numberOfPages)
+{
+	SM_Segment *seg;
+	int target, s, segTarget;
+	RC rc;
+
+	if (numberOfPages <= mgmt->allocatedPages)
+		return RC_OK;
+
+	target = ((numberOfPages + mgmt->extentPages - 1) / mgmt->extentPages) * mgmt->extentPages;
+	while (mgmt->allocatedPages < target)
+	{
+		s = mgmt->allocatedPages / mgmt->segPages;
+		if (s >= mgmt->numSegs)
+		{
+			rc = openSegment(mgmt, 1);
+			if (rc != RC_OK)
+				return rc;
+		}
+		seg = &mgmt->segs[s];
+		segTarget = target - s * mgmt->segPages;
+		if (segTarget > mgmt->segPages)
+			segTarget = mgmt->segPages;
+
+		rc = mgmt->backend->extend(seg->file, seg->base + (off_t) seg->allocatedPages * mgmt->pageSize,
+			(off_t) (segTarget - seg->allocatedPages) * mgmt->pageSize, mgmt->extentMode);
+		if (rc != RC_OK)
+			return rc;
+		seg->allocatedPages = segTarget;
+		mgmt->allocatedPages = s * mgmt->segPages + segTarget;
+
+		rc = mapSegment(mgmt, seg);
+		if (rc != RC_OK)
+			return rc;
+	}
+	return RC_OK;
+}
+
+/*
+ * Function transferPages()
+ * Moves count pages between the file run starting at startPage and the (possibly scattered) buffers in pages.
+ * Buffered and aligned direct I/O go to the backend as one transfer of up to SM_MAX_IOV pages, split where
+ * the run crosses into the next segment. Mapped files and direct handles with an unaligned buffer
+ * go page by page. The caller checks bounds and allocates first.
+*/
+static RC transferPages (SM_FileMgmt *mgmt, int startPage, int count, SM_PageHandle *pages, int isWrite)
+{
+	struct iovec iov[SM_MAX_IOV];
+	SM_Segment *seg;
+	off_t offset;
+	int i, n;
+	int perPage = (mgmt->mode == SM_IO_MAPPED);
+	RC rc;
+
+	if (mgmt->mode == SM_IO_DIRECT)
+		for (i = 0; i < count; i++)
+			if (!isAligned(pages[i]))
+				perPage = 1;
+
+	if (perPage)
+	{
+		for (i = 0; i < count; i++)
+		{
+			rc = isWrite ? writePage(mgmt, pages[i], startPage + i) : readPage(mgmt, pages[i], startPage + i);
+			if (rc != RC_OK)
+				return rc;
+		}
+		return RC_OK;
+	}
+
+	while (count > 0)
+	{
+		n = (count < SM_MAX_IOV) ? count : SM_MAX_IOV;
+		if (n > mgmt->segPages - startPage % mgmt->segPages)
+			n = mgmt->segPages - startPage % mgmt->segPages;
+		for (i = 0; i < n; i++)
+		{
+			iov[i].iov_base = pages[i];
+			iov[i].iov_len = mgmt->pageSize;
+		}
+		seg = pageSegment(mgmt, startPage, &offset);
+		rc = isWrite ? mgmt->backend->write(seg->file, iov, n, offset) : mgmt->backend->read(seg->file, iov, n, offset);
+		if (rc != RC_OK)
+			return rc;
+		startPage += n;
+		pages += n;
+		count -= n;
+	}
+	return RC_OK;
+}
+
+/*
+ * Function validPageSize()
+ * Page sizes are powers of two between SM_MIN_PAGE_SIZE and SM_MAX_PAGE_SIZE.
+*/
+static int validPageSize (int pageSize)
+{
+	return pageSize >= SM_MIN_PAGE_SIZE && pageSize <= SM_MAX_PAGE_SIZE && (pageSize & (pageSize - 1)) == 0;
+}
+
+/*
+ * Function readFileHeader()
+ * Reads and checks the header of a page file, which holds the page size it was created with and its page count.
+*/
+static RC readFileHeader (const SM_Backend *backend, char *fileName, SM_FileHeader *header)
+{
+	SM_IOMode mode = SM_IO_BUFFERED;
+	void *file;
+	off_t size;
+	RC rc;
+
+	rc = backend->open(fileName, 0, &mode, &file, &size);
+	if (rc != RC_OK)
+		return rc;
+	rc = readBytes(backend, file, (char *) header, sizeof(SM_FileHeader), 0);
+	backend->close(file);
+	if (rc != RC_OK || memcmp(header->magic, SM_FILE_MAGIC, sizeof(header->magic)) != 0
+		|| header->version != SM_FILE_VERSION || !validPageSize(header->pageSize)
+		|| header->numPages < 1)
+		return RC_INVALID_PAGE_FILE;
+	return RC_OK;
+}
+
+/*
+ * Function setPageCount()
+ * Changes totalNumPages and writes the new count to the file header, so the next open sees exactly
+ * the pages in use rather than the allocation of the last extent.
+*/
+static RC setPageCount (SM_FileHandle *fHandle, int numPages)
+{
+	SM_FileMgmt *mgmt = fileMgmt(fHandle);
+
+	fHandle->totalNumPages = numPages;
+	if (mgmt->header->numPages == numPages)
+		return RC_OK;
+	mgmt->header->numPages = numPages;
+	return writeBytes(mgmt->backend, mgmt->segs[0].file, (char *) mgmt->header, SM_HEADER_SIZE, 0);
+}
+
+/*
+ * Function openWithMode()
+ * Opens the file and any further segments for the given I/O mode. Shared by the openPageFile variants.
+ * The backend may fall back to buffered I/O (no O_DIRECT on tmpfs, nothing to map in memory files).
+*/
+static RC openWithMode (char *fileName, SM_FileHandle *fHandle, SM_IOMode mode)
+{
+	const SM_Backend *backend = getStorageBackend(fileName);
+	SM_FileMgmt *mgmt;
+	SM_FileHeader header;
+	int pageSize;
+	RC rc;
+
+	rc = readFileHeader(backend, fileName, &header);
+	if (rc != RC_OK)
+		return rc;
+	pageSize = header.pageSize;
+	if (mode == SM_IO_MAPPED && backend->fd == NULL)
+		mode = SM_IO_BUFFERED;
+
+	mgmt = (SM_FileMgmt *) calloc(1, sizeof(SM_FileMgmt));
+	if (mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+	pthread_mutex_init(&mgmt->bounceLock, NULL);
+	mgmt->fileName = strdup(fileName);
+	mgmt->backend = backend;
+	mgmt->mode = mode;
+	mgmt->pageSize = pageSize;
+	mgmt->segPages = (SM_SEGMENT_SIZE > pageSize) ? SM_SEGMENT_SIZE / pageSize : 1;
+	mgmt->mapBytes = freeMapBytes(pageSize);
+	mgmt->segCapacity = 4;
+	mgmt->segs = (SM_Segment *) malloc(sizeof(SM_Segment) * mgmt->segCapacity);
+	mgmt->extentPages = SM_DEFAULT_EXTENT_PAGES;
+	mgmt->extentMode = SM_EXTENT_FALLOCATE;
+	if (mgmt->fileName == NULL || mgmt->segs == NULL
+		|| posix_memalign((void **) &mgmt->header, SM_DIRECT_ALIGN, SM_HEADER_SIZE) != 0)
+	{
+		freeFileMgmt(mgmt);
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	memset(mgmt->header, 0, SM_HEADER_SIZE);
+	memcpy(mgmt->header, &header, sizeof(SM_FileHeader));
+
+	// segment 0 must exist, a full segment may be followed by the next one
+	rc = openSegment(mgmt, 0);
+	if (rc != RC_OK)
+	{
+		freeFileMgmt(mgmt);
+		return rc;
+	}
+	if (mgmt->mode == SM_IO_DIRECT && posix_memalign((void **) &mgmt->bounce, SM_DIRECT_ALIGN, pageSize) != 0)
+	{
+		closeSegments(mgmt, -1);
+		freeFileMgmt(mgmt);
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	mgmt->allocatedPages = mgmt->segs[0].allocatedPages;
+	while (mgmt->segs[mgmt->numSegs-1].allocatedPages >= mgmt->segPages
+		&& openSegment(mgmt, 0) == RC_OK)
+		mgmt->allocatedPages += mgmt->segs[mgmt->numSegs-1].allocatedPages;
+	mgmt->openedPages = mgmt->allocatedPages;
+
+	// a file cut short by a crash has fewer pages than its header counts
+	fHandle->totalNumPages = (header.numPages < mgmt->allocatedPages) ? header.numPages : mgmt->allocatedPages;
+	fHandle->curPagePos = 0;
+	fHandle->pageSize = pageSize;
+	fHandle->fileName = fileName;
+	fHandle->mgmtInfo = mgmt;
+	return RC_OK;
+}
+
 /************************************************************
  *                   Interface								*
  ************************************************************/
@@ -52,12 +820,17 @@ int delete(const char *fname)
 /*
  * Function initStorageManager()
  * The function will check if the storage manager is initialized.
+ * With SM_SIMULATED_DISK set to a disk profile (hdd, ssd, cloud) plain page files go to the simulated disk.
 */
 void initStorageManager (void)
 {
+    const char *disk;
     if (checkinit() != RC_OK)
     	{
     		init=1;
+    		disk = getenv("SM_SIMULATED_DISK");
+    		if (disk != NULL && setDiskProfileName(disk) == RC_OK)
+    			plainBackend = &SM_simBackend;
     		printf("Storage manager is initialized\n");
     	}
     else
@@ -70,30 +843,42 @@ void initStorageManager (void)
 */
 RC createPageFile (char *fileName)
 {
-	int i;
-	char emptyblock[PAGE_SIZE];
-	int writef;
+	return createPageFileSize(fileName, PAGE_SIZE);
+}
+
+/*
+ * Function createPageFileSize()
+ * Creates a file of one empty page of pageSize bytes. The page size is written to the file header
+ * and fixed for the life of the file, every handle opened on it reads and writes pages of that size.
+ * The header is followed by an empty free page map.
+*/
+RC createPageFileSize (char *fileName, int pageSize)
+{
+	const SM_Backend *backend = getStorageBackend(fileName);
+	char header[SM_HEADER_SIZE];
+	SM_FileHeader *h = (SM_FileHeader *) header;
+	SM_IOMode mode = SM_IO_BUFFERED;
+	void *file;
+	off_t size;
+	RC rc;
 	if (checkinit() == RC_OK)
 	{
-		if (exists(fileName))
-		{
-			return RC_FILE_PRESENT;
-		}
-		else
-		{
-			FILE *fp=fopen(fileName, "wb");
-			for(i=0;i<PAGE_SIZE;i++)
-			{
-				emptyblock[i]=0;
-			}
-			writef=fwrite(emptyblock, 1, PAGE_SIZE, fp);
-			        if (writef < PAGE_SIZE)
-			        {
-			          fclose(fp);
-			          return RC_WRITE_FAILED;
-			        }
-			return RC_OK;
-		}
+		if (!validPageSize(pageSize))
+			return RC_INVALID_PAGE_SIZE;
+		rc = backend->open(fileName, SM_OPEN_CREATE | SM_OPEN_EXCL, &mode, &file, &size);
+		if (rc != RC_OK)
+			return rc;
+		memset(header, 0, SM_HEADER_SIZE);
+		memcpy(h->magic, SM_FILE_MAGIC, sizeof(h->magic));
+		h->version = SM_FILE_VERSION;
+		h->pageSize = pageSize;
+		h->numPages = 1;
+		rc = writeBytes(backend, file, header, SM_HEADER_SIZE, 0);
+		// the free page map and the first page read back as zeros without writing them
+		if (rc == RC_OK)
+			rc = backend->truncate(file, (off_t) SM_HEADER_SIZE + freeMapBytes(pageSize) + pageSize);
+		backend->close(file);
+		return rc;
 	}
 	else
 	{
@@ -104,35 +889,40 @@ RC createPageFile (char *fileName)
 /*
  * Function openPageFile()
  * Opens the Created file in read/write mode and assigns the file details in the File Handler required for further file processing
+ * This is the only place the file is validated, the size is cached in totalNumPages from here on.
 */
 RC openPageFile (char *fileName, SM_FileHandle *fHandle)
 {
-	int readl = 0;
 	if (checkinit() == RC_OK)
-		{
-			if (exists(fileName))
-			{
-				FILE *fp=fopen(fileName, "rb+");
+		return openWithMode(fileName, fHandle, SM_IO_BUFFERED);
+	else
+		return RC_STORAGE_MGR_NOT_INIT;
+}
 
-				readl=fseek(fp,0,SEEK_END);
+/*
+ * Function openPageFileMode()
+ * Opens the file with an explicit I/O mode. SM_IO_DIRECT bypasses the kernel page cache so the buffer pool
+ * is the only cache, it falls back to buffered I/O on file systems that do not support O_DIRECT.
+*/
+RC openPageFileMode (char *fileName, SM_FileHandle *fHandle, SM_IOMode mode)
+{
+	if (checkinit() == RC_OK)
+		return openWithMode(fileName, fHandle, mode);
+	else
+		return RC_STORAGE_MGR_NOT_INIT;
+}
 
-				//fseek(fp, 0, SEEK_END);
-				fHandle->totalNumPages = (int) (ftell(fp)/PAGE_SIZE);
-				fseek(fp, 0, SEEK_SET);
-				fHandle->curPagePos = 0;
-				fHandle->fileName = fileName;
-				fHandle->mgmtInfo = fp;
-				return RC_OK;
-			}
-			else
-			{
-				return RC_FILE_NOT_FOUND;
-			}
-		}
-		else
-		{
-			return RC_STORAGE_MGR_NOT_INIT;
-		}
+/*
+ * Function openPageFileMapped()
+ * Opens the file like openPageFile but maps it into memory. readBlock and writeBlock become plain memcpy,
+ * getBlockPointer hands out the page in the mapping itself and the OS page cache is the only copy of the data.
+*/
+RC openPageFileMapped (char *fileName, SM_FileHandle *fHandle)
+{
+	if (checkinit() == RC_OK)
+		return openWithMode(fileName, fHandle, SM_IO_MAPPED);
+	else
+		return RC_STORAGE_MGR_NOT_INIT;
 }
 
 /*
@@ -141,21 +931,20 @@ RC openPageFile (char *fileName, SM_FileHandle *fHandle)
 */
 RC closePageFile (SM_FileHandle *fHandle)
 {
+	SM_FileMgmt *mgmt;
 	if (checkinit() == RC_OK)
 		{
-			if (exists(fHandle->fileName))
-			{
-				fclose(fHandle->mgmtInfo);
-				fHandle->totalNumPages=-1;
-				fHandle->curPagePos=-1;
-				fHandle->curPagePos='\0';
-				fHandle->mgmtInfo=NULL;
-				return RC_OK;
-			}
-			else
-			{
-				return RC_FILE_NOT_FOUND;
-			}
+			mgmt = fileMgmt(fHandle);
+			if (mgmt == NULL)
+				return RC_FILE_HANDLE_NOT_INIT;
+			// give back the unused part of the last extent so the file length is the page count again.
+			// Only the room this handle added goes, extents that were there at open may belong to another handle.
+			closeSegments(mgmt, (fHandle->totalNumPages > mgmt->openedPages) ? fHandle->totalNumPages : mgmt->openedPages);
+			freeFileMgmt(mgmt);
+			fHandle->totalNumPages=-1;
+			fHandle->curPagePos=-1;
+			fHandle->mgmtInfo=NULL;
+			return RC_OK;
 		}
 		else
 		{
@@ -165,65 +954,62 @@ RC closePageFile (SM_FileHandle *fHandle)
 
 /*
  * Function destroyPageFile()
- * Deletes the file from the system.
+ * Deletes the file from the system, together with its further segments.
 */
 RC destroyPageFile (char *fileName)
 {
-	int rd;
+	const SM_Backend *backend = getStorageBackend(fileName);
+	char *name;
+	int i;
+	RC rc;
 	if (checkinit() == RC_OK)
 	{
-		if (exists(fileName))
-		{
-			rd=delete(fileName);
-			if(rd==0)
-			return RC_OK;
-			else
-			return RC_DELETE_FAILED;
-		}
-		else
+		rc = backend->remove(fileName);
+		if (rc != RC_OK)
+			return rc;
+		for (i = 1; ; i++)
 		{
-			return RC_FILE_NOT_FOUND;
+			name = segmentName(fileName, i);
+			if (name == NULL || backend->remove(name) != RC_OK)
+				break;
+			free(name);
 		}
+		free(name);
+		return RC_OK;
 	}
 	else
 	{
 		return RC_STORAGE_MGR_NOT_INIT;
 	}
-	return RC_OK;
 }
 
 /*
  * Function readBlock()
  * Reads the content of specified file page in the Page handler.
+ * One pread at the page offset (a memcpy out of the mapping in mapped mode), no seek and no per call file checks.
+ * Page offsets are 64 bit, pages past the first segment come from the further segment files.
+ * The buffer pool reads through one handle from many threads, the position is stored atomically.
 */
 RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
-	char emptyblock[PAGE_SIZE];
-	FILE *fd=fHandle->mgmtInfo;
-	int seekpage= PAGE_SIZE*pageNum;
-	int readp;
-	int readl;
+	SM_FileMgmt *mgmt;
+	RC rc = RC_OK;
 	if (checkinit() == RC_OK)
 		{
-			if (exists(fHandle->fileName))
+			mgmt = fileMgmt(fHandle);
+			if (mgmt == NULL)
+				return RC_FILE_HANDLE_NOT_INIT;
+			if((pageNum<fHandle->totalNumPages) && (pageNum>=0))
 			{
-				if((pageNum<fHandle->totalNumPages) && (pageNum>=0))
-				{
-					readl=fseek(fd,seekpage,SEEK_SET);
-					readp=fread(memPage,1,PAGE_SIZE, fd);
-					if (readp < PAGE_SIZE)
-				        return RC_READ_FAILED;
-					fHandle->curPagePos=pageNum;
-					return RC_OK;
-				}
-				else
-				{
-					return RC_READ_NON_EXISTING_PAGE;
-				}
+				rc = readPage(mgmt, memPage, pageNum);
+				if (rc != RC_OK)
+					return rc;
+				__atomic_store_n(&fHandle->curPagePos, pageNum, __ATOMIC_RELAXED);
+				return RC_OK;
 			}
 			else
 			{
-				return RC_FILE_NOT_FOUND;
+				return RC_READ_NON_EXISTING_PAGE;
 			}
 		}
 		else
@@ -239,22 +1025,74 @@ RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
 int getBlockPos (SM_FileHandle *fHandle)
 {
 	if (checkinit() == RC_OK)
-			{
-				if (exists(fHandle->fileName))
-				{
-					return(fHandle->curPagePos);
-				}
-				else
-				{
-					return RC_FILE_NOT_FOUND;
-				}
-			}
+		{
+			if (fileMgmt(fHandle) == NULL)
+				return RC_FILE_HANDLE_NOT_INIT;
+			return(fHandle->curPagePos);
+		}
 	else
 	{
-				return RC_STORAGE_MGR_NOT_INIT;
+		return RC_STORAGE_MGR_NOT_INIT;
 	}
 }
 
+/*
+ * Function readBlocksv()
+ * Scatter read: page startPage+i of the file goes into pages[i], the buffers need not be adjacent in memory.
+*/
+RC readBlocksv (int startPage, int count, SM_FileHandle *fHandle, SM_PageHandle *pages)
+{
+	SM_FileMgmt *mgmt;
+	RC rc;
+	if (checkinit() == RC_OK)
+		{
+			mgmt = fileMgmt(fHandle);
+			if (mgmt == NULL)
+				return RC_FILE_HANDLE_NOT_INIT;
+			if (count <= 0)
+				return RC_OK;
+			if((startPage>=0) && (startPage+count<=fHandle->totalNumPages))
+			{
+				rc = transferPages(mgmt, startPage, count, pages, 0);
+				if (rc != RC_OK)
+					return rc;
+				__atomic_store_n(&fHandle->curPagePos, startPage+count-1, __ATOMIC_RELAXED);
+				return RC_OK;
+			}
+			else
+			{
+				return RC_READ_NON_EXISTING_PAGE;
+			}
+		}
+		else
+		{
+			return RC_STORAGE_MGR_NOT_INIT;
+		}
+}
+
+/*
+ * Function readBlocks()
+ * Reads count consecutive pages starting at startPage into one contiguous buffer of count pages.
+*/
+RC readBlocks (int startPage, int count, SM_FileHandle *fHandle, SM_PageHandle memPages)
+{
+	SM_PageHandle pages[SM_MAX_IOV];
+	int i, n;
+	RC rc;
+
+	do
+	{
+		n = (count < SM_MAX_IOV) ? count : SM_MAX_IOV;
+		for (i = 0; i < n; i++)
+			pages[i] = memPages + (size_t) i * fHandle->pageSize;
+		rc = readBlocksv(startPage, n, fHandle, pages);
+		startPage += n;
+		memPages += (size_t) n * fHandle->pageSize;
+		count -= n;
+	} while (rc == RC_OK && count > 0);
+	return rc;
+}
+
 /*
  * Function readFirstBlock()
  * Reads the first page into the Page handler.
@@ -303,39 +1141,81 @@ RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
 /*
  * Function writeBlock()
  * Writes the data from the Page Handler to the file.
+ * One pwrite at the page offset (a memcpy into the mapping in mapped mode), writing past the end grows the file and totalNumPages.
 */
 RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
-	FILE *fd=fHandle->mgmtInfo;
-	int seekpage= PAGE_SIZE*pageNum;
-	int readp;
-	int readl;
-
+	SM_FileMgmt *mgmt;
+	RC rc = RC_OK;
 	if (checkinit() == RC_OK)
 		{
-			if (exists(fHandle->fileName))
+			mgmt = fileMgmt(fHandle);
+			if (mgmt == NULL)
+				return RC_FILE_HANDLE_NOT_INIT;
+			if(pageNum>=0)
 			{
-				if(pageNum>=0)
+				if (pageNum >= mgmt->allocatedPages)
+					rc = allocatePages(mgmt, pageNum + 1);
+				if (rc != RC_OK)
+					return rc;
+				rc = writePage(mgmt, memPage, pageNum);
+				if (rc != RC_OK)
+					return rc;
+				if(pageNum>=fHandle->totalNumPages) //to create pages
 				{
-					readl=fseek(fd,seekpage,SEEK_SET);
-					if(pageNum>=fHandle->totalNumPages) //to create pages // checking
-					{
-						fHandle->totalNumPages=pageNum+1;
-					}
-					readp=fwrite(memPage,1,PAGE_SIZE, fd);
-				    if ( readp< PAGE_SIZE)
-				        return RC_WRITE_FAILED;
-					fHandle->curPagePos=pageNum;
-					return RC_OK;
+					rc = setPageCount(fHandle, pageNum+1);
+					if (rc != RC_OK)
+						return rc;
 				}
-				else
+				__atomic_store_n(&fHandle->curPagePos, pageNum, __ATOMIC_RELAXED);
+				return RC_OK;
+			}
+			else
+			{
+				return RC_INVALID_PAGE_NUMBER;
+			}
+		}
+		else
+		{
+			return RC_STORAGE_MGR_NOT_INIT;
+		}
+}
+
+/*
+ * Function writeBlocksv()
+ * Gather write: pages[i] goes to page startPage+i of the file. Writing past the end grows the file like writeBlock.
+*/
+RC writeBlocksv (int startPage, int count, SM_FileHandle *fHandle, SM_PageHandle *pages)
+{
+	SM_FileMgmt *mgmt;
+	RC rc = RC_OK;
+	if (checkinit() == RC_OK)
+		{
+			mgmt = fileMgmt(fHandle);
+			if (mgmt == NULL)
+				return RC_FILE_HANDLE_NOT_INIT;
+			if (count <= 0)
+				return RC_OK;
+			if(startPage>=0)
+			{
+				if (startPage + count > mgmt->allocatedPages)
+					rc = allocatePages(mgmt, startPage + count);
+				if (rc == RC_OK)
+					rc = transferPages(mgmt, startPage, count, pages, 1);
+				if (rc != RC_OK)
+					return rc;
+				if(startPage+count>fHandle->totalNumPages)
 				{
-					return RC_INVALID_PAGE_NUMBER;
+					rc = setPageCount(fHandle, startPage+count);
+					if (rc != RC_OK)
+						return rc;
 				}
+				__atomic_store_n(&fHandle->curPagePos, startPage+count-1, __ATOMIC_RELAXED);
+				return RC_OK;
 			}
 			else
 			{
-				return RC_FILE_NOT_FOUND;
+				return RC_INVALID_PAGE_NUMBER;
 			}
 		}
 		else
@@ -344,6 +1224,29 @@ RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
 		}
 }
 
+/*
+ * Function writeBlocks()
+ * Writes count consecutive pages from one contiguous buffer starting at startPage.
+*/
+RC writeBlocks (int startPage, int count, SM_FileHandle *fHandle, SM_PageHandle memPages)
+{
+	SM_PageHandle pages[SM_MAX_IOV];
+	int i, n;
+	RC rc;
+
+	do
+	{
+		n = (count < SM_MAX_IOV) ? count : SM_MAX_IOV;
+		for (i = 0; i < n; i++)
+			pages[i] = memPages + (size_t) i * fHandle->pageSize;
+		rc = writeBlocksv(startPage, n, fHandle, pages);
+		startPage += n;
+		memPages += (size_t) n * fHandle->pageSize;
+		count -= n;
+	} while (rc == RC_OK && count > 0);
+	return rc;
+}
+
 /*
  * Function writeCurrentBlock()
  * Writes the data present of the specified page from the Page Handler to the file.
@@ -359,21 +1262,75 @@ RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
 */
 RC appendEmptyBlock (SM_FileHandle *fHandle)
 {
-	int i;
-	char emptyblock[PAGE_SIZE];
-	for(i=0;i<PAGE_SIZE;i++)
-		emptyblock[i]=0;
+	if (checkinit() == RC_OK)
+		{
+			if (fileMgmt(fHandle) == NULL)
+				return RC_FILE_HANDLE_NOT_INIT;
+			return ensureCapacity (fHandle->totalNumPages+1, fHandle);
+		}
+		else
+		{
+			return RC_STORAGE_MGR_NOT_INIT;
+		}
+}
+
+/*
+ * Function ensureCapacity()
+ * Checks if the number of the pages in the file is equal to the specified Page Number
+ * Appends new blocks to the file if it is less than specified capacity.
+ * Nothing is written: new pages come out of the preallocated extents and read back as zeros,
+ * only running past the allocation costs a syscall (see allocatePages).
+*/
+RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle)
+{
+	SM_FileMgmt *mgmt;
+	RC rc;
+	if (checkinit() == RC_OK)
+		{
+			mgmt = fileMgmt(fHandle);
+			if (mgmt == NULL)
+				return RC_FILE_HANDLE_NOT_INIT;
+			if (numberOfPages <= fHandle->totalNumPages)
+				return RC_OK;
+			rc = allocatePages(mgmt, numberOfPages);
+			if (rc == RC_OK)
+				rc = setPageCount(fHandle, numberOfPages);
+			return rc;
+		}
+		else
+		{
+			return RC_STORAGE_MGR_NOT_INIT;
+		}
+}
 
+/*
+ * Function getBlockPointer()
+ * Zero copy access for files opened with openPageFileMapped: points *page at the page inside the mapping.
+ * Stores to it go straight to the file. The pointer is only good until the file grows,
+ * ensureCapacity, appendEmptyBlock and writes past the end may move the mapping.
+*/
+RC getBlockPointer (int pageNum, SM_FileHandle *fHandle, SM_PageHandle *page)
+{
+	SM_FileMgmt *mgmt;
+	SM_Segment *seg;
+	off_t offset;
 	if (checkinit() == RC_OK)
 		{
-			if (exists(fHandle->fileName))
+			mgmt = fileMgmt(fHandle);
+			if (mgmt == NULL)
+				return RC_FILE_HANDLE_NOT_INIT;
+			if (mgmt->mode != SM_IO_MAPPED)
+				return RC_FILE_HANDLE_NOT_INIT;
+			if((pageNum<fHandle->totalNumPages) && (pageNum>=0))
 			{
-				writeBlock (fHandle->totalNumPages, fHandle, emptyblock);
+				seg = pageSegment(mgmt, pageNum, &offset);
+				*page = seg->map + offset;
+				__atomic_store_n(&fHandle->curPagePos, pageNum, __ATOMIC_RELAXED);
 				return RC_OK;
 			}
 			else
 			{
-				return RC_FILE_NOT_FOUND;
+				return RC_READ_NON_EXISTING_PAGE;
 			}
 		}
 		else
@@ -383,31 +1340,271 @@ RC appendEmptyBlock (SM_FileHandle *fHandle)
 }
 
 /*
- * Function ensureCapacity()
- * Checks if the number of the pages in the file is equal to the specified Page Number
- * Appends new blocks to the file if it is less than specified capacity.
+ * Function getPageLocation()
+ * Descriptor and byte offset of an allocated page, for engines that issue their own positional I/O
+ * (storage_mgr_async.c). Mapped files and backends without descriptors have to go through readBlock/writeBlock
+ * and get RC_FILE_HANDLE_NOT_INIT.
 */
-RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle)
+RC getPageLocation (SM_FileHandle *fHandle, int pageNum, int *fd, off_t *offset)
 {
-	int i;
-		char emptyblock[PAGE_SIZE];
-		for(i=0;i<PAGE_SIZE;i++)
-			emptyblock[i]=0;
+	SM_FileMgmt *mgmt = fileMgmt(fHandle);
+	if (mgmt == NULL || mgmt->mode == SM_IO_MAPPED || mgmt->backend->fd == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+	if (pageNum < 0 || pageNum >= mgmt->allocatedPages)
+		return RC_READ_NON_EXISTING_PAGE;
+	*fd = pageSegment(mgmt, pageNum, offset)->fd;
+	return RC_OK;
+}
+
+/*
+ * Function getPageFileMode()
+ * The I/O mode the handle was opened with.
+*/
+SM_IOMode getPageFileMode (SM_FileHandle *fHandle)
+{
+	SM_FileMgmt *mgmt = fileMgmt(fHandle);
+	return (mgmt == NULL) ? SM_IO_BUFFERED : mgmt->mode;
+}
+
+/*
+ * Function setExtentPolicy()
+ * How the file grows from now on: extentPages pages at a time, preallocated with fallocate or left sparse.
+ * An extent of one page gives back page at a time growth.
+*/
+RC setExtentPolicy (SM_FileHandle *fHandle, int extentPages, SM_ExtentMode extentMode)
+{
+	SM_FileMgmt *mgmt = fileMgmt(fHandle);
+	if (mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+	mgmt->extentPages = (extentPages > 0) ? extentPages : 1;
+	mgmt->extentMode = extentMode;
+	return RC_OK;
+}
+
+/*
+ * Function allocatePage()
+ * Hands out a page for new data: the lowest page given back with freePage, or a new page at the end
+ * of the file when none is free. A reused page keeps its old content, the caller initialises it.
+*/
+RC allocatePage (SM_FileHandle *fHandle, int *pageNum)
+{
+	SM_FileMgmt *mgmt = fileMgmt(fHandle);
+	SM_Segment *seg;
+	int p, bit;
+	RC rc;
 
-		if (checkinit() == RC_OK)
+	if (mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+	if (pageNum == NULL)
+		return RC_NULL_ARGUMENT;
+
+	if (mgmt->freePages > 0)
+	{
+		// free bits only exist below totalNumPages, whole zero bytes of the map are skipped
+		for (p = mgmt->freeHint; p < fHandle->totalNumPages; p++)
+		{
+			seg = &mgmt->segs[p / mgmt->segPages];
+			bit = p % mgmt->segPages;
+			if (bit % 8 == 0 && seg->freeMap[bit / 8] == 0)
 			{
-				if (exists(fHandle->fileName))
-				{
-					writeBlock (numberOfPages-1, fHandle, emptyblock);
-					return RC_OK;
-				}
-				else
-				{
-					return RC_FILE_NOT_FOUND;
-				}
+				p += ((mgmt->segPages - bit < 8) ? mgmt->segPages - bit : 8) - 1;
+				continue;
 			}
-			else
+			if (seg->freeMap[bit / 8] & (1 << (bit % 8)))
 			{
-				return RC_STORAGE_MGR_NOT_INIT;
+				seg->freeMap[bit / 8] &= ~(1 << (bit % 8));
+				seg->mapDirty = 1;
+				mgmt->freePages--;
+				mgmt->freeHint = p + 1;
+				*pageNum = p;
+				return RC_OK;
 			}
+		}
+	}
+
+	p = fHandle->totalNumPages;
+	rc = ensureCapacity(p + 1, fHandle);
+	if (rc != RC_OK)
+		return rc;
+	*pageNum = p;
+	return RC_OK;
+}
+
+/*
+ * Function freePage()
+ * Marks a page of the file free so allocatePage can reuse it. The map is persistent,
+ * freed pages stay free across closePageFile and openPageFile.
+*/
+RC freePage (SM_FileHandle *fHandle, int pageNum)
+{
+	SM_FileMgmt *mgmt = fileMgmt(fHandle);
+	SM_Segment *seg;
+	int bit;
+
+	if (mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+	if (pageNum < 0 || pageNum >= fHandle->totalNumPages)
+		return RC_INVALID_PAGE_NUMBER;
+
+	seg = &mgmt->segs[pageNum / mgmt->segPages];
+	bit = pageNum % mgmt->segPages;
+	if (seg->freeMap[bit / 8] & (1 << (bit % 8)))
+		return RC_PAGE_ALREADY_FREE;
+	seg->freeMap[bit / 8] |= 1 << (bit % 8);
+	seg->mapDirty = 1;
+	mgmt->freePages++;
+	if (pageNum < mgmt->freeHint)
+		mgmt->freeHint = pageNum;
+	return RC_OK;
+}
+
+/*
+ * Function getNumFreePages()
+ * Pages of the file currently marked free.
+*/
+int getNumFreePages (SM_FileHandle *fHandle)
+{
+	SM_FileMgmt *mgmt = fileMgmt(fHandle);
+	return (mgmt == NULL) ? 0 : mgmt->freePages;
+}
+
+/*
+ * Function trimPageFile()
+ * Returns the space of free pages to the file system without moving any page: free pages at the end
+ * of the file are dropped and the file is truncated behind the last page in use, runs of free pages
+ * inside the file become holes (the backend's discard, FALLOC_FL_PUNCH_HOLE for plain files). Punched pages stay free and read back as zeros,
+ * on file systems that cannot punch holes they just keep their blocks.
+*/
+RC trimPageFile (SM_FileHandle *fHandle)
+{
+	SM_FileMgmt *mgmt = fileMgmt(fHandle);
+	SM_Segment *seg;
+	int total, bit, i, run;
+	RC rc;
+
+	if (mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	// the file keeps at least the one page createPageFile gave it
+	total = fHandle->totalNumPages;
+	while (total > 1)
+	{
+		seg = &mgmt->segs[(total - 1) / mgmt->segPages];
+		bit = (total - 1) % mgmt->segPages;
+		if (!(seg->freeMap[bit / 8] & (1 << (bit % 8))))
+			break;
+		seg->freeMap[bit / 8] &= ~(1 << (bit % 8));
+		seg->mapDirty = 1;
+		mgmt->freePages--;
+		total--;
+	}
+	rc = setPageCount(fHandle, total);
+	if (rc != RC_OK)
+		return rc;
+	if (fHandle->curPagePos >= total)
+		fHandle->curPagePos = total - 1;
+
+	rc = shrinkSegments(mgmt, total);
+	if (rc != RC_OK)
+		return rc;
+
+	for (i = 0; i < mgmt->numSegs && mgmt->freePages > 0; i++)
+	{
+		seg = &mgmt->segs[i];
+		for (bit = 0; bit < seg->allocatedPages; bit += run)
+		{
+			run = 0;
+			while (bit + run < seg->allocatedPages && (seg->freeMap[(bit + run) / 8] & (1 << ((bit + run) % 8))))
+				run++;
+			if (run > 0 && mgmt->backend->discard != NULL)
+				mgmt->backend->discard(seg->file, seg->base + (off_t) bit * mgmt->pageSize, (off_t) run * mgmt->pageSize);
+			else if (run == 0)
+				run = 1;
+		}
+	}
+	return RC_OK;
+}
+
+/*
+ * Function syncPageFile()
+ * Writes back changed free page maps and asks the backend to make every segment durable.
+*/
+RC syncPageFile (SM_FileHandle *fHandle)
+{
+	SM_FileMgmt *mgmt = fileMgmt(fHandle);
+	SM_Segment *seg;
+	int i;
+	RC rc;
+
+	if (mgmt == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+	for (i = 0; i < mgmt->numSegs; i++)
+	{
+		seg = &mgmt->segs[i];
+		if (seg->mapDirty)
+		{
+			rc = writeBytes(mgmt->backend, seg->file, (char *) seg->freeMap, mgmt->mapBytes, seg->base - mgmt->mapBytes);
+			if (rc != RC_OK)
+				return rc;
+			seg->mapDirty = 0;
+		}
+		rc = mgmt->backend->sync(seg->file);
+		if (rc != RC_OK)
+			return rc;
+	}
+	return RC_OK;
+}
+
+/*
+ * Function pageFileExists()
+ * Whether the backend of fileName has a file of that name.
+*/
+int pageFileExists (char *fileName)
+{
+	const SM_Backend *backend = getStorageBackend(fileName);
+	SM_IOMode mode = SM_IO_BUFFERED;
+	void *file;
+	off_t size;
+
+	if (backend->open(fileName, 0, &mode, &file, &size) != RC_OK)
+		return 0;
+	backend->close(file);
+	return 1;
+}
+
+/*
+ * Function registerStorageBackend()
+ * Makes page files whose names start with the backend's prefix use it. A backend registered
+ * with the prefix of an earlier one replaces it.
+*/
+RC registerStorageBackend (const SM_Backend *backend)
+{
+	int i;
+
+	if (backend == NULL || backend->prefix == NULL || backend->prefix[0] == '\0')
+		return RC_NULL_ARGUMENT;
+	for (i = 0; i < numBackends; i++)
+		if (strcmp(backends[i]->prefix, backend->prefix) == 0)
+		{
+			backends[i] = backend;
+			return RC_OK;
+		}
+	if (numBackends == SM_MAX_BACKENDS)
+		return RC_TOO_MANY_BACKENDS;
+	backends[numBackends++] = backend;
+	return RC_OK;
+}
+
+/*
+ * Function getStorageBackend()
+ * The backend a page file name belongs to, the plain file backend unless a registered prefix matches.
+*/
+const SM_Backend *getStorageBackend (const char *fileName)
+{
+	int i;
+
+	for (i = 0; i < numBackends; i++)
+		if (strncmp(fileName, backends[i]->prefix, strlen(backends[i]->prefix)) == 0)
+			return backends[i];
+	return plainBackend;
 }
@@ -1,6 +1,7 @@
 #ifndef STORAGE_MGR_H
 #define STORAGE_MGR_H
 
+#include <sys/types.h>
 #include "dberror.h"
 
 /************************************************************
@@ -10,20 +11,63 @@ typedef struct SM_FileHandle {
   char *fileName;
   int totalNumPages;
   int curPagePos;
+  int pageSize;		// bytes per page, read from the file header by openPageFile
   void *mgmtInfo;
 } SM_FileHandle;
 
 typedef char* SM_PageHandle;
 
+/* how an open page file moves data, chosen when the file is opened */
+typedef enum SM_IOMode {
+  SM_IO_BUFFERED = 0,	// pread/pwrite through the kernel page cache
+  SM_IO_MAPPED = 1,	// mmap of the whole file, see openPageFileMapped
+  SM_IO_DIRECT = 2	// O_DIRECT, bypasses the kernel page cache
+} SM_IOMode;
+
+/* page sizes a page file can be created with (powers of two), PAGE_SIZE is the default.
+ * The size is recorded in a header in front of page 0 and every open handle uses it. */
+#define SM_MIN_PAGE_SIZE PAGE_SIZE
+#define SM_MAX_PAGE_SIZE 65536
+
+/* buffer alignment O_DIRECT transfers need, unaligned buffers cost an extra copy */
+#define SM_DIRECT_ALIGN 4096
+
+/* how ensureCapacity and writes past the end grow the file, see setExtentPolicy */
+typedef enum SM_ExtentMode {
+  SM_EXTENT_FALLOCATE = 0,	// blocks are reserved up front with fallocate
+  SM_EXTENT_SPARSE = 1		// only the length changes (ftruncate), blocks come on first write
+} SM_ExtentMode;
+
+/* the file grows this many pages at a time unless setExtentPolicy says otherwise.
+ * totalNumPages counts pages in use, closePageFile trims the unused rest of the last extent. */
+#define SM_DEFAULT_EXTENT_PAGES 64
+
+/* bytes of pages per segment file: with n = SM_SEGMENT_SIZE / pageSize pages per segment, page p is
+ * stored in segment p / n, segment 0 is the page file itself and segment i is "<fileName>.i".
+ * Page numbers are int, so a file holds up to 2^31 pages (8 TB of 4 KB pages), all byte offsets are 64 bit. */
+#ifndef SM_SEGMENT_SIZE
+#define SM_SEGMENT_SIZE (1 << 30)
+#endif
+
+/* most pages moved by a single preadv/pwritev, longer runs are split */
+#define SM_MAX_IOV 64
+
 /************************************************************
  *                    interface                             *
  ************************************************************/
+/* page files are plain files unless the name selects another backend, "mem:<name>" keeps
+ * the file in memory for the life of the process (see storage_mgr_backend.h) */
 /* manipulating page files */
 extern void initStorageManager (void);
 extern RC createPageFile (char *fileName);
+extern RC createPageFileSize (char *fileName, int pageSize);
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle);
+extern RC openPageFileMapped (char *fileName, SM_FileHandle *fHandle);
+extern RC openPageFileMode (char *fileName, SM_FileHandle *fHandle, SM_IOMode mode);
 extern RC closePageFile (SM_FileHandle *fHandle);
 extern RC destroyPageFile (char *fileName);
+extern int pageFileExists (char *fileName);
+extern RC syncPageFile (SM_FileHandle *fHandle);
 
 /* reading blocks from disc */
 extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
@@ -33,11 +77,30 @@ extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+/* several pages per call, the v forms scatter/gather to frames anywhere in memory */
+extern RC readBlocks (int startPage, int count, SM_FileHandle *fHandle, SM_PageHandle memPages);
+extern RC readBlocksv (int startPage, int count, SM_FileHandle *fHandle, SM_PageHandle *pages);
+/* mapped files only: pointer to the page inside the mapping, valid until the file grows */
+extern RC getBlockPointer (int pageNum, SM_FileHandle *fHandle, SM_PageHandle *page);
 
 /* writing blocks to a page file */
 extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlocks (int startPage, int count, SM_FileHandle *fHandle, SM_PageHandle memPages);
+extern RC writeBlocksv (int startPage, int count, SM_FileHandle *fHandle, SM_PageHandle *pages);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
 extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
+extern RC setExtentPolicy (SM_FileHandle *fHandle, int extentPages, SM_ExtentMode extentMode);
+
+/* page reuse, backed by a free page map stored in the file */
+extern RC allocatePage (SM_FileHandle *fHandle, int *pageNum);
+extern RC freePage (SM_FileHandle *fHandle, int pageNum);
+extern int getNumFreePages (SM_FileHandle *fHandle);
+/* gives the blocks of free pages back to the file system: trailing ones are truncated, the rest punched */
+extern RC trimPageFile (SM_FileHandle *fHandle);
+
+/* for I/O engines layered on an open handle */
+extern RC getPageLocation (SM_FileHandle *fHandle, int pageNum, int *fd, off_t *offset);
+extern SM_IOMode getPageFileMode (SM_FileHandle *fHandle);
 
 #endif
\ No newline at end of file
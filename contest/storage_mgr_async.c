@@ -0,0 +1,642 @@
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "storage_mgr_async.h"
+#include "dberror.h"
+
+/*
+ * Structure SM_Ring
+ * The shared memory of one io_uring instance, set up with the raw syscalls (no liburing).
+*/
+typedef struct SM_Ring {
+	int fd;
+	unsigned *sqHead;
+	unsigned *sqTail;
+	unsigned *sqMask;
+	unsigned *sqArray;
+	struct io_uring_sqe *sqes;
+	unsigned *cqHead;
+	unsigned *cqTail;
+	unsigned *cqMask;
+	struct io_uring_cqe *cqes;
+	void *sqPtr;
+	size_t sqLen;
+	void *cqPtr;
+	size_t cqLen;
+	size_t sqesLen;
+} SM_Ring;
+
+struct SM_AsyncIO {
+	SM_AsyncEngine engine;
+	SM_FileHandle *fh;
+	int mapped;			// mapped file: requests are served synchronously by readBlock/writeBlock
+	int direct;			// O_DIRECT handle, unaligned buffers are served synchronously as well
+	int queueDepth;
+	int inFlight;		// handed to the kernel or the workers and not reaped yet
+	SM_IORequest *waitHead;	// submitted, waiting for a free slot
+	SM_IORequest *waitTail;
+	SM_IORequest *readyHead;	// completed without going through the engine
+	SM_IORequest *readyTail;
+
+	SM_Ring ring;
+
+	pthread_t workers[SM_ASYNC_WORKERS];
+	int numWorkers;
+	pthread_mutex_t lock;
+	pthread_cond_t workCond;
+	pthread_cond_t doneCond;
+	SM_IORequest *workHead;
+	SM_IORequest *workTail;
+	SM_IORequest *doneHead;
+	SM_IORequest *doneTail;
+	int stopping;
+};
+
+/*
+ * Function pushRequest()
+ * Appends a request to a singly linked FIFO.
+*/
+static void pushRequest (SM_IORequest **head, SM_IORequest **tail, SM_IORequest *req)
+{
+	req->next = NULL;
+	if (*tail == NULL)
+		*head = req;
+	else
+		(*tail)->next = req;
+	*tail = req;
+}
+
+/*
+ * Function popRequest()
+ * Removes the oldest request of a FIFO, NULL if it is empty.
+*/
+static SM_IORequest *popRequest (SM_IORequest **head, SM_IORequest **tail)
+{
+	SM_IORequest *req = *head;
+	if (req != NULL)
+	{
+		*head = req->next;
+		if (*head == NULL)
+			*tail = NULL;
+		req->next = NULL;
+	}
+	return req;
+}
+
+/*
+ * Function completeRequest()
+ * Book keeping on the caller's thread once a request is done. Writes past the end already grew the file
+ * at submission, this only keeps the page count right if the caller shrank the file in between.
+*/
+static void completeRequest (SM_AsyncIO *aio, SM_IORequest *req)
+{
+	if (req->isWrite && req->result == RC_OK && req->pageNum >= aio->fh->totalNumPages)
+		req->result = ensureCapacity(req->pageNum + 1, aio->fh);
+}
+
+/*
+ * Function transferPage()
+ * Synchronous positional I/O of what is left of a request, retrying short transfers. The workers run
+ * every request through it, the io_uring engine the ones it could not submit.
+*/
+static RC transferPage (SM_IORequest *req)
+{
+	off_t offset = req->offset;
+	ssize_t done = 0;
+	ssize_t n;
+
+	while ((size_t) done < req->iov.iov_len)
+	{
+		if (req->isWrite)
+			n = pwrite(req->fd, (char *) req->iov.iov_base + done, req->iov.iov_len - done, offset + done);
+		else
+			n = pread(req->fd, (char *) req->iov.iov_base + done, req->iov.iov_len - done, offset + done);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return req->isWrite ? RC_WRITE_FAILED : RC_READ_FAILED;
+		done += n;
+	}
+	return RC_OK;
+}
+
+/************************************************************
+ *                   io_uring engine                         *
+ ************************************************************/
+
+/*
+ * Function ringSetup()
+ * Creates the ring and maps its submission queue, completion queue and SQE array.
+*/
+static int ringSetup (SM_Ring *ring, int entries)
+{
+	struct io_uring_params p;
+
+	memset(&p, 0, sizeof(p));
+	ring->fd = (int) syscall(__NR_io_uring_setup, entries, &p);
+	if (ring->fd < 0)
+		return -1;
+
+	ring->sqLen = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	ring->cqLen = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if (ring->cqLen > ring->sqLen)
+			ring->sqLen = ring->cqLen;
+		ring->cqLen = ring->sqLen;
+	}
+
+	ring->sqPtr = mmap(NULL, ring->sqLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ring->sqPtr == MAP_FAILED)
+	{
+		close(ring->fd);
+		return -1;
+	}
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		ring->cqPtr = ring->sqPtr;
+	else
+	{
+		ring->cqPtr = mmap(NULL, ring->cqLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+		if (ring->cqPtr == MAP_FAILED)
+		{
+			munmap(ring->sqPtr, ring->sqLen);
+			close(ring->fd);
+			return -1;
+		}
+	}
+	ring->sqesLen = p.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqesLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED)
+	{
+		if (ring->cqPtr != ring->sqPtr)
+			munmap(ring->cqPtr, ring->cqLen);
+		munmap(ring->sqPtr, ring->sqLen);
+		close(ring->fd);
+		return -1;
+	}
+
+	ring->sqHead = (unsigned *) ((char *) ring->sqPtr + p.sq_off.head);
+	ring->sqTail = (unsigned *) ((char *) ring->sqPtr + p.sq_off.tail);
+	ring->sqMask = (unsigned *) ((char *) ring->sqPtr + p.sq_off.ring_mask);
+	ring->sqArray = (unsigned *) ((char *) ring->sqPtr + p.sq_off.array);
+	ring->cqHead = (unsigned *) ((char *) ring->cqPtr + p.cq_off.head);
+	ring->cqTail = (unsigned *) ((char *) ring->cqPtr + p.cq_off.tail);
+	ring->cqMask = (unsigned *) ((char *) ring->cqPtr + p.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *) ((char *) ring->cqPtr + p.cq_off.cqes);
+	return 0;
+}
+
+/*
+ * Function ringTeardown()
+ * Unmaps the ring and closes its descriptor.
+*/
+static void ringTeardown (SM_Ring *ring)
+{
+	munmap(ring->sqes, ring->sqesLen);
+	if (ring->cqPtr != ring->sqPtr)
+		munmap(ring->cqPtr, ring->cqLen);
+	munmap(ring->sqPtr, ring->sqLen);
+	close(ring->fd);
+}
+
+/*
+ * Function ringDispatch()
+ * Moves waiting requests into free submission slots and submits them with one io_uring_enter.
+*/
+static void ringDispatch (SM_AsyncIO *aio)
+{
+	SM_Ring *ring = &aio->ring;
+	unsigned tail = *ring->sqTail;
+	unsigned head;
+	unsigned index;
+	int queued = 0;
+	int n;
+	struct io_uring_sqe *sqe;
+	SM_IORequest *req;
+
+	while (aio->inFlight < aio->queueDepth && aio->waitHead != NULL)
+	{
+		req = popRequest(&aio->waitHead, &aio->waitTail);
+
+		index = tail & *ring->sqMask;
+		sqe = &ring->sqes[index];
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = req->isWrite ? IORING_OP_WRITEV : IORING_OP_READV;
+		sqe->fd = req->fd;
+		sqe->addr = (uint64_t) (uintptr_t) &req->iov;
+		sqe->len = 1;
+		sqe->off = (uint64_t) req->offset;
+		sqe->user_data = (uint64_t) (uintptr_t) req;
+		ring->sqArray[index] = index;
+		tail++;
+		queued++;
+		aio->inFlight++;
+	}
+	if (queued == 0)
+		return;
+
+	__atomic_store_n(ring->sqTail, tail, __ATOMIC_RELEASE);
+	while (queued > 0)
+	{
+		n = (int) syscall(__NR_io_uring_enter, ring->fd, queued, 0, 0, NULL, 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		queued -= n;
+	}
+	if (queued == 0)
+		return;
+
+	// the kernel refused the rest, take them back out of the ring and do them synchronously
+	head = __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+	__atomic_store_n(ring->sqTail, head, __ATOMIC_RELEASE);
+	for (; head != tail; head++)
+	{
+		req = (SM_IORequest *) (uintptr_t) ring->sqes[head & *ring->sqMask].user_data;
+		req->result = transferPage(req);
+		aio->inFlight--;
+		pushRequest(&aio->readyHead, &aio->readyTail, req);
+	}
+}
+
+/*
+ * Function ringReap()
+ * Collects completions from the CQ ring, entering the kernel to wait for one if block is set and none is ready.
+*/
+static int ringReap (SM_AsyncIO *aio, SM_IORequest **done, int max, int block)
+{
+	SM_Ring *ring = &aio->ring;
+	unsigned head, tail;
+	struct io_uring_cqe *cqe;
+	SM_IORequest *req;
+	int got, resubmit;
+
+	while (1)
+	{
+		got = 0;
+		resubmit = 0;
+		head = *ring->cqHead;
+		tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+		while (head != tail && got < max)
+		{
+			cqe = &ring->cqes[head & *ring->cqMask];
+			req = (SM_IORequest *) (uintptr_t) cqe->user_data;
+			aio->inFlight--;
+			head++;
+			if (cqe->res > 0 && cqe->res < (int) req->iov.iov_len)
+			{
+				// short transfer, submit the rest of the page again
+				req->iov.iov_base = (char *) req->iov.iov_base + cqe->res;
+				req->iov.iov_len -= cqe->res;
+				req->offset += cqe->res;
+				pushRequest(&aio->waitHead, &aio->waitTail, req);
+				resubmit++;
+				continue;
+			}
+			if (cqe->res == (int) req->iov.iov_len)
+				req->result = RC_OK;
+			else
+				req->result = req->isWrite ? RC_WRITE_FAILED : RC_READ_FAILED;
+			done[got++] = req;
+		}
+		__atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+
+		// the caller waits again for the resubmitted requests, or finds them on the ready list
+		if (resubmit > 0)
+		{
+			ringDispatch(aio);
+			return got;
+		}
+		if (got > 0 || !block)
+			return got;
+		if (syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+			return 0;
+	}
+}
+
+/************************************************************
+ *                   worker thread engine                    *
+ ************************************************************/
+
+/*
+ * Function workerMain()
+ * Takes requests off the work queue until the engine is stopped and the queue is empty.
+*/
+static void *workerMain (void *arg)
+{
+	SM_AsyncIO *aio = (SM_AsyncIO *) arg;
+	SM_IORequest *req;
+
+	pthread_mutex_lock(&aio->lock);
+	while (1)
+	{
+		while (aio->workHead == NULL && !aio->stopping)
+			pthread_cond_wait(&aio->workCond, &aio->lock);
+		req = popRequest(&aio->workHead, &aio->workTail);
+		if (req == NULL)
+			break;
+		pthread_mutex_unlock(&aio->lock);
+
+		req->result = transferPage(req);
+
+		pthread_mutex_lock(&aio->lock);
+		pushRequest(&aio->doneHead, &aio->doneTail, req);
+		pthread_cond_signal(&aio->doneCond);
+	}
+	pthread_mutex_unlock(&aio->lock);
+	return NULL;
+}
+
+/*
+ * Function threadsDispatch()
+ * Hands waiting requests to the workers as long as there are free slots.
+*/
+static void threadsDispatch (SM_AsyncIO *aio)
+{
+	int queued = 0;
+
+	if (aio->waitHead == NULL || aio->inFlight >= aio->queueDepth)
+		return;
+	pthread_mutex_lock(&aio->lock);
+	while (aio->inFlight < aio->queueDepth && aio->waitHead != NULL)
+	{
+		pushRequest(&aio->workHead, &aio->workTail, popRequest(&aio->waitHead, &aio->waitTail));
+		aio->inFlight++;
+		queued++;
+	}
+	if (queued > 1)
+		pthread_cond_broadcast(&aio->workCond);
+	else
+		pthread_cond_signal(&aio->workCond);
+	pthread_mutex_unlock(&aio->lock);
+}
+
+/*
+ * Function threadsReap()
+ * Collects finished requests from the workers, waiting for one if block is set and none is done.
+*/
+static int threadsReap (SM_AsyncIO *aio, SM_IORequest **done, int max, int block)
+{
+	int got = 0;
+
+	pthread_mutex_lock(&aio->lock);
+	while (block && aio->doneHead == NULL)
+		pthread_cond_wait(&aio->doneCond, &aio->lock);
+	while (got < max && aio->doneHead != NULL)
+	{
+		done[got++] = popRequest(&aio->doneHead, &aio->doneTail);
+		aio->inFlight--;
+	}
+	pthread_mutex_unlock(&aio->lock);
+	return got;
+}
+
+/*
+ * Function threadsStop()
+ * Lets the workers drain the queue and joins them.
+*/
+static void threadsStop (SM_AsyncIO *aio)
+{
+	int i;
+
+	pthread_mutex_lock(&aio->lock);
+	aio->stopping = 1;
+	pthread_cond_broadcast(&aio->workCond);
+	pthread_mutex_unlock(&aio->lock);
+	for (i = 0; i < aio->numWorkers; i++)
+		pthread_join(aio->workers[i], NULL);
+	pthread_mutex_destroy(&aio->lock);
+	pthread_cond_destroy(&aio->workCond);
+	pthread_cond_destroy(&aio->doneCond);
+}
+
+/************************************************************
+ *                   common                                  *
+ ************************************************************/
+
+/*
+ * Function dispatch()
+ * Starts as many waiting requests as the queue depth allows.
+*/
+static void dispatch (SM_AsyncIO *aio)
+{
+	if (aio->engine == SM_ASYNC_IO_URING)
+		ringDispatch(aio);
+	else
+		threadsDispatch(aio);
+}
+
+/*
+ * Function reap()
+ * Common body of pollCompletions and waitCompletions. Requests completed at submission come first,
+ * then the engine's completions. Blocks only while fewer than min were collected and work is outstanding.
+*/
+static int reap (SM_AsyncIO *aio, SM_IORequest **done, int max, int min)
+{
+	int n = 0;
+	int got, block, i;
+
+	while (n < max)
+	{
+		if (aio->readyHead != NULL)
+		{
+			done[n++] = popRequest(&aio->readyHead, &aio->readyTail);
+			continue;
+		}
+
+		block = (n < min && aio->inFlight > 0);
+		if (aio->engine == SM_ASYNC_IO_URING)
+			got = ringReap(aio, done + n, max - n, block);
+		else
+			got = threadsReap(aio, done + n, max - n, block);
+		for (i = n; i < n + got; i++)
+			completeRequest(aio, done[i]);
+		n += got;
+
+		// completions freed slots, start what was waiting for them
+		dispatch(aio);
+
+		if (got == 0 && aio->readyHead == NULL && (n >= min || aio->inFlight == 0))
+			break;
+	}
+	return n;
+}
+
+/************************************************************
+ *                   Interface                               *
+ ************************************************************/
+
+/*
+ * Function initAsyncIO()
+ * Starts an engine for an open page file: io_uring if the kernel allows it, SM_ASYNC_WORKERS threads otherwise.
+*/
+RC initAsyncIO (SM_AsyncIO **aioOut, SM_FileHandle *fHandle, int queueDepth)
+{
+	SM_AsyncIO *aio;
+	const char *forced = getenv("SM_ASYNC_ENGINE");
+	int i;
+
+	if (aioOut == NULL || fHandle == NULL || fHandle->mgmtInfo == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+	if (queueDepth <= 0)
+		queueDepth = 1;
+
+	aio = (SM_AsyncIO *) calloc(1, sizeof(SM_AsyncIO));
+	if (aio == NULL)
+		return RC_ASYNC_IO_INIT_FAILED;
+	aio->fh = fHandle;
+	aio->mapped = (getPageFileMode(fHandle) == SM_IO_MAPPED);
+	aio->direct = (getPageFileMode(fHandle) == SM_IO_DIRECT);
+	aio->queueDepth = queueDepth;
+
+	aio->engine = SM_ASYNC_THREADS;
+	if ((forced == NULL || strcmp(forced, "threads") != 0) && ringSetup(&aio->ring, queueDepth) == 0)
+		aio->engine = SM_ASYNC_IO_URING;
+
+	if (aio->engine == SM_ASYNC_THREADS)
+	{
+		pthread_mutex_init(&aio->lock, NULL);
+		pthread_cond_init(&aio->workCond, NULL);
+		pthread_cond_init(&aio->doneCond, NULL);
+		for (i = 0; i < SM_ASYNC_WORKERS; i++)
+		{
+			if (pthread_create(&aio->workers[i], NULL, workerMain, aio) != 0)
+				break;
+			aio->numWorkers++;
+		}
+		if (aio->numWorkers == 0)
+		{
+			threadsStop(aio);
+			free(aio);
+			return RC_ASYNC_IO_INIT_FAILED;
+		}
+	}
+
+	*aioOut = aio;
+	return RC_OK;
+}
+
+/*
+ * Function shutdownAsyncIO()
+ * Waits for every outstanding request, then stops the engine. Completions not collected by then are dropped.
+*/
+RC shutdownAsyncIO (SM_AsyncIO *aio)
+{
+	SM_IORequest *done[SM_MAX_IOV];
+	RC rc = RC_OK;
+	int n, i;
+
+	if (aio == NULL)
+		return RC_OK;
+	while (getAsyncInFlight(aio) > 0)
+	{
+		n = reap(aio, done, SM_MAX_IOV, 1);
+		for (i = 0; i < n; i++)
+			if (done[i]->result != RC_OK)
+				rc = done[i]->result;
+	}
+
+	if (aio->engine == SM_ASYNC_IO_URING)
+		ringTeardown(&aio->ring);
+	else
+		threadsStop(aio);
+	free(aio);
+	return rc;
+}
+
+/*
+ * Function getAsyncEngine()
+ * Which engine initAsyncIO picked.
+*/
+SM_AsyncEngine getAsyncEngine (SM_AsyncIO *aio)
+{
+	return aio->engine;
+}
+
+/*
+ * Function getAsyncInFlight()
+ * Requests submitted and not yet returned by pollCompletions/waitCompletions.
+*/
+int getAsyncInFlight (SM_AsyncIO *aio)
+{
+	int n = aio->inFlight;
+	SM_IORequest *req;
+
+	for (req = aio->waitHead; req != NULL; req = req->next)
+		n++;
+	for (req = aio->readyHead; req != NULL; req = req->next)
+		n++;
+	return n;
+}
+
+/*
+ * Function submitBlocks()
+ * Queues count page requests. Invalid ones, and the ones the engine cannot do (mapped files,
+ * unaligned buffers on O_DIRECT handles), complete right away with readBlock/writeBlock.
+*/
+RC submitBlocks (SM_AsyncIO *aio, SM_IORequest **reqs, int count)
+{
+	SM_IORequest *req;
+	int i;
+
+	if (aio == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	for (i = 0; i < count; i++)
+	{
+		req = reqs[i];
+		req->next = NULL;
+		req->result = RC_OK;
+		if (req->pageNum < 0)
+			req->result = RC_INVALID_PAGE_NUMBER;
+		else if (!req->isWrite && req->pageNum >= aio->fh->totalNumPages)
+			req->result = RC_READ_NON_EXISTING_PAGE;
+		else if (req->isWrite && req->pageNum >= aio->fh->totalNumPages)
+			// grow the file now so the write lands inside its allocated extents
+			req->result = ensureCapacity(req->pageNum + 1, aio->fh);
+
+		if (req->result == RC_OK && !aio->mapped
+		    && !(aio->direct && ((uintptr_t) req->memPage % SM_DIRECT_ALIGN) != 0)
+		    && getPageLocation(aio->fh, req->pageNum, &req->fd, &req->offset) == RC_OK)
+		{
+			req->iov.iov_base = req->memPage;
+			req->iov.iov_len = aio->fh->pageSize;
+			pushRequest(&aio->waitHead, &aio->waitTail, req);
+			continue;
+		}
+		if (req->result == RC_OK)
+			req->result = req->isWrite ? writeBlock(req->pageNum, aio->fh, req->memPage)
+						   : readBlock(req->pageNum, aio->fh, req->memPage);
+		pushRequest(&aio->readyHead, &aio->readyTail, req);
+	}
+
+	dispatch(aio);
+	return RC_OK;
+}
+
+/*
+ * Function pollCompletions()
+ * Returns up to max completed requests without blocking.
+*/
+int pollCompletions (SM_AsyncIO *aio, SM_IORequest **done, int max)
+{
+	return reap(aio, done, max, 0);
+}
+
+/*
+ * Function waitCompletions()
+ * Returns between min and max completed requests, fewer only if nothing else is outstanding.
+*/
+int waitCompletions (SM_AsyncIO *aio, SM_IORequest **done, int min, int max)
+{
+	if (min > max)
+		min = max;
+	return reap(aio, done, max, min);
+}
@@ -0,0 +1,52 @@
+#ifndef STORAGE_MGR_ASYNC_H
+#define STORAGE_MGR_ASYNC_H
+
+#include <sys/uio.h>
+#include "dberror.h"
+#include "storage_mgr.h"
+
+/************************************************************
+ *  asynchronous page I/O on an open page file              *
+ *  (io_uring, worker threads when io_uring is unavailable) *
+ ************************************************************/
+typedef enum SM_AsyncEngine {
+  SM_ASYNC_IO_URING = 0,
+  SM_ASYNC_THREADS = 1
+} SM_AsyncEngine;
+
+// worker threads started by the fallback engine
+#define SM_ASYNC_WORKERS 4
+
+// one page read or write. The caller owns the request and the page buffer,
+// both must stay untouched from submitBlocks until the request comes back
+// from pollCompletions/waitCompletions.
+typedef struct SM_IORequest {
+  int pageNum;
+  SM_PageHandle memPage;
+  int isWrite;
+  RC result;			// set when the request completes
+  void *userData;		// not used by the engine
+  // engine private
+  int fd;			// segment file and offset of the page
+  off_t offset;
+  struct iovec iov;		// the part of the page buffer still to transfer
+  struct SM_IORequest *next;
+} SM_IORequest;
+
+typedef struct SM_AsyncIO SM_AsyncIO;
+
+// queueDepth bounds the requests handed to the kernel or the workers at
+// once, more can be submitted and wait in a queue for a free slot.
+// Setting the environment variable SM_ASYNC_ENGINE=threads skips io_uring.
+extern RC initAsyncIO (SM_AsyncIO **aio, SM_FileHandle *fHandle, int queueDepth);
+extern RC shutdownAsyncIO (SM_AsyncIO *aio);
+extern SM_AsyncEngine getAsyncEngine (SM_AsyncIO *aio);
+extern int getAsyncInFlight (SM_AsyncIO *aio);
+
+extern RC submitBlocks (SM_AsyncIO *aio, SM_IORequest **reqs, int count);
+// both return the number of completed requests stored in done, poll never blocks,
+// wait blocks until at least min requests completed or nothing is in flight
+extern int pollCompletions (SM_AsyncIO *aio, SM_IORequest **done, int max);
+extern int waitCompletions (SM_AsyncIO *aio, SM_IORequest **done, int min, int max);
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef STORAGE_MGR_BACKEND_H
+#define STORAGE_MGR_BACKEND_H
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "dberror.h"
+#include "storage_mgr.h"
+
+/************************************************************
+ *  storage backends under the page files                   *
+ ************************************************************/
+// A backend stores the byte addressed files a page file is laid out on (segment 0
+// with the header and every further segment). The storage manager keeps the layout,
+// the free page maps and the extents, the backend only moves bytes. An open page file
+// dispatches through the backend chosen by its name, see registerStorageBackend.
+
+// open flags
+#define SM_OPEN_CREATE 1	// create the file if it does not exist
+#define SM_OPEN_EXCL 2		// with SM_OPEN_CREATE: fail with RC_FILE_PRESENT if it exists
+
+typedef struct SM_Backend {
+  // names starting with prefix belong to this backend, the backend gets the whole name
+  const char *prefix;
+
+  // opens name and returns the backend's state for it in *file and its length in *size.
+  // *mode is the I/O mode asked for, a backend that cannot honour it changes it to
+  // SM_IO_BUFFERED (SM_IO_MAPPED also needs the fd operation).
+  RC (*open) (const char *name, int flags, SM_IOMode *mode, void **file, off_t *size);
+  // transfer the whole iovec at offset, reads past the end fail with RC_READ_FAILED,
+  // writes past the end make the file longer
+  RC (*read) (void *file, struct iovec *iov, int iovcnt, off_t offset);
+  RC (*write) (void *file, struct iovec *iov, int iovcnt, off_t offset);
+  // makes the file at least offset + length bytes long, new bytes read back as zeros.
+  // SM_EXTENT_FALLOCATE asks for the space to be reserved up front.
+  RC (*extend) (void *file, off_t offset, off_t length, SM_ExtentMode extentMode);
+  RC (*truncate) (void *file, off_t size);
+  RC (*sync) (void *file);
+  void (*close) (void *file);
+  RC (*remove) (const char *name);
+
+  // optional, NULL if the backend has no such thing:
+  // gives the space of a byte range back, the range reads back as zeros
+  void (*discard) (void *file, off_t offset, off_t length);
+  // descriptor for mmap and the asynchronous engine
+  int (*fd) (void *file);
+} SM_Backend;
+
+// plain files, every name no registered prefix matches
+extern const SM_Backend SM_fileBackend;
+// files kept in memory for the life of the process, names start with "mem:"
+extern const SM_Backend SM_memBackend;
+// plain files on a simulated disk, names start with "sim:" (the rest is the real file name).
+// Every transfer sleeps for what it would cost on the disk model below. With the environment
+// variable SM_SIMULATED_DISK set to a profile name (hdd, ssd, cloud) initStorageManager puts
+// every plain page file on the simulated disk, so unchanged programs run at disk speed.
+extern const SM_Backend SM_simBackend;
+
+typedef enum SM_DiskProfile {
+  SM_DISK_NONE = 0,
+  SM_DISK_HDD = 1,
+  SM_DISK_SSD = 2,
+  SM_DISK_CLOUD = 3
+} SM_DiskProfile;
+
+// cost of one transfer of n bytes: readNs or writeNs + n * nsPerKB / 1024, plus
+// seekNs + min(seekNsPerMB * MB from where the last transfer ended, seekMaxNs)
+// unless it starts where the last one ended
+typedef struct SM_DiskModel {
+  long readNs;
+  long writeNs;
+  long nsPerKB;
+  long seekNs;
+  long seekNsPerMB;
+  long seekMaxNs;
+} SM_DiskModel;
+
+extern void setDiskModel (const SM_DiskModel *diskModel);
+extern RC setDiskProfile (SM_DiskProfile profile);
+extern RC setDiskProfileName (const char *name);
+extern long long getSimulatedDelayNs (void);
+extern void resetSimulatedDelay (void);
+
+// at most SM_MAX_BACKENDS backends besides the file backend, "mem:" and "sim:" are built in
+#define SM_MAX_BACKENDS 8
+
+extern RC registerStorageBackend (const SM_Backend *backend);
+extern const SM_Backend *getStorageBackend (const char *fileName);
+
+#endif
@@ -0,0 +1,315 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "dberror.h"
+#include "storage_mgr.h"
+#include "storage_mgr_backend.h"
+
+#define SM_MEM_PREFIX "mem:"
+
+/*
+ * Structure SM_MemFile
+ * One file of the in-memory backend. The files live in a list until they are removed,
+ * closing a file keeps its content so it can be opened again like a file on disk.
+ * Removing a file takes its name off the list, like unlink the content stays with the
+ * handles that have it open and is freed when the last one is closed.
+*/
+typedef struct SM_MemFile {
+	char *name;
+	char *data;
+	off_t size;			// file length, bytes past it up to capacity are not part of the file
+	size_t capacity;
+	pthread_rwlock_t lock;	// shared for transfers inside the file, exclusive to resize data
+	int openCount;		// opens not closed yet, guarded by memLock
+	int removed;		// off the list, freed at the last close
+	struct SM_MemFile *next;
+} SM_MemFile;
+
+// the list and the open counts, pool threads open and close files at the same time
+static pthread_mutex_t memLock = PTHREAD_MUTEX_INITIALIZER;
+static SM_MemFile *memFiles = NULL;
+
+/*
+ * Function findMemFile()
+ * The file called name and the link pointing at it, NULL if there is none.
+*/
+static SM_MemFile *findMemFile (const char *name, SM_MemFile ***link)
+{
+	SM_MemFile **l;
+	for (l = &memFiles; *l != NULL; l = &(*l)->next)
+		if (strcmp((*l)->name, name) == 0)
+		{
+			if (link != NULL)
+				*link = l;
+			return *l;
+		}
+	return NULL;
+}
+
+/*
+ * Function freeMemFile()
+ * Releases a file that is off the list and no longer open.
+*/
+static void freeMemFile (SM_MemFile *f)
+{
+	pthread_rwlock_destroy(&f->lock);
+	free(f->data);
+	free(f->name);
+	free(f);
+}
+
+/*
+ * Function growMemFile()
+ * Makes the file size bytes long. The buffer at least doubles when it has to grow,
+ * so a file written page by page is copied O(log n) times. The caller holds the lock exclusively.
+*/
+static RC growMemFile (SM_MemFile *f, off_t size)
+{
+	size_t capacity;
+	char *data;
+
+	if (size <= f->size)
+		return RC_OK;
+	if ((size_t) size > f->capacity)
+	{
+		capacity = (f->capacity > 0) ? f->capacity : PAGE_SIZE;
+		while (capacity < (size_t) size)
+			capacity *= 2;
+		data = (char *) realloc(f->data, capacity);
+		if (data == NULL)
+			return RC_WRITE_FAILED;
+		f->data = data;
+		f->capacity = capacity;
+	}
+	memset(f->data + f->size, 0, size - f->size);
+	f->size = size;
+	return RC_OK;
+}
+
+/*
+ * Function memOpen()
+ * Finds or creates the file. There is no kernel cache to bypass and nothing to map, every mode is buffered.
+*/
+static RC memOpen (const char *name, int flags, SM_IOMode *mode, void **file, off_t *size)
+{
+	SM_MemFile *f;
+
+	pthread_mutex_lock(&memLock);
+	f = findMemFile(name, NULL);
+	if (f != NULL && (flags & SM_OPEN_CREATE) && (flags & SM_OPEN_EXCL))
+	{
+		pthread_mutex_unlock(&memLock);
+		return RC_FILE_PRESENT;
+	}
+	if (f == NULL)
+	{
+		if (!(flags & SM_OPEN_CREATE))
+		{
+			pthread_mutex_unlock(&memLock);
+			return RC_FILE_NOT_FOUND;
+		}
+		f = (SM_MemFile *) calloc(1, sizeof(SM_MemFile));
+		if (f == NULL || (f->name = strdup(name)) == NULL)
+		{
+			pthread_mutex_unlock(&memLock);
+			free(f);
+			return RC_WRITE_FAILED;
+		}
+		pthread_rwlock_init(&f->lock, NULL);
+		f->next = memFiles;
+		memFiles = f;
+	}
+	f->openCount++;
+	pthread_mutex_unlock(&memLock);
+
+	*mode = SM_IO_BUFFERED;
+	*file = f;
+	pthread_rwlock_rdlock(&f->lock);
+	*size = f->size;
+	pthread_rwlock_unlock(&f->lock);
+	return RC_OK;
+}
+
+/*
+ * Function memRead()
+ * Copies the iovec out of the file.
+*/
+static RC memRead (void *file, struct iovec *iov, int iovcnt, off_t offset)
+{
+	SM_MemFile *f = (SM_MemFile *) file;
+	RC rc = RC_OK;
+	int i;
+
+	pthread_rwlock_rdlock(&f->lock);
+	for (i = 0; i < iovcnt && rc == RC_OK; i++)
+	{
+		if (offset + (off_t) iov[i].iov_len > f->size)
+			rc = RC_READ_FAILED;
+		else
+			memcpy(iov[i].iov_base, f->data + offset, iov[i].iov_len);
+		offset += iov[i].iov_len;
+	}
+	pthread_rwlock_unlock(&f->lock);
+	return rc;
+}
+
+/*
+ * Function memWrite()
+ * Copies the iovec into the file, growing it when the write ends past the end.
+ * Writes inside the file share the lock like reads, different pages are copied at the same time.
+*/
+static RC memWrite (void *file, struct iovec *iov, int iovcnt, off_t offset)
+{
+	SM_MemFile *f = (SM_MemFile *) file;
+	off_t end = offset;
+	int i;
+	RC rc = RC_OK;
+
+	for (i = 0; i < iovcnt; i++)
+		end += iov[i].iov_len;
+	pthread_rwlock_rdlock(&f->lock);
+	if (end > f->size)
+	{
+		pthread_rwlock_unlock(&f->lock);
+		pthread_rwlock_wrlock(&f->lock);
+		rc = growMemFile(f, end);
+	}
+	for (i = 0; i < iovcnt && rc == RC_OK; i++)
+	{
+		memcpy(f->data + offset, iov[i].iov_base, iov[i].iov_len);
+		offset += iov[i].iov_len;
+	}
+	pthread_rwlock_unlock(&f->lock);
+	return rc;
+}
+
+/*
+ * Function memExtend()
+ * Memory is always reserved up front, both extent modes grow the buffer.
+*/
+static RC memExtend (void *file, off_t offset, off_t length, SM_ExtentMode extentMode)
+{
+	SM_MemFile *f = (SM_MemFile *) file;
+	RC rc;
+
+	(void) extentMode;
+	pthread_rwlock_wrlock(&f->lock);
+	rc = growMemFile(f, offset + length);
+	pthread_rwlock_unlock(&f->lock);
+	return rc;
+}
+
+/*
+ * Function memTruncate()
+ * Cuts the file to size bytes, the buffer is given back once three quarters of it are unused.
+*/
+static RC memTruncate (void *file, off_t size)
+{
+	SM_MemFile *f = (SM_MemFile *) file;
+	char *data;
+	RC rc = RC_OK;
+
+	pthread_rwlock_wrlock(&f->lock);
+	if (size >= f->size)
+		rc = growMemFile(f, size);
+	else
+	{
+		f->size = size;
+		if ((size_t) size < f->capacity / 4)
+		{
+			data = (char *) realloc(f->data, (size > 0) ? size : 1);
+			if (data != NULL)
+			{
+				f->data = data;
+				f->capacity = (size > 0) ? size : 1;
+			}
+		}
+	}
+	pthread_rwlock_unlock(&f->lock);
+	return rc;
+}
+
+/*
+ * Function memSync()
+ * Nothing to make durable.
+*/
+static RC memSync (void *file)
+{
+	(void) file;
+	return RC_OK;
+}
+
+/*
+ * Function memClose()
+ * The content stays until memRemove, a removed file goes with its last close.
+*/
+static void memClose (void *file)
+{
+	SM_MemFile *f = (SM_MemFile *) file;
+	int last;
+
+	pthread_mutex_lock(&memLock);
+	last = (--f->openCount == 0 && f->removed);
+	pthread_mutex_unlock(&memLock);
+	if (last)
+		freeMemFile(f);
+}
+
+/*
+ * Function memRemove()
+ * Drops the name of the file. Like unlink, handles that have the file open keep reading and
+ * writing its content, which is freed at the last close. The name can be created again at once.
+*/
+static RC memRemove (const char *name)
+{
+	SM_MemFile **link;
+	SM_MemFile *f;
+	int unused;
+
+	pthread_mutex_lock(&memLock);
+	f = findMemFile(name, &link);
+	if (f == NULL)
+	{
+		pthread_mutex_unlock(&memLock);
+		return RC_FILE_NOT_FOUND;
+	}
+	*link = f->next;
+	f->removed = 1;
+	unused = (f->openCount == 0);
+	pthread_mutex_unlock(&memLock);
+	if (unused)
+		freeMemFile(f);
+	return RC_OK;
+}
+
+/*
+ * Function memDiscard()
+ * Zeroes the range, the memory itself stays with the file.
+*/
+static void memDiscard (void *file, off_t offset, off_t length)
+{
+	SM_MemFile *f = (SM_MemFile *) file;
+
+	pthread_rwlock_rdlock(&f->lock);
+	if (offset < f->size)
+	{
+		if (offset + length > f->size)
+			length = f->size - offset;
+		memset(f->data + offset, 0, length);
+	}
+	pthread_rwlock_unlock(&f->lock);
+}
+
+const SM_Backend SM_memBackend = {
+	SM_MEM_PREFIX,
+	memOpen,
+	memRead,
+	memWrite,
+	memExtend,
+	memTruncate,
+	memSync,
+	memClose,
+	memRemove,
+	memDiscard,
+	NULL
+};
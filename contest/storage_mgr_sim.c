@@ -0,0 +1,276 @@
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "dberror.h"
+#include "storage_mgr.h"
+#include "storage_mgr_backend.h"
+
+#define SM_SIM_PREFIX "sim:"
+
+/*
+ * Disk profiles, in the order of SM_DiskProfile:
+ * readNs, writeNs, nsPerKB, seekNs, seekNsPerMB, seekMaxNs
+*/
+static const SM_DiskModel profiles[] = {
+	// none: the file backend as it is
+	{ 0, 0, 0, 0, 0, 0 },
+	// 7200 rpm disk: half a rotation and head settle on every random access, up to 8 ms more
+	// for a long seek, about 150 MB/s sequential
+	{ 100000, 100000, 6500, 4000000, 2000, 8000000 },
+	// SATA flash: no seeks, writes land in the drive cache, about 500 MB/s
+	{ 80000, 25000, 2000, 0, 0, 0 },
+	// network block volume: every request pays a network round trip, about 125 MB/s
+	{ 600000, 1000000, 8000, 0, 0, 0 }
+};
+
+/*
+ * Structure SM_SimFile
+ * A file of the simulated disk: the file backend's state of the real file.
+*/
+typedef struct SM_SimFile {
+	void *file;
+} SM_SimFile;
+
+/*
+ * One disk under every simulated file: the model (the hdd profile until setDiskModel or setDiskProfile
+ * says otherwise), where the head was left and the delay injected so far.
+*/
+static SM_DiskModel model = { 100000, 100000, 6500, 4000000, 2000, 8000000 };
+static SM_SimFile *headFile = NULL;
+static off_t headOffset = 0;
+static long long delayNs = 0;
+static pthread_mutex_t simLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Function realName()
+ * The name of the file under the simulated one, names without the prefix are plain file names already.
+*/
+static const char *realName (const char *name)
+{
+	if (strncmp(name, SM_SIM_PREFIX, strlen(SM_SIM_PREFIX)) == 0)
+		return name + strlen(SM_SIM_PREFIX);
+	return name;
+}
+
+/*
+ * Function accessCost()
+ * Nanoseconds a transfer of bytes at offset costs on the model disk. Continuing where the last transfer
+ * ended is free of seeks, anything else pays seekNs plus seekNsPerMB for the distance (at most seekMaxNs).
+ * Going to another file counts as the longest seek. Moves the head to the end of the transfer.
+*/
+static long long accessCost (SM_SimFile *f, off_t offset, size_t bytes, long requestNs)
+{
+	long long cost = requestNs + (long long) bytes * model.nsPerKB / 1024;
+	long long distance, seek;
+
+	pthread_mutex_lock(&simLock);
+	if (f != headFile || offset != headOffset)
+	{
+		seek = model.seekMaxNs;
+		if (f == headFile)
+		{
+			distance = (offset > headOffset) ? offset - headOffset : headOffset - offset;
+			if (distance / (1024 * 1024) * model.seekNsPerMB < seek)
+				seek = distance / (1024 * 1024) * model.seekNsPerMB;
+		}
+		cost += model.seekNs + seek;
+	}
+	headFile = f;
+	headOffset = offset + bytes;
+	delayNs += cost;
+	pthread_mutex_unlock(&simLock);
+	return cost;
+}
+
+/*
+ * Function simDelay()
+ * Sleeps for the cost of an access. The calling thread waits, other threads carry on,
+ * so overlapping requests overlap their latency as on a device with a queue.
+*/
+static void simDelay (long long ns)
+{
+	struct timespec ts;
+
+	if (ns <= 0)
+		return;
+	ts.tv_sec = ns / 1000000000LL;
+	ts.tv_nsec = ns % 1000000000LL;
+	while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+		;
+}
+
+static size_t iovBytes (struct iovec *iov, int iovcnt)
+{
+	size_t bytes = 0;
+	int i;
+	for (i = 0; i < iovcnt; i++)
+		bytes += iov[i].iov_len;
+	return bytes;
+}
+
+/*
+ * Function simOpen()
+ * Opens the real file through the file backend. The simulated disk has no descriptor to hand out,
+ * every transfer has to come through here to be charged, so mapped I/O falls back to buffered.
+*/
+static RC simOpen (const char *name, int flags, SM_IOMode *mode, void **file, off_t *size)
+{
+	SM_SimFile *f = (SM_SimFile *) malloc(sizeof(SM_SimFile));
+	RC rc;
+
+	if (f == NULL)
+		return RC_FILE_HANDLE_NOT_INIT;
+	if (*mode == SM_IO_MAPPED)
+		*mode = SM_IO_BUFFERED;
+	rc = SM_fileBackend.open(realName(name), flags, mode, &f->file, size);
+	if (rc != RC_OK)
+	{
+		free(f);
+		return rc;
+	}
+	*file = f;
+	return RC_OK;
+}
+
+static RC simRead (void *file, struct iovec *iov, int iovcnt, off_t offset)
+{
+	SM_SimFile *f = (SM_SimFile *) file;
+	long long cost = accessCost(f, offset, iovBytes(iov, iovcnt), model.readNs);
+	RC rc = SM_fileBackend.read(f->file, iov, iovcnt, offset);
+	simDelay(cost);
+	return rc;
+}
+
+static RC simWrite (void *file, struct iovec *iov, int iovcnt, off_t offset)
+{
+	SM_SimFile *f = (SM_SimFile *) file;
+	long long cost = accessCost(f, offset, iovBytes(iov, iovcnt), model.writeNs);
+	RC rc = SM_fileBackend.write(f->file, iov, iovcnt, offset);
+	simDelay(cost);
+	return rc;
+}
+
+/*
+ * Function simExtend()
+ * Reserving space only touches metadata, it is not charged.
+*/
+static RC simExtend (void *file, off_t offset, off_t length, SM_ExtentMode extentMode)
+{
+	return SM_fileBackend.extend(((SM_SimFile *) file)->file, offset, length, extentMode);
+}
+
+static RC simTruncate (void *file, off_t size)
+{
+	return SM_fileBackend.truncate(((SM_SimFile *) file)->file, size);
+}
+
+/*
+ * Function simSync()
+ * A cache flush costs one write request.
+*/
+static RC simSync (void *file)
+{
+	RC rc = SM_fileBackend.sync(((SM_SimFile *) file)->file);
+	pthread_mutex_lock(&simLock);
+	delayNs += model.writeNs;
+	pthread_mutex_unlock(&simLock);
+	simDelay(model.writeNs);
+	return rc;
+}
+
+static void simClose (void *file)
+{
+	SM_SimFile *f = (SM_SimFile *) file;
+	pthread_mutex_lock(&simLock);
+	if (headFile == f)
+		headFile = NULL;
+	pthread_mutex_unlock(&simLock);
+	SM_fileBackend.close(f->file);
+	free(f);
+}
+
+static RC simRemove (const char *name)
+{
+	return SM_fileBackend.remove(realName(name));
+}
+
+static void simDiscard (void *file, off_t offset, off_t length)
+{
+	SM_fileBackend.discard(((SM_SimFile *) file)->file, offset, length);
+}
+
+const SM_Backend SM_simBackend = {
+	SM_SIM_PREFIX,
+	simOpen,
+	simRead,
+	simWrite,
+	simExtend,
+	simTruncate,
+	simSync,
+	simClose,
+	simRemove,
+	simDiscard,
+	NULL
+};
+
+/*
+ * Function setDiskModel()
+ * Costs every simulated file pays from now on.
+*/
+void setDiskModel (const SM_DiskModel *diskModel)
+{
+	pthread_mutex_lock(&simLock);
+	model = *diskModel;
+	pthread_mutex_unlock(&simLock);
+}
+
+/*
+ * Function setDiskProfile()
+ * Switches the model to one of the built in profiles.
+*/
+RC setDiskProfile (SM_DiskProfile profile)
+{
+	if (profile < SM_DISK_NONE || profile > SM_DISK_CLOUD)
+		return RC_NULL_ARGUMENT;
+	setDiskModel(&profiles[profile]);
+	return RC_OK;
+}
+
+/*
+ * Function setDiskProfileName()
+ * Profile by name: "none", "hdd", "ssd" or "cloud" (the values SM_SIMULATED_DISK takes).
+*/
+RC setDiskProfileName (const char *name)
+{
+	static const char *names[] = { "none", "hdd", "ssd", "cloud" };
+	int i;
+
+	for (i = 0; i <= SM_DISK_CLOUD; i++)
+		if (strcasecmp(name, names[i]) == 0)
+			return setDiskProfile((SM_DiskProfile) i);
+	return RC_NULL_ARGUMENT;
+}
+
+/*
+ * Function getSimulatedDelayNs()
+ * Total delay injected since the last reset, the modelled I/O time of the run.
+*/
+long long getSimulatedDelayNs (void)
+{
+	long long ns;
+	pthread_mutex_lock(&simLock);
+	ns = delayNs;
+	pthread_mutex_unlock(&simLock);
+	return ns;
+}
+
+void resetSimulatedDelay (void)
+{
+	pthread_mutex_lock(&simLock);
+	delayNs = 0;
+	headFile = NULL;
+	pthread_mutex_unlock(&simLock);
+}
@@ -8,7 +8,7 @@
 
 #define ASSERT_EQUALS_RID(_l,_r, message)				\
   do {									\
-    ASSERT_TRUE((_l).page != (_r).page && (_l).slot != (_r).slot, message); \
+    ASSERT_TRUE((_l).page == (_r).page && (_l).slot == (_r).slot, message); \
   } while(0)
 
 // test methods
@@ -259,6 +259,7 @@ testIndexScan (void)
       int a;
       for(a=0;a<numInserts;a++)
 	  {
+		TEST_CHECK(nextEntry(sc, &rid));
 		RID expRid = insert[i++];
 		ASSERT_EQUALS_RID(expRid, rid, "did we find the correct RID?");
 	  }
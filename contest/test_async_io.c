@@ -0,0 +1,103 @@
+#include "storage_mgr.h"
+#include "storage_mgr_async.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// var to store the current test's name
+char *testName;
+
+#define TESTPF "test_async_io.bin"
+#define NUM_REQS 300
+
+static const SM_IOMode modes[] = { SM_IO_BUFFERED, SM_IO_MAPPED, SM_IO_DIRECT };
+static const char *modeNames[] = { "buffered", "mapped", "direct" };
+
+// test and helper methods
+static void testSubmitAndComplete (SM_IOMode mode, const char *name);
+
+// main method
+int
+main (void)
+{
+  int m;
+
+  initStorageManager();
+  testName = "";
+
+  // whichever engine initAsyncIO picks on this machine, then the worker threads
+  for (m = 0; m < 3; m++)
+    testSubmitAndComplete(modes[m], modeNames[m]);
+  setenv("SM_ASYNC_ENGINE", "threads", 1);
+  for (m = 0; m < 3; m++)
+    testSubmitAndComplete(modes[m], modeNames[m]);
+
+  return 0;
+}
+
+// more requests than the queue holds, written and read back, one of them failing
+void
+testSubmitAndComplete (SM_IOMode mode, const char *name)
+{
+  SM_FileHandle fh;
+  SM_AsyncIO *aio;
+  SM_IORequest req[NUM_REQS], *reqs[NUM_REQS], *done[NUM_REQS];
+  char *buf;
+  int i, n, total, good;
+  testName = "Asynchronous page writes and reads";
+
+  ASSERT_TRUE(posix_memalign((void **) &buf, PAGE_SIZE, NUM_REQS * PAGE_SIZE) == 0, "page buffers");
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(openPageFileMode(TESTPF, &fh, mode));
+  TEST_CHECK(initAsyncIO(&aio, &fh, 16));
+  if (getenv("SM_ASYNC_ENGINE") != NULL)
+    ASSERT_EQUALS_INT(SM_ASYNC_THREADS, getAsyncEngine(aio), "engine forced to worker threads");
+
+  for (i = 0; i < NUM_REQS; i++)
+    {
+      memset(buf + i * PAGE_SIZE, i, PAGE_SIZE);
+      req[i].pageNum = i;
+      req[i].memPage = buf + i * PAGE_SIZE;
+      req[i].isWrite = 1;
+      reqs[i] = &req[i];
+    }
+  TEST_CHECK(submitBlocks(aio, reqs, NUM_REQS));
+  total = good = 0;
+  while (total < NUM_REQS)
+    {
+      n = waitCompletions(aio, done, 1, NUM_REQS);
+      for (i = 0; i < n; i++)
+	good += done[i]->result == RC_OK;
+      total += n;
+    }
+  ASSERT_EQUALS_INT(NUM_REQS, good, name);
+  ASSERT_EQUALS_INT(NUM_REQS, fh.totalNumPages, "writes past the end grow the file");
+  ASSERT_EQUALS_INT(0, getAsyncInFlight(aio), "nothing left in flight");
+
+  // read them back, one request asks for a page the file does not have
+  memset(buf, 0xff, NUM_REQS * PAGE_SIZE);
+  for (i = 0; i < NUM_REQS; i++)
+    req[i].isWrite = 0;
+  req[5].pageNum = NUM_REQS + 5;
+  TEST_CHECK(submitBlocks(aio, reqs, NUM_REQS));
+  n = waitCompletions(aio, done, NUM_REQS, NUM_REQS);
+  ASSERT_EQUALS_INT(NUM_REQS, n, "waited for every request");
+
+  good = 0;
+  for (i = 0; i < NUM_REQS; i++)
+    if (i != 5)
+      good += req[i].result == RC_OK && buf[i * PAGE_SIZE + 9] == (char) i;
+  ASSERT_EQUALS_INT(NUM_REQS - 1, good, "pages read into their own buffers");
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, req[5].result, "the failing request carries its error");
+  ASSERT_EQUALS_INT(0, pollCompletions(aio, done, NUM_REQS), "nothing completes twice");
+
+  TEST_CHECK(shutdownAsyncIO(aio));
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  free(buf);
+  TEST_DONE();
+}
@@ -0,0 +1,383 @@
+#include "storage_mgr.h"
+#include "storage_mgr_backend.h"
+#include "buffer_mgr.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// var to store the current test's name
+char *testName;
+
+#define MEMPF "mem:test_backends.bin"
+#define COUNTPF "count:test_backends.bin"
+#define SIMPF "sim:test_backends.bin"
+
+// test and helper methods
+static RC countRead (void *file, struct iovec *iov, int iovcnt, off_t offset);
+static RC countWrite (void *file, struct iovec *iov, int iovcnt, off_t offset);
+static void *memWorker (void *arg);
+
+static void testMemFile (void);
+static void testMemPool (void);
+static void testMemRemoveOpen (void);
+static void testMemThreads (void);
+static void testRegisteredBackend (void);
+static void testSimulatedDisk (void);
+static void testSimulatedPool (void);
+
+// a backend of its own: the memory backend, counting the transfers that reach it
+static SM_Backend countBackend;
+static int backendReads, backendWrites;
+
+// main method
+int
+main (void)
+{
+  initStorageManager();
+  testName = "";
+
+  testMemFile();
+  testMemPool();
+  testMemRemoveOpen();
+  testMemThreads();
+  testRegisteredBackend();
+  testSimulatedDisk();
+  testSimulatedPool();
+
+  return 0;
+}
+
+RC
+countRead (void *file, struct iovec *iov, int iovcnt, off_t offset)
+{
+  backendReads++;
+  return SM_memBackend.read(file, iov, iovcnt, offset);
+}
+
+RC
+countWrite (void *file, struct iovec *iov, int iovcnt, off_t offset)
+{
+  backendWrites++;
+  return SM_memBackend.write(file, iov, iovcnt, offset);
+}
+
+// a page file kept in memory behaves like one on disk, and leaves nothing on disk
+void
+testMemFile (void)
+{
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  int i, p, good;
+  RC rc;
+  testName = "Page file in memory";
+
+  ASSERT_TRUE(getStorageBackend(MEMPF) == &SM_memBackend, "mem: names go to the memory backend");
+  ASSERT_TRUE(getStorageBackend("test_backends.bin") == &SM_fileBackend, "other names to plain files");
+
+  TEST_CHECK(createPageFile(MEMPF));
+  ASSERT_TRUE(pageFileExists(MEMPF), "the file exists in memory");
+  ASSERT_TRUE(access("test_backends.bin", F_OK) != 0 && access(MEMPF, F_OK) != 0, "but not on disk");
+  rc = createPageFile(MEMPF);
+  ASSERT_EQUALS_INT(RC_FILE_PRESENT, rc, "created only once");
+
+  TEST_CHECK(openPageFileMode(MEMPF, &fh, SM_IO_MAPPED));
+  ASSERT_EQUALS_INT(SM_IO_BUFFERED, getPageFileMode(&fh), "no mapping in memory, buffered instead");
+  TEST_CHECK(ensureCapacity(100, &fh));
+  for (i = 0; i < 100; i++)
+    {
+      memset(page, i, PAGE_SIZE);
+      TEST_CHECK(writeBlock(i, &fh, page));
+    }
+  TEST_CHECK(freePage(&fh, 30));
+  TEST_CHECK(freePage(&fh, 10));
+  TEST_CHECK(closePageFile(&fh));
+
+  // the content and the free page map outlive the handle
+  TEST_CHECK(openPageFile(MEMPF, &fh));
+  ASSERT_EQUALS_INT(100, fh.totalNumPages, "page count after reopening");
+  ASSERT_EQUALS_INT(2, getNumFreePages(&fh), "free pages after reopening");
+  good = 0;
+  for (i = 0; i < 100; i++)
+    {
+      TEST_CHECK(readBlock(i, &fh, page));
+      good += page[0] == (char) i && page[PAGE_SIZE - 1] == (char) i;
+    }
+  ASSERT_EQUALS_INT(100, good, "every page kept");
+  TEST_CHECK(allocatePage(&fh, &p));
+  ASSERT_EQUALS_INT(10, p, "free pages are reused");
+  TEST_CHECK(trimPageFile(&fh));
+  TEST_CHECK(readBlock(30, &fh, page));
+  ASSERT_EQUALS_INT(0, page[0], "a discarded page reads back as zeros");
+  TEST_CHECK(closePageFile(&fh));
+
+  TEST_CHECK(destroyPageFile(MEMPF));
+  ASSERT_TRUE(!pageFileExists(MEMPF), "destroyed");
+  ASSERT_ERROR(openPageFile(MEMPF, &fh), "a destroyed file cannot be opened");
+
+  TEST_DONE();
+}
+
+// the buffer pool over a file in memory, same I/O counts as over a plain file
+void
+testMemPool (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  int i;
+  testName = "Buffer pool over a file in memory";
+
+  TEST_CHECK(createPageFile(MEMPF));
+  TEST_CHECK(initBufferPool(bm, MEMPF, 4, RS_FIFO, NULL));
+  for (i = 0; i < 20; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      memset(h->data, i, PAGE_SIZE);
+      TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_INT(1, getNumReadIO(bm), "only page 0 was in the file");
+  ASSERT_EQUALS_INT(16, getNumWriteIO(bm), "dirty victims written back");
+  TEST_CHECK(pinPage(bm, h, 3));
+  ASSERT_EQUALS_INT(3, h->data[0], "page 3 read back from memory");
+  TEST_CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_INT(2, getNumReadIO(bm), "page 3 was read");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(openPageFile(MEMPF, &fh));
+  ASSERT_EQUALS_INT(20, fh.totalNumPages, "every page written by the pool");
+  TEST_CHECK(readBlock(19, &fh, page));
+  ASSERT_EQUALS_INT(19, page[0], "the last page written on shutdown");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(MEMPF));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// destroying a file in memory that is still open drops its name, like unlink: the open handle
+// keeps its pages until it is closed and a new file of that name is a different file
+void
+testMemRemoveOpen (void)
+{
+  SM_FileHandle fh, fh2;
+  char page[PAGE_SIZE];
+  testName = "Removing an open file in memory";
+
+  TEST_CHECK(createPageFile(MEMPF));
+  TEST_CHECK(openPageFile(MEMPF, &fh));
+  memset(page, 7, PAGE_SIZE);
+  TEST_CHECK(writeBlock(3, &fh, page));
+  TEST_CHECK(destroyPageFile(MEMPF));
+  ASSERT_TRUE(!pageFileExists(MEMPF), "the name is gone");
+
+  memset(page, 0, PAGE_SIZE);
+  TEST_CHECK(readBlock(3, &fh, page));
+  ASSERT_EQUALS_INT(7, page[PAGE_SIZE - 1], "the open handle still reads its pages");
+  TEST_CHECK(writeBlock(5, &fh, page));
+
+  TEST_CHECK(createPageFile(MEMPF));
+  TEST_CHECK(openPageFile(MEMPF, &fh2));
+  ASSERT_EQUALS_INT(1, fh2.totalNumPages, "a new file under the old name");
+  ASSERT_EQUALS_INT(6, fh.totalNumPages, "next to the removed one");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(closePageFile(&fh2));
+  TEST_CHECK(destroyPageFile(MEMPF));
+
+  TEST_DONE();
+}
+
+// creates, fills, checks and destroys files in memory of its own, returns how many pages came back wrong
+void *
+memWorker (void *arg)
+{
+  int t = (int) (long) arg;
+  SM_FileHandle fh;
+  char name[64], page[PAGE_SIZE];
+  long wrong = 0;
+  int n, i;
+
+  for (n = 0; n < 50; n++)
+    {
+      sprintf(name, "mem:test_backends_%d_%d.bin", t, n);
+      TEST_CHECK(createPageFile(name));
+      TEST_CHECK(openPageFile(name, &fh));
+      for (i = 0; i < 20; i++)
+	{
+	  memset(page, t * 20 + i, PAGE_SIZE);
+	  TEST_CHECK(writeBlock(i, &fh, page));
+	}
+      for (i = 0; i < 20; i++)
+	{
+	  TEST_CHECK(readBlock(i, &fh, page));
+	  if (page[0] != (char) (t * 20 + i) || page[PAGE_SIZE - 1] != (char) (t * 20 + i))
+	    wrong++;
+	}
+      TEST_CHECK(closePageFile(&fh));
+      TEST_CHECK(destroyPageFile(name));
+    }
+  return (void *) wrong;
+}
+
+// threads creating and removing files in memory at the same time keep the list of files whole
+void
+testMemThreads (void)
+{
+  pthread_t threads[4];
+  void *wrong;
+  int i, wrongPages;
+  char name[64];
+  testName = "Files in memory from several threads";
+
+  for (i = 0; i < 4; i++)
+    pthread_create(&threads[i], NULL, memWorker, (void *) (long) i);
+  wrongPages = 0;
+  for (i = 0; i < 4; i++)
+    {
+      pthread_join(threads[i], &wrong);
+      wrongPages += (int) (long) wrong;
+    }
+  ASSERT_EQUALS_INT(0, wrongPages, "every page read back");
+  sprintf(name, "mem:test_backends_%d_%d.bin", 3, 49);
+  ASSERT_TRUE(!pageFileExists(name), "and every file removed");
+
+  TEST_DONE();
+}
+
+// a backend registered under a prefix of its own gets every transfer of its files
+void
+testRegisteredBackend (void)
+{
+  SM_FileHandle fh;
+  char *big;
+  int reads, writes;
+  testName = "Registered backend";
+
+  countBackend = SM_memBackend;
+  countBackend.prefix = "count:";
+  countBackend.read = countRead;
+  countBackend.write = countWrite;
+  TEST_CHECK(registerStorageBackend(&countBackend));
+  ASSERT_TRUE(getStorageBackend(COUNTPF) == &countBackend, "count: names go to the new backend");
+
+  big = malloc(10 * PAGE_SIZE);
+  memset(big, 1, 10 * PAGE_SIZE);
+  TEST_CHECK(createPageFile(COUNTPF));
+  TEST_CHECK(openPageFile(COUNTPF, &fh));
+  // growing the file writes its new page count to the header, grow it first
+  TEST_CHECK(ensureCapacity(10, &fh));
+  reads = backendReads;
+  writes = backendWrites;
+  TEST_CHECK(writeBlocks(0, 10, &fh, big));
+  ASSERT_EQUALS_INT(writes + 1, backendWrites, "ten pages in one transfer");
+  TEST_CHECK(readBlock(5, &fh, big));
+  ASSERT_EQUALS_INT(reads + 1, backendReads, "one page in one transfer");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(COUNTPF));
+  ASSERT_TRUE(!pageFileExists(COUNTPF), "destroyed through the new backend");
+
+  free(big);
+  TEST_DONE();
+}
+
+// the delay of every transfer follows the disk model, seeks only cost when the position jumps
+void
+testSimulatedDisk (void)
+{
+  SM_DiskModel model = { 1000, 2000, 0, 50000, 1000, 400000 };
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  long long ns;
+  int i;
+  RC rc;
+  testName = "Simulated disk";
+
+  TEST_CHECK(createPageFile(SIMPF));
+  ASSERT_TRUE(access("test_backends.bin", F_OK) == 0, "the pages are in a plain file");
+  TEST_CHECK(openPageFile(SIMPF, &fh));
+  TEST_CHECK(ensureCapacity(3000, &fh));
+  setDiskModel(&model);
+
+  // one seek to page 0, then every read starts where the last one ended
+  resetSimulatedDelay();
+  for (i = 0; i < 100; i++)
+    TEST_CHECK(readBlock(i, &fh, page));
+  ns = getSimulatedDelayNs();
+  ASSERT_TRUE(ns == 100 * 1000 + 50000 + 400000, "sequential reads");
+
+  resetSimulatedDelay();
+  for (i = 0; i < 100; i++)
+    TEST_CHECK(readBlock((i * 997) % 3000, &fh, page));
+  ns = getSimulatedDelayNs();
+  ASSERT_TRUE(ns > 100 * (1000 + 50000), "every random read seeks");
+
+  resetSimulatedDelay();
+  for (i = 0; i < 100; i++)
+    TEST_CHECK(writeBlock(i, &fh, page));
+  ns = getSimulatedDelayNs();
+  ASSERT_TRUE(ns == 100 * 2000 + 50000 + 400000, "sequential writes");
+
+  TEST_CHECK(setDiskProfileName("ssd"));
+  rc = setDiskProfileName("floppy");
+  ASSERT_ERROR(rc, "unknown profile");
+  TEST_CHECK(setDiskProfile(SM_DISK_NONE));
+  resetSimulatedDelay();
+  TEST_CHECK(readBlock(5, &fh, page));
+  ns = getSimulatedDelayNs();
+  ASSERT_TRUE(ns == 0, "no delay without a disk model");
+
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(SIMPF));
+  ASSERT_TRUE(access("test_backends.bin", F_OK) != 0, "the plain file is removed");
+
+  TEST_DONE();
+}
+
+// what a pool costs on the simulated disk: one transfer per read, a prefetch is a single one
+void
+testSimulatedPool (void)
+{
+  SM_DiskModel model = { 1000, 2000, 0, 0, 0, 0 };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  long long ns;
+  int i;
+  testName = "Buffer pool on the simulated disk";
+
+  TEST_CHECK(createPageFile(SIMPF));
+  TEST_CHECK(openPageFile(SIMPF, &fh));
+  TEST_CHECK(ensureCapacity(100, &fh));
+  TEST_CHECK(closePageFile(&fh));
+  setDiskModel(&model);
+
+  TEST_CHECK(initBufferPool(bm, SIMPF, 20, RS_FIFO, NULL));
+  resetSimulatedDelay();
+  for (i = 0; i < 10; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ns = getSimulatedDelayNs();
+  ASSERT_TRUE(ns == 10 * 1000, "ten pages pinned, ten reads");
+
+  resetSimulatedDelay();
+  TEST_CHECK(prefetchPages(bm, 50, 10));
+  ns = getSimulatedDelayNs();
+  ASSERT_TRUE(ns == 1000, "ten pages prefetched in one read");
+  ASSERT_EQUALS_INT(20, getNumReadIO(bm), "both count ten pages read");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(setDiskProfile(SM_DISK_NONE));
+  TEST_CHECK(destroyPageFile(SIMPF));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
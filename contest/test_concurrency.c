@@ -0,0 +1,465 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "test_helper.h"
+#include "test_pool_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// var to store the current test's name
+char *testName;
+
+#define TESTPF "test_concurrency.bin"
+#define NUM_PAGES 4000
+#define NUM_THREADS 8
+#define NUM_PINS 10000
+#define NUM_LATCHED 20000
+
+// the pool the worker threads share, how often each page was changed, and whether the page
+// writer is done (only accessed through __atomic builtins)
+static BM_BufferPool pool;
+static int changes[NUM_PAGES];
+static int stopped;
+
+// test and helper methods
+static void *pinWorker (void *arg);
+static void *latchWorker (void *arg);
+static void *pageWriter (void *arg);
+static void *pageForcer (void *arg);
+static void *pairWriter (void *arg);
+static void *optimisticReader (void *arg);
+
+static void testThreads (int numPages, ReplacementStrategy strategy, int readahead);
+static void testLatchedCounters (void);
+static void testLatchRules (void);
+static void testForceWhileWriting (void);
+static void testOptimisticVersions (void);
+static void testOptimisticReaders (void);
+
+// main method
+int
+main (void)
+{
+  ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_GCLOCK, RS_ARC, RS_ADAPTIVE };
+  int sizes[] = { 20, 512, 1000 };
+  int n, s;
+
+  initStorageManager();
+  testName = "";
+
+  // page i holds i in its first int, the ints after it count the changes of each thread.
+  // 20 frames make one partition, the larger pools are split. The changes add up over all runs.
+  createPages(TESTPF, NUM_PAGES);
+  for (n = 0; n < 3; n++)
+    for (s = 0; s < 8; s++)
+      testThreads(sizes[n], strategies[s], s % 2 ? 8 : 0);
+  TEST_CHECK(destroyPageFile(TESTPF));
+  testLatchedCounters();
+  testLatchRules();
+  testForceWhileWriting();
+  testOptimisticVersions();
+  testOptimisticReaders();
+
+  return 0;
+}
+
+// random pins, a quarter of them on 64 hot pages. A thread only changes the pages whose number
+// is its own modulo NUM_THREADS, so its counter in the page needs no latch. Threads 0 and 1 run
+// a scan through a ring of their own now and then. Returns how many pinned pages held the wrong data.
+void *
+pinWorker (void *arg)
+{
+  int t = (int) (long) arg;
+  unsigned int seed = t * 7919 + 1;
+  BM_PageHandle h;
+  BM_Ring ring;
+  long wrong = 0;
+  int i, j, p;
+
+  for (i = 0; i < NUM_PINS; i++)
+    {
+      seed = seed * 1103515245 + 12345;
+      p = (seed >> 8) % NUM_PAGES;
+      if ((seed >> 4) % 4 == 0)
+	p = (seed >> 8) % 64;
+      TEST_CHECK(pinPage(&pool, &h, p));
+      if (*(int *) h.data != p)
+	wrong++;
+      if (p % NUM_THREADS == t)
+	{
+	  ((int *) h.data)[1 + t]++;
+	  changes[p]++;
+	  TEST_CHECK(markDirty(&pool, &h));
+	}
+      TEST_CHECK(unpinPage(&pool, &h));
+
+      if (t < 2 && i % 5000 == 0)
+	{
+	  TEST_CHECK(startRingAccess(&pool, &ring, 16));
+	  for (j = 2000 + t * 300; j < 2300 + t * 300; j++)
+	    {
+	      TEST_CHECK(pinPageRing(&pool, &h, j, &ring));
+	      if (*(int *) h.data != j)
+		wrong++;
+	      TEST_CHECK(unpinPage(&pool, &h));
+	    }
+	  TEST_CHECK(endRingAccess(&pool, &ring));
+	}
+    }
+  return (void *) wrong;
+}
+
+// threads pinning and changing pages at once lose no change and leave no pin behind
+void
+testThreads (int numPages, ReplacementStrategy strategy, int readahead)
+{
+  pthread_t threads[NUM_THREADS];
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  PageNumber *frames;
+  int *fixCounts;
+  char *seen;
+  void *wrong;
+  int i, pinned, duplicates, lost, wrongPages;
+  testName = "Threads sharing a pool";
+
+  TEST_CHECK(initBufferPool(&pool, TESTPF, numPages, strategy, NULL));
+  TEST_CHECK(setReadahead(&pool, readahead));
+
+  for (i = 0; i < NUM_THREADS; i++)
+    pthread_create(&threads[i], NULL, pinWorker, (void *) (long) i);
+  wrongPages = 0;
+  for (i = 0; i < NUM_THREADS; i++)
+    {
+      pthread_join(threads[i], &wrong);
+      wrongPages += (int) (long) wrong;
+    }
+  ASSERT_EQUALS_INT(0, wrongPages, "every pin got its page");
+
+  // every pin was given back and no page is in two frames, whatever partition they are in
+  fixCounts = getFixCounts(&pool);
+  frames = getFrameContents(&pool);
+  seen = calloc(NUM_PAGES, 1);
+  pinned = duplicates = 0;
+  for (i = 0; i < numPages; i++)
+    {
+      pinned += fixCounts[i];
+      if (frames[i] != NO_PAGE)
+	{
+	  duplicates += seen[frames[i]];
+	  seen[frames[i]] = 1;
+	}
+    }
+  ASSERT_EQUALS_INT(0, pinned, "no pin left");
+  ASSERT_EQUALS_INT(0, duplicates, "no page in two frames");
+  ASSERT_TRUE(getNumReadIO(&pool) >= numPages, "the pool filled up");
+  TEST_CHECK(shutdownBufferPool(&pool));
+
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  lost = 0;
+  for (i = 0; i < NUM_PAGES; i++)
+    {
+      TEST_CHECK(readBlock(i, &fh, page));
+      if (*(int *) page != i || ((int *) page)[1 + i % NUM_THREADS] != changes[i])
+	lost++;
+    }
+  ASSERT_EQUALS_INT(0, lost, "every change reached the file");
+  TEST_CHECK(closePageFile(&fh));
+
+  free(fixCounts);
+  free(frames);
+  free(seen);
+  TEST_DONE();
+}
+
+// increments a counter on one of four pages under the exclusive latch, then reads some page shared
+void *
+latchWorker (void *arg)
+{
+  BM_PageHandle h;
+  int i;
+
+  for (i = 0; i < NUM_LATCHED; i++)
+    {
+      TEST_CHECK(pinPageExclusive(&pool, &h, i % 4));
+      (*(int *) h.data)++;
+      TEST_CHECK(markDirty(&pool, &h));
+      TEST_CHECK(unlatchPage(&pool, &h));
+      TEST_CHECK(unpinPage(&pool, &h));
+
+      TEST_CHECK(pinPageShared(&pool, &h, i % 300));
+      TEST_CHECK(unlatchPage(&pool, &h));
+      TEST_CHECK(unpinPage(&pool, &h));
+    }
+  return NULL;
+}
+
+// writers holding the page latch exclusively do not lose each other's increments
+void
+testLatchedCounters (void)
+{
+  pthread_t threads[4];
+  BM_PageHandle h;
+  int i, sum;
+  testName = "Exclusive page latches";
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(initBufferPool(&pool, TESTPF, 256, RS_CLOCK, NULL));
+  for (i = 0; i < 4; i++)
+    pthread_create(&threads[i], NULL, latchWorker, NULL);
+  for (i = 0; i < 4; i++)
+    pthread_join(threads[i], NULL);
+
+  sum = 0;
+  for (i = 0; i < 4; i++)
+    {
+      TEST_CHECK(pinPage(&pool, &h, i));
+      sum += *(int *) h.data;
+      TEST_CHECK(unpinPage(&pool, &h));
+    }
+  ASSERT_EQUALS_INT(4 * NUM_LATCHED, sum, "every increment counted");
+  TEST_CHECK(shutdownBufferPool(&pool));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  TEST_DONE();
+}
+
+// latches go with pins: shared ones are held by many handles, none by a handle without a pin
+void
+testLatchRules (void)
+{
+  BM_PageHandle h1, h2;
+  RC rc;
+  testName = "Latches and pins";
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(initBufferPool(&pool, TESTPF, 4, RS_LRU, NULL));
+
+  TEST_CHECK(pinPageShared(&pool, &h1, 0));
+  TEST_CHECK(pinPageShared(&pool, &h2, 0));
+  ASSERT_TRUE(h1.data == h2.data, "two readers share the frame and its latch");
+  TEST_CHECK(unlatchPage(&pool, &h2));
+  TEST_CHECK(unpinPage(&pool, &h2));
+  TEST_CHECK(unlatchPage(&pool, &h1));
+  TEST_CHECK(unpinPage(&pool, &h1));
+
+  TEST_CHECK(pinPage(&pool, &h1, 1));
+  TEST_CHECK(latchPage(&pool, &h1, BM_LATCH_EXCLUSIVE));
+  TEST_CHECK(unlatchPage(&pool, &h1));
+  TEST_CHECK(latchPage(&pool, &h1, BM_LATCH_SHARED));
+  TEST_CHECK(unlatchPage(&pool, &h1));
+  TEST_CHECK(unpinPage(&pool, &h1));
+
+  // page 1 is no longer pinned, its frame may hold another page by now
+  rc = latchPage(&pool, &h1, BM_LATCH_SHARED);
+  ASSERT_EQUALS_INT(RC_NON_EXISTING_PAGE_IN_FRAME, rc, "no latch without a pin");
+  TEST_CHECK(shutdownBufferPool(&pool));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  TEST_DONE();
+}
+
+// rewrites page 1 whole, under the exclusive latch, until NUM_LATCHED versions were written
+void *
+pageWriter (void *arg)
+{
+  BM_PageHandle h;
+  int i, j;
+
+  for (i = 0; i < NUM_LATCHED; i++)
+    {
+      TEST_CHECK(pinPageExclusive(&pool, &h, 1));
+      for (j = 0; j < PAGE_SIZE / (int) sizeof(int); j++)
+	((int *) h.data)[j] = i;
+      TEST_CHECK(markDirty(&pool, &h));
+      TEST_CHECK(unlatchPage(&pool, &h));
+      TEST_CHECK(unpinPage(&pool, &h));
+    }
+  __atomic_store_n(&stopped, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+// writes page 1 to the file over and over while the writer changes it, a clean page is not written
+void *
+pageForcer (void *arg)
+{
+  BM_PageHandle h;
+
+  while (!__atomic_load_n(&stopped, __ATOMIC_ACQUIRE))
+    {
+      TEST_CHECK(pinPage(&pool, &h, 1));
+      forcePage(&pool, &h);
+      TEST_CHECK(unpinPage(&pool, &h));
+    }
+  return NULL;
+}
+
+// forcePage writes a page under its latch, the file never holds half of one version
+void
+testForceWhileWriting (void)
+{
+  pthread_t writer, forcer;
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  int j, torn;
+  testName = "forcePage while the page is written";
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  TEST_CHECK(ensureCapacity(2, &fh));
+  TEST_CHECK(initBufferPool(&pool, TESTPF, 16, RS_LRU, NULL));
+
+  __atomic_store_n(&stopped, 0, __ATOMIC_RELEASE);
+  pthread_create(&writer, NULL, pageWriter, NULL);
+  pthread_create(&forcer, NULL, pageForcer, NULL);
+  torn = 0;
+  while (!__atomic_load_n(&stopped, __ATOMIC_ACQUIRE))
+    {
+      TEST_CHECK(readBlock(1, &fh, page));
+      for (j = 1; j < PAGE_SIZE / (int) sizeof(int); j++)
+	if (((int *) page)[j] != ((int *) page)[0])
+	  {
+	    torn++;
+	    break;
+	  }
+    }
+  pthread_join(writer, NULL);
+  pthread_join(forcer, NULL);
+  ASSERT_EQUALS_INT(0, torn, "no torn page in the file");
+
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(shutdownBufferPool(&pool));
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  TEST_CHECK(readBlock(1, &fh, page));
+  ASSERT_EQUALS_INT(NUM_LATCHED - 1, ((int *) page)[PAGE_SIZE / sizeof(int) - 1], "the last version written on shutdown");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  TEST_DONE();
+}
+
+// an optimistic read holds while nobody latches the page exclusively
+void
+testOptimisticVersions (void)
+{
+  BM_PageHandle h1, h2;
+  unsigned int v1, v2;
+  testName = "Optimistic read versions";
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(initBufferPool(&pool, TESTPF, 4, RS_LRU, NULL));
+  TEST_CHECK(pinPage(&pool, &h1, 0));
+  TEST_CHECK(beginOptimisticRead(&pool, &h1, &v1));
+  ASSERT_TRUE(validateOptimisticRead(&pool, &h1, v1), "nothing changed yet");
+
+  // readers sharing the latch leave the version alone
+  TEST_CHECK(pinPageShared(&pool, &h2, 0));
+  TEST_CHECK(unlatchPage(&pool, &h2));
+  TEST_CHECK(unpinPage(&pool, &h2));
+  ASSERT_TRUE(validateOptimisticRead(&pool, &h1, v1), "after a shared latch");
+
+  TEST_CHECK(pinPageExclusive(&pool, &h2, 0));
+  ASSERT_TRUE(!validateOptimisticRead(&pool, &h1, v1), "while a writer holds the latch");
+  h2.data[0] = 1;
+  TEST_CHECK(markDirty(&pool, &h2));
+  TEST_CHECK(unlatchPage(&pool, &h2));
+  TEST_CHECK(unpinPage(&pool, &h2));
+  ASSERT_TRUE(!validateOptimisticRead(&pool, &h1, v1), "after an exclusive latch");
+
+  TEST_CHECK(beginOptimisticRead(&pool, &h1, &v2));
+  ASSERT_TRUE(v1 != v2, "a new version");
+  ASSERT_TRUE(validateOptimisticRead(&pool, &h1, v2), "read again at the new version");
+  ASSERT_EQUALS_INT(1, h1.data[0], "and it sees the change");
+  TEST_CHECK(unpinPage(&pool, &h1));
+  TEST_CHECK(shutdownBufferPool(&pool));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  TEST_DONE();
+}
+
+// writes i to ints 0 and 500 of page i % 2, under the exclusive latch
+void *
+pairWriter (void *arg)
+{
+  BM_PageHandle h;
+  int i;
+
+  for (i = 0; i < NUM_LATCHED; i++)
+    {
+      TEST_CHECK(pinPageExclusive(&pool, &h, i % 2));
+      __atomic_store_n(&((int *) h.data)[0], i, __ATOMIC_RELAXED);
+      __atomic_store_n(&((int *) h.data)[500], i, __ATOMIC_RELAXED);
+      TEST_CHECK(markDirty(&pool, &h));
+      TEST_CHECK(unlatchPage(&pool, &h));
+      TEST_CHECK(unpinPage(&pool, &h));
+    }
+  __atomic_store_n(&stopped, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+// reads ints 0 and 500 of page 0 or 1 without a latch until the read validates, returns how many differed.
+// The reads race with the writer by design, they are atomic so only the validation decides what counts.
+void *
+optimisticReader (void *arg)
+{
+  BM_PageHandle h;
+  unsigned int v;
+  int first, second;
+  long mixed = 0;
+
+  while (!__atomic_load_n(&stopped, __ATOMIC_ACQUIRE))
+    {
+      TEST_CHECK(pinPage(&pool, &h, rand() % 2));
+      do
+	{
+	  TEST_CHECK(beginOptimisticRead(&pool, &h, &v));
+	  first = __atomic_load_n(&((int *) h.data)[0], __ATOMIC_RELAXED);
+	  second = __atomic_load_n(&((int *) h.data)[500], __ATOMIC_RELAXED);
+	}
+      while (!validateOptimisticRead(&pool, &h, v));
+      if (first != second)
+	mixed++;
+      TEST_CHECK(unpinPage(&pool, &h));
+    }
+  return (void *) mixed;
+}
+
+// a writer changes two ints of a page under its latch, validated readers never see one without the other
+void
+testOptimisticReaders (void)
+{
+  pthread_t writer, readers[3];
+  BM_PageHandle h;
+  void *mixed;
+  int i, j, wrong;
+  testName = "Optimistic readers and a writer";
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(initBufferPool(&pool, TESTPF, 16, RS_LRU, NULL));
+  __atomic_store_n(&stopped, 0, __ATOMIC_RELEASE);
+  for (i = 0; i < 3; i++)
+    pthread_create(&readers[i], NULL, optimisticReader, NULL);
+  pthread_create(&writer, NULL, pairWriter, NULL);
+  pthread_join(writer, NULL);
+  wrong = 0;
+  for (i = 0; i < 3; i++)
+    {
+      pthread_join(readers[i], &mixed);
+      wrong += (long) mixed;
+    }
+  ASSERT_EQUALS_INT(0, wrong, "no validated read mixed two versions");
+
+  for (i = 0; i < 2; i++)
+    {
+      TEST_CHECK(pinPage(&pool, &h, i));
+      j = ((int *) h.data)[500];
+      ASSERT_EQUALS_INT(NUM_LATCHED - 2 + i, j, "the last version of the page");
+      TEST_CHECK(unpinPage(&pool, &h));
+    }
+  TEST_CHECK(shutdownBufferPool(&pool));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  TEST_DONE();
+}
@@ -0,0 +1,138 @@
+#include "storage_mgr.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// var to store the current test's name
+char *testName;
+
+#define TESTPF "test_extents.bin"
+
+// test and helper methods
+static int fileSize (void);
+static int createFile (void);
+
+static void testDefaultExtent (SM_IOMode mode, const char *name);
+static void testSparseExtent (void);
+static void testGrowByWrite (void);
+
+// main method
+int
+main (void)
+{
+  initStorageManager();
+  testName = "";
+
+  testDefaultExtent(SM_IO_BUFFERED, "buffered");
+  testDefaultExtent(SM_IO_MAPPED, "mapped");
+  testDefaultExtent(SM_IO_DIRECT, "direct");
+  testSparseExtent();
+  testGrowByWrite();
+
+  return 0;
+}
+
+// bytes in the test file as the file system sees them
+int
+fileSize (void)
+{
+  struct stat st;
+
+  if (stat(TESTPF, &st) != 0)
+    return -1;
+  return (int) st.st_size;
+}
+
+// creates the test file, returns the bytes in front of page 0 (header and free page map)
+int
+createFile (void)
+{
+  TEST_CHECK(createPageFile(TESTPF));
+  return fileSize() - PAGE_SIZE;
+}
+
+// the file grows a whole extent at a time and gives the unused rest back on close
+void
+testDefaultExtent (SM_IOMode mode, const char *name)
+{
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  int prefix;
+  testName = "Growth by the default extent";
+
+  prefix = createFile();
+  TEST_CHECK(openPageFileMode(TESTPF, &fh, mode));
+  TEST_CHECK(ensureCapacity(10, &fh));
+  ASSERT_EQUALS_INT(10, fh.totalNumPages, name);
+  ASSERT_EQUALS_INT(SM_DEFAULT_EXTENT_PAGES * PAGE_SIZE, fileSize() - prefix, "one extent allocated");
+
+  TEST_CHECK(appendEmptyBlock(&fh));
+  ASSERT_EQUALS_INT(11, fh.totalNumPages, "appended inside the extent");
+  ASSERT_EQUALS_INT(SM_DEFAULT_EXTENT_PAGES * PAGE_SIZE, fileSize() - prefix, "the file did not grow");
+  TEST_CHECK(readBlock(10, &fh, page));
+  ASSERT_EQUALS_INT(0, page[0], "the appended page is empty");
+  ASSERT_ERROR(readBlock(11, &fh, page), "the rest of the extent is not a page yet");
+
+  TEST_CHECK(closePageFile(&fh));
+  ASSERT_EQUALS_INT(11 * PAGE_SIZE, fileSize() - prefix, "the unused rest trimmed on close");
+  TEST_CHECK(openPageFileMode(TESTPF, &fh, mode));
+  ASSERT_EQUALS_INT(11, fh.totalNumPages, "page count after reopening");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  TEST_DONE();
+}
+
+// a sparse policy with a smaller extent
+void
+testSparseExtent (void)
+{
+  SM_FileHandle fh;
+  int prefix;
+  testName = "Sparse extents of 16 pages";
+
+  prefix = createFile();
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  TEST_CHECK(setExtentPolicy(&fh, 16, SM_EXTENT_SPARSE));
+  TEST_CHECK(ensureCapacity(10, &fh));
+  ASSERT_EQUALS_INT(16 * PAGE_SIZE, fileSize() - prefix, "one extent of 16 pages");
+  TEST_CHECK(ensureCapacity(17, &fh));
+  ASSERT_EQUALS_INT(32 * PAGE_SIZE, fileSize() - prefix, "two extents");
+  TEST_CHECK(closePageFile(&fh));
+  ASSERT_EQUALS_INT(17 * PAGE_SIZE, fileSize() - prefix, "trimmed to the pages in use");
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  TEST_DONE();
+}
+
+// a write far past the end grows the file up to that page
+void
+testGrowByWrite (void)
+{
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  int prefix;
+  testName = "Writes past the end of the file";
+
+  prefix = createFile();
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  memset(page, 5, PAGE_SIZE);
+  TEST_CHECK(writeBlock(70, &fh, page));
+  ASSERT_EQUALS_INT(71, fh.totalNumPages, "pages up to the one written");
+  TEST_CHECK(readBlock(69, &fh, page));
+  ASSERT_EQUALS_INT(0, page[0], "the pages in between are empty");
+  TEST_CHECK(closePageFile(&fh));
+  ASSERT_EQUALS_INT(71 * PAGE_SIZE, fileSize() - prefix, "file size on close");
+
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  ASSERT_EQUALS_INT(71, fh.totalNumPages, "page count after reopening");
+  TEST_CHECK(readBlock(70, &fh, page));
+  ASSERT_EQUALS_INT(5, page[PAGE_SIZE - 1], "the page written");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  TEST_DONE();
+}
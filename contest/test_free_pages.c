@@ -0,0 +1,331 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "test_helper.h"
+#include "test_pool_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// var to store the current test's name
+char *testName;
+
+#define TESTPF "test_free_pages.bin"
+
+static const SM_IOMode modes[] = { SM_IO_BUFFERED, SM_IO_MAPPED, SM_IO_DIRECT };
+
+// test and helper methods
+static int fileSize (void);
+static long fileBlocks (void);
+
+static void testFreeMap (SM_IOMode mode, int pageSize);
+static void testFileSize (void);
+static void testPoolPages (void);
+static void testTrim (SM_IOMode mode, int pageSize);
+static void testTrimPool (void);
+
+// main method
+int
+main (void)
+{
+  int m;
+
+  initStorageManager();
+  testName = "";
+
+  for (m = 0; m < 3; m++)
+    {
+      testFreeMap(modes[m], 4096);
+      testFreeMap(modes[m], 16384);
+    }
+  testFileSize();
+  testPoolPages();
+  for (m = 0; m < 3; m++)
+    {
+      testTrim(modes[m], 4096);
+      testTrim(modes[m], 16384);
+    }
+  testTrimPool();
+
+  return 0;
+}
+
+// bytes in the test file as the file system sees them
+int
+fileSize (void)
+{
+  struct stat st;
+
+  if (stat(TESTPF, &st) != 0)
+    return -1;
+  return (int) st.st_size;
+}
+
+// blocks the file system gave the test file
+long
+fileBlocks (void)
+{
+  struct stat st;
+
+  if (stat(TESTPF, &st) != 0)
+    return -1;
+  return (long) st.st_blocks;
+}
+
+// the lowest free page is handed out first, the map survives closing the file
+void
+testFreeMap (SM_IOMode mode, int pageSize)
+{
+  SM_FileHandle fh;
+  char *buf;
+  int i, p;
+  RC rc;
+  testName = "Free page map";
+
+  ASSERT_TRUE(posix_memalign((void **) &buf, SM_DIRECT_ALIGN, pageSize) == 0, "page buffer");
+  TEST_CHECK(createPageFileSize(TESTPF, pageSize));
+  TEST_CHECK(openPageFileMode(TESTPF, &fh, mode));
+  ASSERT_EQUALS_INT(0, getNumFreePages(&fh), "nothing free in a new file");
+  TEST_CHECK(allocatePage(&fh, &p));
+  ASSERT_EQUALS_INT(1, p, "a new page at the end");
+  ASSERT_EQUALS_INT(2, fh.totalNumPages, "the file grew by the page");
+
+  TEST_CHECK(ensureCapacity(100, &fh));
+  for (i = 0; i < 100; i++)
+    {
+      memset(buf, i, pageSize);
+      TEST_CHECK(writeBlock(i, &fh, buf));
+    }
+  TEST_CHECK(freePage(&fh, 30));
+  TEST_CHECK(freePage(&fh, 10));
+  TEST_CHECK(freePage(&fh, 20));
+  TEST_CHECK(freePage(&fh, 95));
+  rc = freePage(&fh, 20);
+  ASSERT_EQUALS_INT(RC_PAGE_ALREADY_FREE, rc, "page 20 freed twice");
+  rc = freePage(&fh, 100);
+  ASSERT_EQUALS_INT(RC_INVALID_PAGE_NUMBER, rc, "page 100 is not in the file");
+  ASSERT_EQUALS_INT(4, getNumFreePages(&fh), "four pages free");
+
+  TEST_CHECK(allocatePage(&fh, &p));
+  ASSERT_EQUALS_INT(10, p, "lowest free page first");
+  TEST_CHECK(allocatePage(&fh, &p));
+  ASSERT_EQUALS_INT(20, p, "then the next one");
+  TEST_CHECK(freePage(&fh, 5));
+  TEST_CHECK(allocatePage(&fh, &p));
+  ASSERT_EQUALS_INT(5, p, "a page freed later but lower comes first");
+  TEST_CHECK(freePage(&fh, 7));
+  TEST_CHECK(closePageFile(&fh));
+
+  TEST_CHECK(openPageFileMode(TESTPF, &fh, mode));
+  ASSERT_EQUALS_INT(100, fh.totalNumPages, "freeing does not shrink the file");
+  ASSERT_EQUALS_INT(3, getNumFreePages(&fh), "the map was kept in the file");
+  TEST_CHECK(readBlock(99, &fh, buf));
+  ASSERT_EQUALS_INT(99, buf[pageSize - 1], "the map does not overlap the pages");
+  TEST_CHECK(readBlock(0, &fh, buf));
+  ASSERT_EQUALS_INT(0, buf[0], "nor does it overlap page 0");
+
+  TEST_CHECK(allocatePage(&fh, &p));
+  ASSERT_EQUALS_INT(7, p, "free page 7 after reopening");
+  TEST_CHECK(allocatePage(&fh, &p));
+  ASSERT_EQUALS_INT(30, p, "free page 30 after reopening");
+  TEST_CHECK(allocatePage(&fh, &p));
+  ASSERT_EQUALS_INT(95, p, "free page 95 after reopening");
+  TEST_CHECK(allocatePage(&fh, &p));
+  ASSERT_EQUALS_INT(100, p, "none free, a new page at the end");
+  ASSERT_EQUALS_INT(0, getNumFreePages(&fh), "nothing free");
+  TEST_CHECK(closePageFile(&fh));
+
+  TEST_CHECK(openPageFileMode(TESTPF, &fh, mode));
+  ASSERT_EQUALS_INT(0, getNumFreePages(&fh), "nothing free after reopening");
+  ASSERT_EQUALS_INT(101, fh.totalNumPages, "the new page was kept");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  free(buf);
+  TEST_DONE();
+}
+
+// reusing free pages keeps the file at its size, only allocations past them grow it
+void
+testFileSize (void)
+{
+  SM_FileHandle fh;
+  int size, i, p;
+  testName = "File size with page reuse";
+
+  createPages(TESTPF, 50);
+  size = fileSize();
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  for (i = 10; i < 20; i++)
+    TEST_CHECK(freePage(&fh, i));
+  for (i = 0; i < 10; i++)
+    TEST_CHECK(allocatePage(&fh, &p));
+  ASSERT_EQUALS_INT(19, p, "the freed pages were handed out");
+  TEST_CHECK(closePageFile(&fh));
+  ASSERT_EQUALS_INT(size, fileSize(), "reused pages do not grow the file");
+
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  TEST_CHECK(allocatePage(&fh, &p));
+  TEST_CHECK(allocatePage(&fh, &p));
+  ASSERT_EQUALS_INT(51, p, "none free, the file grows");
+  TEST_CHECK(closePageFile(&fh));
+  ASSERT_EQUALS_INT(size + 2 * PAGE_SIZE, fileSize(), "two pages more");
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  TEST_DONE();
+}
+
+// a page freed through the pool leaves its frame without a write-back
+void
+testPoolPages (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  PageNumber p;
+  int size;
+  RC rc;
+  testName = "Allocating and freeing pages through the pool";
+
+  createPages(TESTPF, 10);
+  size = fileSize();
+  TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU, NULL));
+
+  TEST_CHECK(pinPage(bm, h, 4));
+  memset(h->data, 99, PAGE_SIZE);
+  TEST_CHECK(markDirty(bm, h));
+  rc = freePoolPage(bm, 4);
+  ASSERT_EQUALS_INT(RC_PAGE_PINNED, rc, "a pinned page cannot be freed");
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(freePoolPage(bm, 4));
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "the dirty frame was dropped, not written");
+
+  TEST_CHECK(allocatePoolPage(bm, &p));
+  ASSERT_EQUALS_INT(4, p, "the freed page is reused");
+  TEST_CHECK(pinPage(bm, h, p));
+  ASSERT_EQUALS_INT(4, h->data[0], "the reused page is read from the file, with its old content");
+  ASSERT_EQUALS_INT(2, getNumReadIO(bm), "page 4 read again");
+  TEST_CHECK(unpinPage(bm, h));
+
+  TEST_CHECK(allocatePoolPage(bm, &p));
+  ASSERT_EQUALS_INT(10, p, "none free, a new page at the end");
+  TEST_CHECK(pinPage(bm, h, p));
+  h->data[0] = 10;
+  TEST_CHECK(markDirty(bm, h));
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(shutdownBufferPool(bm));
+  ASSERT_EQUALS_INT(size + PAGE_SIZE, fileSize(), "the file grew by the new page only");
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// free pages at the end are cut off, free pages inside the file become holes
+void
+testTrim (SM_IOMode mode, int pageSize)
+{
+  SM_FileHandle fh;
+  char *buf;
+  int prefix, i, p, zeros;
+  long blocks;
+  testName = "Trimming free pages";
+
+  ASSERT_TRUE(posix_memalign((void **) &buf, SM_DIRECT_ALIGN, pageSize) == 0, "page buffer");
+  TEST_CHECK(createPageFileSize(TESTPF, pageSize));
+  prefix = fileSize() - pageSize;
+  TEST_CHECK(openPageFileMode(TESTPF, &fh, mode));
+  TEST_CHECK(ensureCapacity(200, &fh));
+  for (i = 0; i < 200; i++)
+    {
+      memset(buf, i + 1, pageSize);
+      TEST_CHECK(writeBlock(i, &fh, buf));
+    }
+  for (i = 150; i < 200; i++)
+    TEST_CHECK(freePage(&fh, i));
+  for (i = 40; i < 80; i++)
+    TEST_CHECK(freePage(&fh, i));
+
+  blocks = fileBlocks();
+  TEST_CHECK(trimPageFile(&fh));
+  ASSERT_EQUALS_INT(150, fh.totalNumPages, "the free pages at the end are gone");
+  ASSERT_EQUALS_INT(40, getNumFreePages(&fh), "the free pages inside stay free");
+  ASSERT_EQUALS_INT(prefix + 150 * pageSize, fileSize(), "the file truncated behind page 149");
+  ASSERT_TRUE(fileBlocks() < blocks, "the file holds fewer blocks");
+
+  TEST_CHECK(readBlock(50, &fh, buf));
+  zeros = 0;
+  for (i = 0; i < pageSize; i++)
+    zeros += buf[i] == 0;
+  ASSERT_EQUALS_INT(pageSize, zeros, "a punched page reads back as zeros");
+  TEST_CHECK(readBlock(149, &fh, buf));
+  ASSERT_EQUALS_INT(150, (unsigned char) buf[0], "the last page in use is kept");
+  TEST_CHECK(allocatePage(&fh, &p));
+  ASSERT_EQUALS_INT(40, p, "punched pages can be reused");
+  TEST_CHECK(closePageFile(&fh));
+
+  TEST_CHECK(openPageFileMode(TESTPF, &fh, mode));
+  ASSERT_EQUALS_INT(150, fh.totalNumPages, "page count after reopening");
+  ASSERT_EQUALS_INT(39, getNumFreePages(&fh), "free pages after reopening");
+
+  // with everything behind page 40 free, the file ends there
+  for (i = 1; i < 150; i++)
+    if (i < 40 || i >= 80)
+      TEST_CHECK(freePage(&fh, i));
+  TEST_CHECK(trimPageFile(&fh));
+  ASSERT_EQUALS_INT(41, fh.totalNumPages, "trimmed down to page 40");
+  ASSERT_EQUALS_INT(39, getNumFreePages(&fh), "pages 1 to 39 free");
+  TEST_CHECK(closePageFile(&fh));
+  ASSERT_EQUALS_INT(prefix + 41 * pageSize, fileSize(), "file size on close");
+
+  TEST_CHECK(openPageFileMode(TESTPF, &fh, mode));
+  ASSERT_EQUALS_INT(41, fh.totalNumPages, "page count after reopening");
+  TEST_CHECK(allocatePage(&fh, &p));
+  ASSERT_EQUALS_INT(1, p, "lowest free page");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  free(buf);
+  TEST_DONE();
+}
+
+// trimPoolFile writes the pool back before it trims
+void
+testTrimPool (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  int prefix, i;
+  testName = "Trimming the file of a pool";
+
+  createPages(TESTPF, 100);
+  prefix = fileSize() - 100 * PAGE_SIZE;
+  TEST_CHECK(initBufferPool(bm, TESTPF, 10, RS_LRU, NULL));
+  for (i = 0; i < 5; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      h->data[1] = 77;
+      TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  for (i = 50; i < 100; i++)
+    TEST_CHECK(freePoolPage(bm, i));
+  TEST_CHECK(trimPoolFile(bm));
+  ASSERT_EQUALS_INT(5, getNumWriteIO(bm), "dirty pages flushed by the trim");
+  ASSERT_EQUALS_INT(prefix + 50 * PAGE_SIZE, fileSize(), "the file truncated behind page 49");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  ASSERT_EQUALS_INT(50, fh.totalNumPages, "page count after the trim");
+  TEST_CHECK(readBlock(4, &fh, page));
+  ASSERT_EQUALS_INT(77, page[1], "the flushed change is in the file");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
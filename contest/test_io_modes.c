@@ -0,0 +1,295 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// var to store the current test's name
+char *testName;
+
+#define TESTPF "test_io_modes.bin"
+#define NUM_PAGES 50
+
+static const SM_IOMode modes[] = { SM_IO_BUFFERED, SM_IO_MAPPED, SM_IO_DIRECT };
+static const char *modeNames[] = { "buffered", "mapped", "direct" };
+
+// test and helper methods
+static void fillPage (char *page, int pageNum, int mark);
+static int checkPage (char *page, int pageNum, int mark);
+static void *directWorker (void *arg);
+
+static void testWriteAndReadBack (void);
+static void testDirectBuffers (void);
+static void testDirectThreads (void);
+static void testMappedPointer (void);
+static void testPoolModes (void);
+
+// main method
+int
+main (void)
+{
+  initStorageManager();
+  testName = "";
+
+  testWriteAndReadBack();
+  testDirectBuffers();
+  testDirectThreads();
+  testMappedPointer();
+  testPoolModes();
+
+  return 0;
+}
+
+// the whole page carries its number and a mark, so a short or misplaced transfer shows.
+// Pages may sit at any address, the ints are copied in and out
+void
+fillPage (char *page, int pageNum, int mark)
+{
+  int i, v = pageNum * 1000 + mark;
+
+  for (i = 0; i < PAGE_SIZE / (int) sizeof(int); i++)
+    memcpy(page + i * sizeof(int), &v, sizeof(int));
+}
+
+int
+checkPage (char *page, int pageNum, int mark)
+{
+  int i, v;
+
+  for (i = 0; i < PAGE_SIZE / (int) sizeof(int); i++)
+    {
+      memcpy(&v, page + i * sizeof(int), sizeof(int));
+      if (v != pageNum * 1000 + mark)
+	return 0;
+    }
+  return 1;
+}
+
+// pages written in one mode read back the same in every mode
+void
+testWriteAndReadBack (void)
+{
+  SM_FileHandle fh;
+  char *page;
+  int w, r, i, good;
+  testName = "Pages written in one I/O mode, read in all of them";
+
+  page = malloc(PAGE_SIZE);
+  for (w = 0; w < 3; w++)
+    {
+      TEST_CHECK(createPageFile(TESTPF));
+      TEST_CHECK(openPageFileMode(TESTPF, &fh, modes[w]));
+      ASSERT_EQUALS_INT(modes[w], getPageFileMode(&fh), modeNames[w]);
+      TEST_CHECK(ensureCapacity(NUM_PAGES, &fh));
+      for (i = 0; i < NUM_PAGES; i++)
+	{
+	  fillPage(page, i, w);
+	  TEST_CHECK(writeBlock(i, &fh, page));
+	}
+      TEST_CHECK(closePageFile(&fh));
+
+      for (r = 0; r < 3; r++)
+	{
+	  TEST_CHECK(openPageFileMode(TESTPF, &fh, modes[r]));
+	  ASSERT_EQUALS_INT(NUM_PAGES, fh.totalNumPages, "page count kept");
+	  good = 0;
+	  TEST_CHECK(readFirstBlock(&fh, page));
+	  good += checkPage(page, 0, w);
+	  for (i = 1; i < NUM_PAGES; i++)
+	    {
+	      TEST_CHECK(readNextBlock(&fh, page));
+	      good += checkPage(page, i, w);
+	    }
+	  ASSERT_EQUALS_INT(NUM_PAGES, good, modeNames[r]);
+	  ASSERT_ERROR(readNextBlock(&fh, page), "no page past the last one");
+	  TEST_CHECK(closePageFile(&fh));
+	}
+      TEST_CHECK(destroyPageFile(TESTPF));
+    }
+  free(page);
+  TEST_DONE();
+}
+
+// O_DIRECT takes aligned buffers as they are and copies through its own arena for the rest
+void
+testDirectBuffers (void)
+{
+  SM_FileHandle fh;
+  char *aligned, *unaligned, *raw;
+  int i, good;
+  testName = "O_DIRECT with aligned and unaligned buffers";
+
+  ASSERT_TRUE(posix_memalign((void **) &aligned, SM_DIRECT_ALIGN, PAGE_SIZE) == 0, "aligned buffer");
+  raw = malloc(PAGE_SIZE + 1);
+  unaligned = raw + 1;
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(openPageFileMode(TESTPF, &fh, SM_IO_DIRECT));
+  for (i = 0; i < 20; i++)
+    {
+      fillPage(i % 2 ? aligned : unaligned, i, 7);
+      TEST_CHECK(writeBlock(i, &fh, i % 2 ? aligned : unaligned));
+    }
+  ASSERT_EQUALS_INT(20, fh.totalNumPages, "writes past the end grow the file");
+
+  good = 0;
+  for (i = 0; i < 20; i++)
+    {
+      memset(aligned, 0, PAGE_SIZE);
+      memset(unaligned, 0, PAGE_SIZE);
+      TEST_CHECK(readBlock(i, &fh, i % 2 ? unaligned : aligned));
+      good += checkPage(i % 2 ? unaligned : aligned, i, 7);
+    }
+  ASSERT_EQUALS_INT(20, good, "pages read back into the other kind of buffer");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  free(aligned);
+  free(raw);
+  TEST_DONE();
+}
+
+// the handle the direct workers share
+static SM_FileHandle sharedHandle;
+
+// writes and reads back its own pages through an unaligned buffer, returns how many came back wrong
+void *
+directWorker (void *arg)
+{
+  int t = (int) (long) arg;
+  char *raw = malloc(PAGE_SIZE + 1);
+  long wrong = 0;
+  int i, p;
+
+  for (i = 0; i < 200; i++)
+    {
+      p = t * 10 + i % 10;
+      fillPage(raw + 1, p, i);
+      TEST_CHECK(writeBlock(p, &sharedHandle, raw + 1));
+      memset(raw + 1, 0, PAGE_SIZE);
+      TEST_CHECK(readBlock(p, &sharedHandle, raw + 1));
+      if (!checkPage(raw + 1, p, i))
+	wrong++;
+    }
+  free(raw);
+  return (void *) wrong;
+}
+
+// threads sharing a direct handle each get their own data through the bounce page
+void
+testDirectThreads (void)
+{
+  pthread_t threads[4];
+  void *wrong;
+  int i, wrongPages;
+  testName = "O_DIRECT unaligned transfers from several threads";
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(openPageFileMode(TESTPF, &sharedHandle, SM_IO_DIRECT));
+  TEST_CHECK(ensureCapacity(40, &sharedHandle));
+  for (i = 0; i < 4; i++)
+    pthread_create(&threads[i], NULL, directWorker, (void *) (long) i);
+  wrongPages = 0;
+  for (i = 0; i < 4; i++)
+    {
+      pthread_join(threads[i], &wrong);
+      wrongPages += (int) (long) wrong;
+    }
+  ASSERT_EQUALS_INT(0, wrongPages, "no transfer saw another thread's page");
+  TEST_CHECK(closePageFile(&sharedHandle));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  TEST_DONE();
+}
+
+// a mapped file hands out pointers into the mapping, writes through them reach the file
+void
+testMappedPointer (void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ptr;
+  char page[PAGE_SIZE];
+  int i;
+  testName = "Pointers into a mapped page file";
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(openPageFileMapped(TESTPF, &fh));
+  for (i = 0; i < 10; i++)
+    {
+      fillPage(page, i, 1);
+      TEST_CHECK(writeBlock(i, &fh, page));
+    }
+  TEST_CHECK(getBlockPointer(7, &fh, &ptr));
+  ASSERT_TRUE(checkPage(ptr, 7, 1), "the mapping holds what writeBlock wrote");
+  fillPage(ptr, 7, 2);
+  ASSERT_ERROR(getBlockPointer(10, &fh, &ptr), "no pointer past the last page");
+  TEST_CHECK(closePageFile(&fh));
+
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  TEST_CHECK(readBlock(7, &fh, page));
+  ASSERT_TRUE(checkPage(page, 7, 2), "the write through the pointer is in the file");
+  ASSERT_ERROR(getBlockPointer(7, &fh, &ptr), "buffered files have no mapping");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  TEST_DONE();
+}
+
+// the pool reads and writes the same pages whatever mode its file is opened in
+void
+testPoolModes (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  int m, i, good;
+  testName = "Buffer pool in every I/O mode";
+
+  for (m = 0; m < 3; m++)
+    {
+      TEST_CHECK(createPageFile(TESTPF));
+      TEST_CHECK(openPageFile(TESTPF, &fh));
+      for (i = 0; i < NUM_PAGES; i++)
+	{
+	  fillPage(page, i, 0);
+	  TEST_CHECK(writeBlock(i, &fh, page));
+	}
+      TEST_CHECK(closePageFile(&fh));
+
+      TEST_CHECK(initBufferPoolMode(bm, TESTPF, 3, RS_LRU, NULL, modes[m]));
+      good = 0;
+      for (i = 0; i < 20; i++)
+	{
+	  TEST_CHECK(pinPage(bm, h, i));
+	  good += checkPage(h->data, i, 0);
+	  fillPage(h->data, i, 5);
+	  TEST_CHECK(markDirty(bm, h));
+	  TEST_CHECK(unpinPage(bm, h));
+	}
+      ASSERT_EQUALS_INT(20, good, modeNames[m]);
+      ASSERT_EQUALS_INT(20, getNumReadIO(bm), "one read per page");
+      ASSERT_EQUALS_INT(17, getNumWriteIO(bm), "dirty victims written back");
+      TEST_CHECK(forceFlushPool(bm));
+      ASSERT_EQUALS_INT(20, getNumWriteIO(bm), "the rest written by the flush");
+      TEST_CHECK(shutdownBufferPool(bm));
+
+      TEST_CHECK(openPageFile(TESTPF, &fh));
+      good = 0;
+      for (i = 0; i < NUM_PAGES; i++)
+	{
+	  TEST_CHECK(readBlock(i, &fh, page));
+	  good += checkPage(page, i, i < 20 ? 5 : 0);
+	}
+      ASSERT_EQUALS_INT(NUM_PAGES, good, "the pool's writes are in the file");
+      TEST_CHECK(closePageFile(&fh));
+      TEST_CHECK(destroyPageFile(TESTPF));
+    }
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
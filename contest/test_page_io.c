@@ -0,0 +1,342 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// var to store the current test's name
+char *testName;
+
+#define TESTPF "test_page_io.bin"
+
+// test and helper methods
+static long fileSize (void);
+
+static void testRoundTrip (void);
+static void testPositions (void);
+static void testTwoHandles (void);
+static void testErrors (void);
+static void testMapped (void);
+static void testMappedGrowth (void);
+static void testMappedPool (void);
+
+// main method
+int
+main (void)
+{
+  initStorageManager();
+  testName = "";
+
+  testRoundTrip();
+  testPositions();
+  testTwoHandles();
+  testErrors();
+  testMapped();
+  testMappedGrowth();
+  testMappedPool();
+
+  return 0;
+}
+
+// size of the test file in bytes
+long
+fileSize (void)
+{
+  struct stat st;
+
+  if (stat(TESTPF, &st) != 0)
+    return -1;
+  return (long) st.st_size;
+}
+
+// pages written at their offsets read back in any order, also after reopening the file
+void
+testRoundTrip (void)
+{
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  long empty;
+  int i, p, good;
+  testName = "Page round trip";
+
+  // a new file holds its header and one page, every further page adds PAGE_SIZE bytes
+  TEST_CHECK(createPageFile(TESTPF));
+  empty = fileSize();
+  ASSERT_TRUE(empty >= PAGE_SIZE, "a new file holds one page");
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  ASSERT_EQUALS_INT(1, fh.totalNumPages, "one page");
+  TEST_CHECK(readBlock(0, &fh, page));
+  ASSERT_TRUE(page[0] == 0 && page[PAGE_SIZE - 1] == 0, "the first page is empty");
+
+  // writing past the end grows the file
+  for (i = 19; i >= 0; i--)
+    {
+      memset(page, i, PAGE_SIZE);
+      TEST_CHECK(writeBlock(i, &fh, page));
+    }
+  ASSERT_EQUALS_INT(20, fh.totalNumPages, "20 pages written");
+  TEST_CHECK(closePageFile(&fh));
+  ASSERT_TRUE(fileSize() == empty + 19 * PAGE_SIZE, "and in the file once closed");
+
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  ASSERT_EQUALS_INT(20, fh.totalNumPages, "page count from the file header");
+  good = 0;
+  for (i = 0; i < 20; i++)
+    {
+      p = (i * 7) % 20;
+      TEST_CHECK(readBlock(p, &fh, page));
+      good += page[0] == p && page[PAGE_SIZE / 2] == p && page[PAGE_SIZE - 1] == p;
+    }
+  ASSERT_EQUALS_INT(20, good, "every page read back whole");
+
+  // pages added by ensureCapacity and appendEmptyBlock read as zeros
+  TEST_CHECK(ensureCapacity(30, &fh));
+  ASSERT_EQUALS_INT(30, fh.totalNumPages, "capacity of 30 pages");
+  TEST_CHECK(ensureCapacity(10, &fh));
+  ASSERT_EQUALS_INT(30, fh.totalNumPages, "a file is never shrunk");
+  TEST_CHECK(appendEmptyBlock(&fh));
+  ASSERT_EQUALS_INT(31, fh.totalNumPages, "one page appended");
+  TEST_CHECK(readBlock(25, &fh, page));
+  ASSERT_TRUE(page[0] == 0 && page[PAGE_SIZE - 1] == 0, "page 25 is empty");
+  TEST_CHECK(readBlock(30, &fh, page));
+  ASSERT_TRUE(page[0] == 0 && page[PAGE_SIZE - 1] == 0, "the appended page is empty");
+  TEST_CHECK(closePageFile(&fh));
+  ASSERT_TRUE(fileSize() == empty + 30 * PAGE_SIZE, "31 pages in the file");
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  TEST_DONE();
+}
+
+// the relative reads move the position of the handle
+void
+testPositions (void)
+{
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  int i;
+  RC rc;
+  testName = "Positions of the handle";
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  for (i = 0; i < 5; i++)
+    {
+      memset(page, i, PAGE_SIZE);
+      TEST_CHECK(writeBlock(i, &fh, page));
+    }
+
+  TEST_CHECK(readFirstBlock(&fh, page));
+  ASSERT_TRUE(page[0] == 0 && getBlockPos(&fh) == 0, "first page");
+  TEST_CHECK(readNextBlock(&fh, page));
+  ASSERT_TRUE(page[0] == 1 && getBlockPos(&fh) == 1, "next page");
+  TEST_CHECK(readLastBlock(&fh, page));
+  ASSERT_TRUE(page[0] == 4 && getBlockPos(&fh) == 4, "last page");
+  TEST_CHECK(readPreviousBlock(&fh, page));
+  ASSERT_TRUE(page[0] == 3 && getBlockPos(&fh) == 3, "previous page");
+  TEST_CHECK(readCurrentBlock(&fh, page));
+  ASSERT_TRUE(page[0] == 3 && getBlockPos(&fh) == 3, "current page");
+
+  memset(page, 9, PAGE_SIZE);
+  TEST_CHECK(writeCurrentBlock(&fh, page));
+  TEST_CHECK(readBlock(3, &fh, page));
+  ASSERT_EQUALS_INT(9, page[0], "the current page was written");
+  TEST_CHECK(readLastBlock(&fh, page));
+  rc = readNextBlock(&fh, page);
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, rc, "no page after the last one");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  TEST_DONE();
+}
+
+// two handles on one file: what one writes the other reads at once, nothing is buffered
+void
+testTwoHandles (void)
+{
+  SM_FileHandle fh1, fh2;
+  char page[PAGE_SIZE];
+  testName = "Two handles on one file";
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(openPageFile(TESTPF, &fh1));
+  TEST_CHECK(ensureCapacity(4, &fh1));
+  TEST_CHECK(openPageFile(TESTPF, &fh2));
+  ASSERT_EQUALS_INT(4, fh2.totalNumPages, "the second handle sees 4 pages");
+
+  memset(page, 5, PAGE_SIZE);
+  TEST_CHECK(writeBlock(2, &fh1, page));
+  memset(page, 0, PAGE_SIZE);
+  TEST_CHECK(readBlock(2, &fh2, page));
+  ASSERT_EQUALS_INT(5, page[PAGE_SIZE - 1], "written through one handle, read through the other");
+
+  TEST_CHECK(closePageFile(&fh1));
+  TEST_CHECK(readBlock(2, &fh2, page));
+  ASSERT_EQUALS_INT(5, page[0], "closing one handle leaves the other open");
+  TEST_CHECK(closePageFile(&fh2));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  TEST_DONE();
+}
+
+// the error codes of files and handles
+void
+testErrors (void)
+{
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  RC rc;
+  testName = "Errors of the storage manager";
+
+  rc = openPageFile(TESTPF, &fh);
+  ASSERT_EQUALS_INT(RC_FILE_NOT_FOUND, rc, "no such file");
+  rc = destroyPageFile(TESTPF);
+  ASSERT_EQUALS_INT(RC_FILE_NOT_FOUND, rc, "nothing to destroy");
+
+  TEST_CHECK(createPageFile(TESTPF));
+  rc = createPageFile(TESTPF);
+  ASSERT_EQUALS_INT(RC_FILE_PRESENT, rc, "created only once");
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  rc = readBlock(1, &fh, page);
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, rc, "page 1 does not exist");
+  rc = readBlock(-1, &fh, page);
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, rc, "nor does page -1");
+  rc = writeBlock(-1, &fh, page);
+  ASSERT_EQUALS_INT(RC_INVALID_PAGE_NUMBER, rc, "page -1 cannot be written");
+  TEST_CHECK(closePageFile(&fh));
+  rc = readBlock(0, &fh, page);
+  ASSERT_EQUALS_INT(RC_FILE_HANDLE_NOT_INIT, rc, "a closed handle");
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  TEST_DONE();
+}
+
+// a mapped file: stores through getBlockPointer and writeBlock are the same bytes of the file
+void
+testMapped (void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ptr;
+  char page[PAGE_SIZE];
+  RC rc;
+  testName = "Pointers into a mapped file";
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(openPageFileMapped(TESTPF, &fh));
+  TEST_CHECK(ensureCapacity(8, &fh));
+  memset(page, 3, PAGE_SIZE);
+  TEST_CHECK(writeBlock(3, &fh, page));
+  TEST_CHECK(getBlockPointer(3, &fh, &ptr));
+  ASSERT_TRUE(ptr[0] == 3 && ptr[PAGE_SIZE - 1] == 3, "a written page seen through its pointer");
+
+  memset(ptr, 4, PAGE_SIZE);
+  TEST_CHECK(readBlock(3, &fh, page));
+  ASSERT_TRUE(page[0] == 4 && page[PAGE_SIZE - 1] == 4, "a store through the pointer seen by readBlock");
+  rc = getBlockPointer(8, &fh, &ptr);
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, rc, "no pointer past the end");
+  TEST_CHECK(closePageFile(&fh));
+
+  // the stores reached the file
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  ASSERT_EQUALS_INT(8, fh.totalNumPages, "8 pages in the file");
+  TEST_CHECK(readBlock(3, &fh, page));
+  ASSERT_EQUALS_INT(4, page[PAGE_SIZE / 2], "the store is in the file");
+  rc = getBlockPointer(3, &fh, &ptr);
+  ASSERT_ERROR(rc, "no pointers into a file that is not mapped");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  TEST_DONE();
+}
+
+// growing the file remaps it, pointers are taken again and the pages keep their content
+void
+testMappedGrowth (void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ptr;
+  char page[PAGE_SIZE];
+  int i, good;
+  testName = "Growing a mapped file";
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(openPageFileMapped(TESTPF, &fh));
+  TEST_CHECK(getBlockPointer(0, &fh, &ptr));
+  memset(ptr, 1, PAGE_SIZE);
+
+  // from one page to 2000, by appending, by ensureCapacity and by writing past the end
+  for (i = 1; i < 500; i++)
+    TEST_CHECK(appendEmptyBlock(&fh));
+  TEST_CHECK(ensureCapacity(1500, &fh));
+  memset(page, 7, PAGE_SIZE);
+  TEST_CHECK(writeBlock(1999, &fh, page));
+  ASSERT_EQUALS_INT(2000, fh.totalNumPages, "2000 pages");
+
+  good = 0;
+  for (i = 0; i < 2000; i++)
+    {
+      TEST_CHECK(getBlockPointer(i, &fh, &ptr));
+      if (i == 0)
+	good += ptr[0] == 1 && ptr[PAGE_SIZE - 1] == 1;
+      else if (i == 1999)
+	good += ptr[0] == 7 && ptr[PAGE_SIZE - 1] == 7;
+      else
+	good += ptr[0] == 0 && ptr[PAGE_SIZE - 1] == 0;
+      ptr[1] = (char) i;
+    }
+  ASSERT_EQUALS_INT(2000, good, "every page reached through the new mapping");
+  TEST_CHECK(closePageFile(&fh));
+
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  good = 0;
+  for (i = 0; i < 2000; i += 111)
+    {
+      TEST_CHECK(readBlock(i, &fh, page));
+      good += page[1] == (char) i;
+    }
+  ASSERT_EQUALS_INT(19, good, "the stores are in the file");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  TEST_DONE();
+}
+
+// a pool over a mapped file reads and writes the same pages as over a buffered one
+void
+testMappedPool (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  int i;
+  testName = "Buffer pool over a mapped file";
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(initBufferPoolMode(bm, TESTPF, 3, RS_FIFO, NULL, SM_IO_MAPPED));
+  for (i = 0; i < 10; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      h->data[0] = (char) (i + 1);
+      TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_INT(1, getNumReadIO(bm), "only page 0 was in the file");
+  ASSERT_EQUALS_INT(7, getNumWriteIO(bm), "dirty victims written back");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  ASSERT_EQUALS_INT(10, fh.totalNumPages, "the pool grew the file");
+  TEST_CHECK(readBlock(9, &fh, page));
+  ASSERT_EQUALS_INT(10, page[0], "the last page written on shutdown");
+  TEST_CHECK(readBlock(2, &fh, page));
+  ASSERT_EQUALS_INT(3, page[0], "an evicted page written back");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
@@ -0,0 +1,128 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// var to store the current test's name
+char *testName;
+
+#define TESTPF "test_page_size.bin"
+
+static const SM_IOMode modes[] = { SM_IO_BUFFERED, SM_IO_MAPPED, SM_IO_DIRECT };
+static const int sizes[] = { 4096, 8192, 16384, 65536 };
+
+// test and helper methods
+static void testPageSize (int pageSize, SM_IOMode mode);
+static void testInvalidSizes (void);
+
+// main method
+int
+main (void)
+{
+  int s, m;
+
+  initStorageManager();
+  testName = "";
+
+  for (s = 0; s < 4; s++)
+    for (m = 0; m < 3; m++)
+      testPageSize(sizes[s], modes[m]);
+  testInvalidSizes();
+
+  return 0;
+}
+
+// the size given at creation is read back from the header by every handle and by the pool
+void
+testPageSize (int pageSize, SM_IOMode mode)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  char *buf;
+  int i, good;
+  testName = "Pages of the size recorded in the file";
+
+  ASSERT_TRUE(posix_memalign((void **) &buf, SM_DIRECT_ALIGN, 8 * pageSize) == 0, "page buffers");
+
+  TEST_CHECK(createPageFileSize(TESTPF, pageSize));
+  TEST_CHECK(openPageFileMode(TESTPF, &fh, mode));
+  ASSERT_EQUALS_INT(pageSize, fh.pageSize, "page size from the header");
+  ASSERT_EQUALS_INT(1, fh.totalNumPages, "one empty page");
+
+  // each page filled with its number plus one, so a page shifted by less than a page shows
+  for (i = 0; i < 8 * pageSize; i++)
+    buf[i] = (char) (i / pageSize + 1);
+  TEST_CHECK(writeBlocks(0, 8, &fh, buf));
+  memset(buf, 0, 8 * pageSize);
+  TEST_CHECK(readBlock(5, &fh, buf));
+  ASSERT_TRUE(buf[0] == 6 && buf[pageSize - 1] == 6, "page 5 read whole");
+  TEST_CHECK(readBlocks(0, 8, &fh, buf));
+  good = 0;
+  for (i = 0; i < 8; i++)
+    good += buf[i * pageSize] == i + 1 && buf[i * pageSize + pageSize - 1] == i + 1;
+  ASSERT_EQUALS_INT(8, good, "a run of pages");
+  TEST_CHECK(closePageFile(&fh));
+
+  TEST_CHECK(initBufferPoolMode(bm, TESTPF, 3, RS_LRU, NULL, mode));
+  ASSERT_EQUALS_INT(pageSize, bm->pageSize, "the pool takes the file's page size");
+  good = 0;
+  for (i = 0; i < 20; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      if (i < 8)
+	good += h->data[pageSize - 1] == i + 1;
+      h->data[pageSize - 1] = (char) (100 + i);
+      TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_INT(8, good, "frames hold whole pages");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  ASSERT_EQUALS_INT(20, fh.totalNumPages, "pages written by the pool");
+  good = 0;
+  for (i = 0; i < 20; i++)
+    {
+      TEST_CHECK(readBlock(i, &fh, buf));
+      good += buf[pageSize - 1] == (char) (100 + i);
+    }
+  ASSERT_EQUALS_INT(20, good, "the pool wrote the last byte of every page");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  free(buf);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// sizes that are no power of two or out of range, and files without a header
+void
+testInvalidSizes (void)
+{
+  SM_FileHandle fh;
+  FILE *f;
+  RC rc;
+  testName = "Invalid page sizes and headers";
+
+  rc = createPageFileSize(TESTPF, 2048);
+  ASSERT_EQUALS_INT(RC_INVALID_PAGE_SIZE, rc, "below the minimum");
+  rc = createPageFileSize(TESTPF, 12288);
+  ASSERT_EQUALS_INT(RC_INVALID_PAGE_SIZE, rc, "no power of two");
+  rc = createPageFileSize(TESTPF, 131072);
+  ASSERT_EQUALS_INT(RC_INVALID_PAGE_SIZE, rc, "above the maximum");
+
+  f = fopen(TESTPF, "w");
+  fwrite("garbage", 1, 7, f);
+  fclose(f);
+  rc = openPageFile(TESTPF, &fh);
+  ASSERT_EQUALS_INT(RC_INVALID_PAGE_FILE, rc, "no header");
+  unlink(TESTPF);
+
+  TEST_DONE();
+}
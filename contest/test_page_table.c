@@ -0,0 +1,253 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "test_helper.h"
+#include "test_pool_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// var to store the current test's name
+char *testName;
+
+#define TESTPF "test_page_table.bin"
+
+// test methods
+static void testFIFO (void);
+static void testLRU (void);
+static void testHitsNotRead (void);
+static void testFrameArena (void);
+static void testLargePool (void);
+
+// main method
+int
+main (void)
+{
+  initStorageManager();
+  testName = "";
+
+  testFIFO();
+  testLRU();
+  testHitsNotRead();
+  testFrameArena();
+  testLargePool();
+
+  return 0;
+}
+
+// frames are handed out in order and the first page loaded goes first
+void
+testFIFO (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  int wrong;
+  testName = "FIFO victims through the page table";
+
+  createPages(TESTPF, 10);
+  TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_FIFO, NULL));
+
+  wrong = pinRange(bm, 0, 2);
+
+  ASSERT_EQUALS_INT(0, wrong, "pages read into free frames");
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0]", bm, "free frames filled in order");
+
+  TEST_CHECK(pinPage(bm, h, 1));
+  ((int *) h->data)[1] = 7;
+  TEST_CHECK(markDirty(bm, h));
+  TEST_CHECK(unpinPage(bm, h));
+  wrong = pinRange(bm, 3, 3);
+  ASSERT_EQUALS_INT(0, wrong, "page 3");
+  ASSERT_EQUALS_POOL("[3 0],[1x0],[2 0]", bm, "page 0 was loaded first");
+  wrong = pinRange(bm, 4, 4);
+  ASSERT_EQUALS_INT(0, wrong, "page 4");
+  ASSERT_EQUALS_POOL("[3 0],[4 0],[2 0]", bm, "dirty page 1 was loaded next");
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "page 1 written back on eviction");
+
+  TEST_CHECK(pinPage(bm, h, 2));
+  wrong = pinRange(bm, 5, 6);
+  ASSERT_EQUALS_INT(0, wrong, "pages 5 and 6");
+  ASSERT_EQUALS_POOL("[5 0],[6 0],[2 1]", bm, "pinned page 2 is skipped");
+  TEST_CHECK(unpinPage(bm, h));
+
+  ASSERT_EQUALS_INT(7, getNumReadIO(bm), "one read per page loaded");
+  TEST_CHECK(pinPage(bm, h, 1));
+  ASSERT_EQUALS_INT(7, ((int *) h->data)[1], "page 1 read back with the change written on eviction");
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// the page used longest ago goes first, a hit makes a page the most recent one
+void
+testLRU (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  int wrong;
+  testName = "LRU victims through the page table";
+
+  createPages(TESTPF, 10);
+  TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU, NULL));
+
+  wrong = pinRange(bm, 0, 2);
+
+  ASSERT_EQUALS_INT(0, wrong, "pages 0 to 2");
+  wrong = pinRange(bm, 0, 0);
+  ASSERT_EQUALS_INT(0, wrong, "hit on page 0");
+  wrong = pinRange(bm, 3, 3);
+  ASSERT_EQUALS_INT(0, wrong, "page 3");
+  ASSERT_EQUALS_POOL("[0 0],[3 0],[2 0]", bm, "page 1 was used longest ago");
+  wrong = pinRange(bm, 2, 2);
+  ASSERT_EQUALS_INT(0, wrong, "hit on page 2");
+  wrong = pinRange(bm, 4, 4);
+  ASSERT_EQUALS_INT(0, wrong, "page 4");
+  ASSERT_EQUALS_POOL("[4 0],[3 0],[2 0]", bm, "page 0 was used longest ago");
+  ASSERT_EQUALS_INT(5, getNumReadIO(bm), "hits are not read");
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "nothing dirty");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// a page found in the pool is handed out as it is, neither read nor written
+void
+testHitsNotRead (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  int i;
+  testName = "Hits are served from the frame";
+
+  createPages(TESTPF, 10);
+  TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_FIFO, NULL));
+
+  TEST_CHECK(pinPage(bm, h, 4));
+  ((int *) h->data)[1] = 42;
+  TEST_CHECK(markDirty(bm, h));
+  TEST_CHECK(unpinPage(bm, h));
+  for (i = 0; i < 100; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, 4));
+      if (((int *) h->data)[1] != 42)
+	break;
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_INT(100, i, "the change made in the frame is seen by every hit");
+  ASSERT_EQUALS_INT(1, getNumReadIO(bm), "page 4 read once");
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "page 4 not written while resident");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// each page has a page aligned frame of its own, kept while the page is resident
+void
+testFrameArena (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  char *frames[3];
+  int i, reads;
+  testName = "Frames of the page arena";
+
+  createPages(TESTPF, 10);
+  TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU, NULL));
+  for (i = 0; i < 3; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      frames[i] = h->data;
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_TRUE((uintptr_t) frames[0] % PAGE_SIZE == 0 && (uintptr_t) frames[2] % PAGE_SIZE == 0, "frames are page aligned");
+  ASSERT_TRUE(frames[0] != frames[1] && frames[1] != frames[2] && frames[0] != frames[2], "three pages in three frames");
+
+  reads = getNumReadIO(bm);
+  TEST_CHECK(pinPage(bm, h, 1));
+  ASSERT_TRUE(h->data == frames[1], "a hit hands out the frame the page is in");
+  TEST_CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "without reading the page");
+
+  // page 0 was used longest ago, page 5 is read into its frame
+  TEST_CHECK(pinPage(bm, h, 5));
+  ASSERT_TRUE(h->data == frames[0], "a miss reuses the frame of the victim");
+  ASSERT_EQUALS_INT(5, *(int *) h->data, "page 5 read into it");
+  TEST_CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_INT(reads + 1, getNumReadIO(bm), "one read for the miss");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// a large pool: every page is found again where the page table says it is
+void
+testLargePool (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  PageNumber *frames;
+  char *seen;
+  int i, reads, resident, duplicates, wrong;
+  testName = "Page table of a large pool";
+
+  createPages(TESTPF, 3000);
+  TEST_CHECK(initBufferPool(bm, TESTPF, 2000, RS_LRU, NULL));
+
+  wrong = pinRange(bm, 0, 2999);
+
+  ASSERT_EQUALS_INT(0, wrong, "3000 pages through 2000 frames");
+  ASSERT_EQUALS_INT(3000, getNumReadIO(bm), "every page read once");
+
+  // each resident page is in one frame only, and pinning it reads nothing
+  frames = getFrameContents(bm);
+  seen = calloc(3000, 1);
+  resident = duplicates = 0;
+  for (i = 0; i < bm->numPages; i++)
+    if (frames[i] != NO_PAGE)
+      {
+	duplicates += seen[frames[i]];
+	seen[frames[i]] = 1;
+	resident++;
+      }
+  ASSERT_EQUALS_INT(2000, resident, "all frames in use");
+  ASSERT_EQUALS_INT(0, duplicates, "no page in two frames");
+
+  reads = getNumReadIO(bm);
+  wrong = 0;
+  for (i = 0; i < 3000; i++)
+    if (seen[i])
+      wrong += pinRange(bm, i, i);
+  ASSERT_EQUALS_INT(0, wrong, "resident pages hold their data");
+  ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "resident pages are hits");
+
+  // and the pages that were evicted come back from the file
+  reads = getNumReadIO(bm);
+  wrong = 0;
+  for (i = 0; i < 3000; i++)
+    if (!seen[i])
+      wrong += pinRange(bm, i, i);
+  ASSERT_EQUALS_INT(0, wrong, "evicted pages hold their data");
+  ASSERT_EQUALS_INT(reads + 1000, getNumReadIO(bm), "evicted pages are read again");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  free(frames);
+  free(seen);
+  free(bm);
+  TEST_DONE();
+}
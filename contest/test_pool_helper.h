@@ -0,0 +1,69 @@
+#ifndef TEST_POOL_HELPER_H
+#define TEST_POOL_HELPER_H
+
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "test_helper.h"
+
+// check whether two the content of a buffer pool is the same as an expected content
+// (given in the format produced by sprintPoolContent)
+#define ASSERT_EQUALS_POOL(expected,bm,message)			\
+  do {									\
+    char *real;								\
+    real = sprintPoolContent(bm);					\
+    if (strcmp((expected),real) != 0)					\
+      {									\
+	printf("[%s-%s-L%i-%s] FAILED: expected <%s> but was <%s>: %s\n",TEST_INFO, expected, real, message); \
+	free(real);							\
+	exit(1);							\
+      }									\
+    printf("[%s-%s-L%i-%s] OK: expected <%s> and was <%s>: %s\n",TEST_INFO, expected, real, message); \
+    free(real);								\
+  } while(0)
+
+// create a page file of num pages, page i holding i in its first int
+static void
+createPages (char *fileName, int num)
+{
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  int i;
+
+  TEST_CHECK(createPageFile(fileName));
+  TEST_CHECK(openPageFile(fileName, &fh));
+  for (i = 0; i < num; i++)
+    {
+      memset(page, 0, PAGE_SIZE);
+      memcpy(page, &i, sizeof(int));
+      TEST_CHECK(writeBlock(i, &fh, page));
+    }
+  TEST_CHECK(closePageFile(&fh));
+}
+
+// pin and unpin pages first to last through a ring (NULL for none), returns how many of them
+// held the wrong data
+static int
+pinRangeRing (BM_BufferPool *bm, int first, int last, BM_Ring *ring)
+{
+  BM_PageHandle h;
+  int i, wrong = 0;
+
+  for (i = first; i <= last; i++)
+    {
+      TEST_CHECK(pinPageRing(bm, &h, i, ring));
+      if (h.pageNum != i || *(int *) h.data != i)
+	wrong++;
+      TEST_CHECK(unpinPage(bm, &h));
+    }
+  return wrong;
+}
+
+// pin and unpin pages first to last, returns how many of them held the wrong data
+static int
+pinRange (BM_BufferPool *bm, int first, int last)
+{
+  return pinRangeRing(bm, first, last, NULL);
+}
+
+#endif // TEST_POOL_HELPER_H
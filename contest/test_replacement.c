@@ -0,0 +1,606 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "test_helper.h"
+#include "test_pool_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// var to store the current test's name
+char *testName;
+
+#define TESTPF "test_replacement.bin"
+#define NUM_PAGES 3000
+
+// test and helper methods
+
+static void testClockSecondChance (void);
+static void testClockPinnedAndDirty (void);
+static void testGClockHotPage (void);
+static void testLFUCounts (void);
+static void testLFUAging (void);
+static void testLRUKVictims (void);
+static void testLRUKScans (void);
+static void testARCVictims (void);
+static void testARCWorkloads (void);
+static int hotSetAndScans (BM_BufferPool *bm, int frames, int rounds);
+static void testAdaptiveSwitch (void);
+static void testAdaptiveLoop (void);
+
+// main method
+int
+main (void)
+{
+  initStorageManager();
+  testName = "";
+
+  createPages(TESTPF, NUM_PAGES);
+  testClockSecondChance();
+  testClockPinnedAndDirty();
+  testGClockHotPage();
+  testLFUCounts();
+  testLFUAging();
+  testLRUKVictims();
+  testLRUKScans();
+  testARCVictims();
+  testARCWorkloads();
+  testAdaptiveSwitch();
+  testAdaptiveLoop();
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  return 0;
+}
+
+// the hand clears reference bits as it passes and takes the first frame without one
+void
+testClockSecondChance (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  int wrong;
+  testName = "CLOCK second chance";
+
+  TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_CLOCK, NULL));
+  wrong = pinRange(bm, 0, 2);
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0]", bm, "free frames filled in order");
+
+  // every frame is referenced: a full turn clears them, then frame 0 goes
+  wrong += pinRange(bm, 3, 3);
+  ASSERT_EQUALS_POOL("[3 0],[1 0],[2 0]", bm, "page 0 after a full turn");
+
+  // page 1 is referenced again and kept, page 2 is not
+  wrong += pinRange(bm, 1, 1);
+  wrong += pinRange(bm, 4, 4);
+  ASSERT_EQUALS_POOL("[3 0],[1 0],[4 0]", bm, "page 1 got its second chance");
+  ASSERT_EQUALS_INT(5, getNumReadIO(bm), "one read per page loaded");
+
+  wrong += pinRange(bm, 1, 1);
+  ASSERT_EQUALS_INT(5, getNumReadIO(bm), "page 1 still resident");
+  wrong += pinRange(bm, 2, 2);
+  ASSERT_EQUALS_INT(6, getNumReadIO(bm), "page 2 read again");
+  ASSERT_EQUALS_INT(0, wrong, "pages hold their data");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// pinned frames are passed over, a dirty victim is written back
+void
+testClockPinnedAndDirty (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle pinned[3];
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  int i, wrong;
+  RC rc;
+  testName = "CLOCK with pinned and dirty frames";
+
+  TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_CLOCK, NULL));
+  for (i = 0; i < 3; i++)
+    TEST_CHECK(pinPage(bm, &pinned[i], i));
+  rc = pinPage(bm, h, 9);
+  ASSERT_EQUALS_INT(RC_NO_MORE_SPACE_IN_BUFFER, rc, "every frame pinned");
+  TEST_CHECK(unpinPage(bm, &pinned[1]));
+  TEST_CHECK(pinPage(bm, h, 9));
+  ASSERT_EQUALS_INT(9, *(int *) h->data, "page 9 read");
+  ASSERT_EQUALS_POOL("[0 1],[9 1],[2 1]", bm, "the only unpinned frame taken");
+  ((int *) h->data)[1] = 7;
+  TEST_CHECK(markDirty(bm, h));
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(unpinPage(bm, &pinned[0]));
+  TEST_CHECK(unpinPage(bm, &pinned[2]));
+
+  wrong = pinRange(bm, 20, 29);
+  ASSERT_EQUALS_INT(0, wrong, "pages 20 to 29");
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "dirty page 9 written on eviction");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  TEST_CHECK(readBlock(9, &fh, page));
+  ASSERT_EQUALS_INT(7, ((int *) page)[1], "the change is in the file");
+  ((int *) page)[1] = 0;
+  TEST_CHECK(writeBlock(9, &fh, page));
+  TEST_CHECK(closePageFile(&fh));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// usage counts let a page used often survive misses that take it from CLOCK
+void
+testGClockHotPage (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  ReplacementStrategy strategies[] = { RS_CLOCK, RS_GCLOCK };
+  int limit = 2;
+  int s, i, reads, wrong;
+  testName = "GCLOCK usage counts";
+
+  for (s = 0; s < 2; s++)
+    {
+      TEST_CHECK(initBufferPool(bm, TESTPF, 4, strategies[s], &limit));
+      wrong = 0;
+      for (i = 0; i < 5; i++)
+	wrong += pinRange(bm, 0, 0);
+      wrong += pinRange(bm, 50, 52);
+      wrong += pinRange(bm, 60, 62);
+      reads = getNumReadIO(bm);
+      wrong += pinRange(bm, 0, 0);
+      ASSERT_EQUALS_INT(0, wrong, "pages hold their data");
+      if (strategies[s] == RS_GCLOCK)
+	ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "GCLOCK kept the hot page");
+      else
+	ASSERT_EQUALS_INT(reads + 1, getNumReadIO(bm), "CLOCK evicted it");
+      TEST_CHECK(shutdownBufferPool(bm));
+    }
+
+  // a skewed workload: both read each page correctly
+  for (s = 0; s < 2; s++)
+    {
+      TEST_CHECK(initBufferPool(bm, TESTPF, 20, strategies[s], NULL));
+      srand(3);
+      wrong = 0;
+      for (i = 0; i < 20000; i++)
+	{
+	  int p = rand() % 100;
+	  if (rand() % 2)
+	    p %= 15;
+	  wrong += pinRange(bm, p, p);
+	}
+      ASSERT_EQUALS_INT(0, wrong, "skewed pins");
+      ASSERT_TRUE(getNumReadIO(bm) < 20000, "hits on the hot pages");
+      TEST_CHECK(shutdownBufferPool(bm));
+    }
+
+  free(bm);
+  TEST_DONE();
+}
+
+// the page used least often goes
+void
+testLFUCounts (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle pinned[3];
+  int i, reads, wrong;
+  RC rc;
+  testName = "LFU victims";
+
+  TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LFU, NULL));
+  wrong = 0;
+  for (i = 0; i < 3; i++)
+    wrong += pinRange(bm, 0, 0);
+  for (i = 0; i < 2; i++)
+    wrong += pinRange(bm, 1, 1);
+  wrong += pinRange(bm, 2, 2);
+  wrong += pinRange(bm, 3, 3);
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[3 0]", bm, "page 2 was used once");
+
+  reads = getNumReadIO(bm);
+  wrong += pinRange(bm, 0, 1);
+  ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "pages 0 and 1 resident");
+  wrong += pinRange(bm, 4, 4);
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[4 0]", bm, "page 3 was used once");
+  wrong += pinRange(bm, 3, 3);
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[3 0]", bm, "page 4 was used once too");
+  ASSERT_EQUALS_INT(0, wrong, "pages hold their data");
+
+  // pinned frames are never victims, however rarely used
+  TEST_CHECK(pinPage(bm, &pinned[0], 0));
+  TEST_CHECK(pinPage(bm, &pinned[1], 1));
+  TEST_CHECK(pinPage(bm, &pinned[2], 3));
+  rc = pinPage(bm, h, 7);
+  ASSERT_EQUALS_INT(RC_NO_MORE_SPACE_IN_BUFFER, rc, "every frame pinned");
+  TEST_CHECK(unpinPage(bm, &pinned[0]));
+  TEST_CHECK(pinPage(bm, h, 7));
+  ASSERT_EQUALS_POOL("[7 1],[1 1],[3 1]", bm, "the most used page goes when it is the only one");
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(unpinPage(bm, &pinned[1]));
+  TEST_CHECK(unpinPage(bm, &pinned[2]));
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// counts are halved as time goes by, a page hot long ago does not stay forever
+void
+testLFUAging (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_Ring ring;
+  int i, r, reads, wrong;
+  testName = "LFU aging";
+
+  TEST_CHECK(initBufferPool(bm, TESTPF, 10, RS_LFU, NULL));
+  wrong = 0;
+  for (i = 0; i < 100; i++)
+    wrong += pinRange(bm, 0, 0);
+  // two alternating sets of eight pages, each pin twice
+  for (r = 0; r < 2000; r++)
+    for (i = 1; i <= 8; i++)
+      {
+	wrong += pinRange(bm, 100 + i + (r % 2) * 10, 100 + i + (r % 2) * 10);
+	wrong += pinRange(bm, 100 + i + (r % 2) * 10, 100 + i + (r % 2) * 10);
+      }
+  reads = getNumReadIO(bm);
+  wrong += pinRange(bm, 0, 0);
+  ASSERT_EQUALS_INT(0, wrong, "pages hold their data");
+  ASSERT_EQUALS_INT(reads + 1, getNumReadIO(bm), "the old hot page aged out");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  // and a scan in a ring leaves the hot pages in place under LFU too
+  TEST_CHECK(initBufferPool(bm, TESTPF, 50, RS_LFU, NULL));
+  wrong = pinRange(bm, 0, 29);
+  TEST_CHECK(setReadahead(bm, 16));
+  TEST_CHECK(startRingAccess(bm, &ring, 8));
+  wrong += pinRangeRing(bm, 100, 999, &ring);
+  TEST_CHECK(endRingAccess(bm, &ring));
+  TEST_CHECK(setReadahead(bm, 0));
+  reads = getNumReadIO(bm);
+  wrong += pinRange(bm, 0, 29);
+  ASSERT_EQUALS_INT(0, wrong, "pages hold their data");
+  ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "hot pages kept through the scan");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// with K = 2 the victim is the page whose second last reference is oldest, pages seen once go first
+void
+testLRUKVictims (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle pinned[3];
+  int k = 2;
+  int reads, wrong;
+  RC rc;
+  testName = "LRU-K victims";
+
+  TEST_CHECK(initBufferPool(bm, TESTPF, 3, RS_LRU_K, &k));
+  wrong = pinRange(bm, 0, 1);
+  wrong += pinRange(bm, 0, 1);
+  wrong += pinRange(bm, 2, 3);
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[3 0]", bm, "page 2 seen once, more recent than pages 0 and 1 but gone");
+  reads = getNumReadIO(bm);
+  wrong += pinRange(bm, 0, 1);
+  ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "pages 0 and 1 resident");
+  wrong += pinRange(bm, 2, 2);
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0]", bm, "page 3 seen once, and before page 2 came back");
+
+  // all pinned: no victim, whatever the history says
+  TEST_CHECK(pinPage(bm, &pinned[0], 0));
+  TEST_CHECK(pinPage(bm, &pinned[1], 1));
+  TEST_CHECK(pinPage(bm, &pinned[2], 2));
+  rc = pinPage(bm, h, 9);
+  ASSERT_EQUALS_INT(RC_NO_MORE_SPACE_IN_BUFFER, rc, "every frame pinned");
+  TEST_CHECK(unpinPage(bm, &pinned[0]));
+  TEST_CHECK(pinPage(bm, h, 9));
+  ASSERT_EQUALS_POOL("[9 1],[1 1],[2 1]", bm, "the only unpinned frame taken");
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(unpinPage(bm, &pinned[1]));
+  TEST_CHECK(unpinPage(bm, &pinned[2]));
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  // the history of a page outlives its frame: back after an eviction it has its second reference
+  TEST_CHECK(initBufferPool(bm, TESTPF, 2, RS_LRU_K, &k));
+  wrong += pinRange(bm, 10, 12);
+  wrong += pinRange(bm, 10, 10);
+  wrong += pinRange(bm, 13, 13);
+  reads = getNumReadIO(bm);
+  wrong += pinRange(bm, 10, 10);
+  ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "page 10 kept for its earlier reference");
+  ASSERT_EQUALS_INT(0, wrong, "pages hold their data");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// pages touched once by a scan do not push out pages referenced again and again
+void
+testLRUKScans (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  ReplacementStrategy strategies[] = { RS_LRU, RS_LRU_K };
+  int reads[2];
+  int s, r, i, wrong;
+  testName = "LRU-K and scans";
+
+  // a hot set of 60 pages with a scan of 250 new pages every round, through 100 frames
+  wrong = 0;
+  for (s = 0; s < 2; s++)
+    {
+      TEST_CHECK(initBufferPool(bm, TESTPF, 100, strategies[s], NULL));
+      srand(5);
+      for (r = 0; r < 8; r++)
+	{
+	  for (i = 0; i < 500; i++)
+	    {
+	      int p = rand() % 60;
+	      wrong += pinRange(bm, p, p);
+	    }
+	  wrong += pinRange(bm, 1000 + r * 250, 1000 + r * 250 + 249);
+	}
+      reads[s] = getNumReadIO(bm);
+      TEST_CHECK(shutdownBufferPool(bm));
+    }
+  ASSERT_EQUALS_INT(0, wrong, "pages hold their data");
+  ASSERT_TRUE(reads[1] < reads[0], "LRU-K reads less than LRU");
+
+  // a pool of thousands of frames keeps the history of every page
+  TEST_CHECK(initBufferPool(bm, TESTPF, 2500, RS_LRU_K, NULL));
+  wrong = pinRange(bm, 0, NUM_PAGES - 1);
+  for (i = 0; i < 20000; i++)
+    {
+      int p = rand() % NUM_PAGES;
+      wrong += pinRange(bm, p, p);
+    }
+  ASSERT_EQUALS_INT(0, wrong, "pages of a large pool hold their data");
+
+  // a change made in the large pool is written on shutdown
+  TEST_CHECK(pinPage(bm, h, 5));
+  ((int *) h->data)[2] = 9;
+  TEST_CHECK(markDirty(bm, h));
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  TEST_CHECK(readBlock(5, &fh, page));
+  ASSERT_EQUALS_INT(9, ((int *) page)[2], "the change is in the file");
+  TEST_CHECK(closePageFile(&fh));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// pages seen twice move to the frequent list, a scan only churns the recent one
+void
+testARCVictims (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle pinned[4];
+  int reads, wrong;
+  RC rc;
+  testName = "ARC victims";
+
+  TEST_CHECK(initBufferPool(bm, TESTPF, 4, RS_ARC, NULL));
+  wrong = pinRange(bm, 0, 1);
+  wrong += pinRange(bm, 0, 1);
+  wrong += pinRange(bm, 2, 3);
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[3 0]", bm, "pages 0 and 1 frequent, 2 and 3 recent");
+
+  wrong += pinRange(bm, 10, 19);
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[18 0],[19 0]", bm, "the scan took the recent frames only");
+  ASSERT_EQUALS_INT(14, getNumReadIO(bm), "one read per page loaded");
+  reads = getNumReadIO(bm);
+  wrong += pinRange(bm, 0, 1);
+  ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "pages 0 and 1 resident");
+
+  // page 17 was evicted from the recent list not long ago: a hit on its ghost makes
+  // the recent list's target larger, so the next misses take the frequent list's oldest page
+  wrong += pinRange(bm, 17, 17);
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[17 0],[19 0]", bm, "page 17 read again in place of 18");
+  wrong += pinRange(bm, 30, 31);
+  ASSERT_EQUALS_POOL("[30 0],[1 0],[17 0],[31 0]", bm, "page 0 went before the recent page 19");
+  ASSERT_EQUALS_INT(17, getNumReadIO(bm), "three more reads");
+  ASSERT_EQUALS_INT(0, wrong, "pages hold their data");
+
+  // pinned frames are never victims
+  TEST_CHECK(pinPage(bm, &pinned[0], 30));
+  TEST_CHECK(pinPage(bm, &pinned[1], 1));
+  TEST_CHECK(pinPage(bm, &pinned[2], 17));
+  TEST_CHECK(pinPage(bm, &pinned[3], 31));
+  rc = pinPage(bm, h, 40);
+  ASSERT_EQUALS_INT(RC_NO_MORE_SPACE_IN_BUFFER, rc, "every frame pinned");
+  TEST_CHECK(unpinPage(bm, &pinned[2]));
+  TEST_CHECK(pinPage(bm, h, 40));
+  ASSERT_EQUALS_POOL("[30 1],[1 1],[40 1],[31 1]", bm, "the only unpinned frame taken");
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(unpinPage(bm, &pinned[0]));
+  TEST_CHECK(unpinPage(bm, &pinned[1]));
+  TEST_CHECK(unpinPage(bm, &pinned[3]));
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// ARC against LRU on a hot set mixed with scans, and a long run with pins held and dirty pages
+void
+testARCWorkloads (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle h[2];
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  ReplacementStrategy strategies[] = { RS_LRU, RS_ARC };
+  int reads[2];
+  int s, r, i, p, wrong;
+  testName = "ARC workloads";
+
+  wrong = 0;
+  for (s = 0; s < 2; s++)
+    {
+      TEST_CHECK(initBufferPool(bm, TESTPF, 100, strategies[s], NULL));
+      srand(5);
+      for (r = 0; r < 8; r++)
+	{
+	  for (i = 0; i < 500; i++)
+	    {
+	      p = rand() % 60;
+	      wrong += pinRange(bm, p, p);
+	    }
+	  wrong += pinRange(bm, 1000 + r * 250, 1000 + r * 250 + 249);
+	}
+      reads[s] = getNumReadIO(bm);
+      TEST_CHECK(shutdownBufferPool(bm));
+    }
+  ASSERT_EQUALS_INT(0, wrong, "pages hold their data");
+  ASSERT_TRUE(reads[1] < reads[0], "ARC reads less than LRU");
+
+  // every fifth pin changes its page, every seventh holds a second page meanwhile
+  TEST_CHECK(initBufferPool(bm, TESTPF, 50, RS_ARC, NULL));
+  srand(9);
+  for (i = 0; i < 100000; i++)
+    {
+      p = (rand() % 3) ? rand() % 80 : rand() % NUM_PAGES;
+      TEST_CHECK(pinPage(bm, &h[0], p));
+      if (*(int *) h[0].data != p)
+	wrong++;
+      if (i % 7 == 0)
+	TEST_CHECK(pinPage(bm, &h[1], (p + 1) % NUM_PAGES));
+      if (i % 5 == 0)
+	{
+	  ((int *) h[0].data)[1]++;
+	  TEST_CHECK(markDirty(bm, &h[0]));
+	}
+      TEST_CHECK(unpinPage(bm, &h[0]));
+      if (i % 7 == 0)
+	TEST_CHECK(unpinPage(bm, &h[1]));
+    }
+  ASSERT_EQUALS_INT(0, wrong, "pages hold their data");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  // each change counted once in the page: the dirty victims were all written
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  srand(9);
+  r = 0;
+  for (i = 0; i < 100000; i++)
+    {
+      p = (rand() % 3) ? rand() % 80 : rand() % NUM_PAGES;
+      if (p == 7 && i % 5 == 0)
+	r++;
+    }
+  TEST_CHECK(readBlock(7, &fh, page));
+  ASSERT_EQUALS_INT(r, ((int *) page)[1], "every change to page 7 reached the file");
+  TEST_CHECK(closePageFile(&fh));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// pins on a hot set of 60% of the frames, each round followed by a scan of three times the frames,
+// returns how many pinned pages held the wrong data
+int
+hotSetAndScans (BM_BufferPool *bm, int frames, int rounds)
+{
+  int r, i, p, wrong = 0;
+
+  srand(5);
+  for (r = 0; r < rounds; r++)
+    {
+      for (i = 0; i < frames * 5; i++)
+	{
+	  p = rand() % (frames * 6 / 10);
+	  wrong += pinRange(bm, p, p);
+	}
+      for (i = 0; i < frames * 3; i++)
+	{
+	  p = frames + (r * frames * 3 + i) % (NUM_PAGES - frames);
+	  wrong += pinRange(bm, p, p);
+	}
+    }
+  return wrong;
+}
+
+// the shadow pools see the scans hurt LRU and the pool moves to a strategy that keeps the hot set
+void
+testAdaptiveSwitch (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_Ring ring;
+  int wrong, lruReads, adaptiveReads, i, j, n, same, most;
+  ReplacementStrategy active;
+  testName = "Adaptive strategy switch";
+
+  TEST_CHECK(initBufferPool(bm, TESTPF, 1024, RS_LRU, NULL));
+  wrong = hotSetAndScans(bm, 1024, 20);
+  lruReads = getNumReadIO(bm);
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(initBufferPool(bm, TESTPF, 1024, RS_ADAPTIVE, NULL));
+  ASSERT_EQUALS_INT(RS_LRU, getActiveStrategy(bm), "starts out as LRU");
+  ASSERT_EQUALS_INT(0, getNumStrategySwitches(bm), "no switch yet");
+  // a scan holding its ring meanwhile does not stop the sampling of everyone else's pins
+  TEST_CHECK(startRingAccess(bm, &ring, 16));
+  wrong += hotSetAndScans(bm, 1024, 20);
+  TEST_CHECK(endRingAccess(bm, &ring));
+  adaptiveReads = getNumReadIO(bm);
+  active = getActiveStrategy(bm);
+  ASSERT_EQUALS_INT(0, wrong, "pages hold their data");
+  ASSERT_TRUE(getNumStrategySwitches(bm) > 0, "switched at least once");
+  ASSERT_TRUE(active != RS_LRU, "away from LRU");
+  ASSERT_EQUALS_INT(8, getNumPartitions(bm), "each of 8 partitions picks its own");
+  for (i = 0, same = 0; i < 8; i++)
+    same += getPartitionStrategy(bm, i) == active;
+  for (i = 0, most = 0; i < 8; i++)
+    {
+      for (j = 0, n = 0; j < 8; j++)
+	n += getPartitionStrategy(bm, j) == getPartitionStrategy(bm, i);
+      most = (n > most) ? n : most;
+    }
+  ASSERT_EQUALS_INT(most, same, "the pool reports what most partitions run");
+  ASSERT_TRUE(getSimulatedHitRatio(bm, active) > getSimulatedHitRatio(bm, RS_LRU), "to a strategy its shadow saw more hits for");
+  ASSERT_TRUE(getSimulatedHitRatio(bm, RS_FIFO) < 0, "FIFO has no shadow pool");
+  ASSERT_TRUE(adaptiveReads < lruReads, "fewer reads than a plain LRU pool");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// a loop over more pages than frames misses under every candidate alike, nothing to switch to
+void
+testAdaptiveLoop (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  int r, wrong;
+  testName = "Adaptive strategy without a better candidate";
+
+  TEST_CHECK(initBufferPool(bm, TESTPF, 1024, RS_ADAPTIVE, NULL));
+  wrong = 0;
+  for (r = 0; r < 30; r++)
+    wrong += pinRange(bm, 0, 1024 * 12 / 10 - 1);
+  ASSERT_EQUALS_INT(0, wrong, "pages hold their data");
+  ASSERT_EQUALS_INT(0, getNumStrategySwitches(bm), "no switch");
+  ASSERT_EQUALS_INT(RS_LRU, getActiveStrategy(bm), "still LRU");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+  TEST_DONE();
+}
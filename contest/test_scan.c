@@ -0,0 +1,261 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "test_helper.h"
+#include "test_pool_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// var to store the current test's name
+char *testName;
+
+#define TESTPF "test_scan.bin"
+#define NUM_PAGES 2100
+
+// test and helper methods
+
+static void testSequentialReadahead (void);
+static void testRandomAccess (void);
+static void testExplicitPrefetch (void);
+static void testReadaheadOff (void);
+static void testRing (ReplacementStrategy strategy, int readahead);
+static void testNoRing (void);
+static void testRingPartitions (void);
+
+// main method
+int
+main (void)
+{
+  initStorageManager();
+  testName = "";
+
+  createPages(TESTPF, NUM_PAGES);
+  testSequentialReadahead();
+  testRandomAccess();
+  testExplicitPrefetch();
+  testReadaheadOff();
+  testRing(RS_FIFO, 0);
+  testRing(RS_LRU, 0);
+  testRing(RS_LRU, 16);
+  testRing(RS_CLOCK, 0);
+  testRing(RS_CLOCK, 16);
+  testNoRing();
+  testRingPartitions();
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  return 0;
+}
+
+// a sequential scan is detected and read ahead, every page it prefetched gets used
+void
+testSequentialReadahead (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  int wrong;
+  testName = "Readahead of a sequential scan";
+
+  TEST_CHECK(initBufferPool(bm, TESTPF, 50, RS_LRU, NULL));
+  TEST_CHECK(setReadahead(bm, 16));
+  wrong = pinRange(bm, 0, 999);
+  ASSERT_EQUALS_INT(0, wrong, "pages read ahead hold their data");
+  ASSERT_TRUE(getNumReadIO(bm) >= 1000 && getNumReadIO(bm) <= 1000 + 16, "every page read once, at most a window past the scan");
+  ASSERT_TRUE(getNumPrefetched(bm) >= 990, "all but the first few pages read ahead");
+  ASSERT_EQUALS_INT(0, getNumPrefetchUnused(bm), "no page read ahead in vain");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// random pins are no scan, readahead stays out of the way
+void
+testRandomAccess (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  int i, wrong;
+  testName = "No readahead for random access";
+
+  TEST_CHECK(initBufferPool(bm, TESTPF, 50, RS_LRU, NULL));
+  TEST_CHECK(setReadahead(bm, 16));
+  srand(1);
+  wrong = 0;
+  for (i = 0; i < 2000; i++)
+    {
+      int p = rand() % 1000;
+      wrong += pinRange(bm, p, p);
+    }
+  ASSERT_EQUALS_INT(0, wrong, "random pages hold their data");
+  ASSERT_TRUE(getNumPrefetched(bm) < 100, "next to nothing read ahead");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// prefetchPages counts what it read, and what left the pool without being pinned
+void
+testExplicitPrefetch (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  int wrong;
+  testName = "Explicit prefetch";
+
+  TEST_CHECK(initBufferPool(bm, TESTPF, 50, RS_FIFO, NULL));
+  TEST_CHECK(prefetchPages(bm, 100, 20));
+  ASSERT_EQUALS_INT(20, getNumPrefetched(bm), "20 pages prefetched");
+  wrong = pinRange(bm, 100, 104);
+  ASSERT_EQUALS_INT(0, wrong, "prefetched pages hold their data");
+  ASSERT_EQUALS_INT(20, getNumReadIO(bm), "prefetched pages are hits");
+  wrong = pinRange(bm, 500, 559);
+  ASSERT_EQUALS_INT(0, wrong, "pages 500 to 559");
+  ASSERT_EQUALS_INT(15, getNumPrefetchUnused(bm), "15 prefetched pages evicted unused");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// readahead is off unless asked for
+void
+testReadaheadOff (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  int wrong;
+  testName = "Readahead off by default";
+
+  TEST_CHECK(initBufferPool(bm, TESTPF, 50, RS_FIFO, NULL));
+  wrong = pinRange(bm, 0, 99);
+  ASSERT_EQUALS_INT(0, wrong, "pages 0 to 99");
+  ASSERT_EQUALS_INT(0, getNumPrefetched(bm), "nothing read ahead");
+  ASSERT_EQUALS_INT(100, getNumReadIO(bm), "one read per page");
+  TEST_CHECK(setReadahead(bm, 16));
+  TEST_CHECK(setReadahead(bm, 0));
+  wrong = pinRange(bm, 100, 199);
+  ASSERT_EQUALS_INT(0, wrong, "pages 100 to 199");
+  ASSERT_EQUALS_INT(0, getNumPrefetched(bm), "switched off again");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// scans inside rings recycle their own frames, the hot pages stay in the pool
+void
+testRing (ReplacementStrategy strategy, int readahead)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_Ring ring, other;
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  int i, reads, wrong;
+  RC rc;
+  testName = "Scan through a ring of frames";
+
+  TEST_CHECK(initBufferPool(bm, TESTPF, 50, strategy, NULL));
+  wrong = pinRange(bm, 0, 29);
+  ASSERT_EQUALS_INT(0, wrong, "30 hot pages");
+  TEST_CHECK(setReadahead(bm, readahead));
+
+  // two scans at once, each in a ring of its own
+  TEST_CHECK(startRingAccess(bm, &ring, 8));
+  TEST_CHECK(startRingAccess(bm, &other, 8));
+  wrong = 0;
+  for (i = 100; i < 1000; i++)
+    {
+      TEST_CHECK(pinPageRing(bm, h, i, &ring));
+      if (*(int *) h->data != i)
+	wrong++;
+      if (i % 7 == 0)
+	{
+	  h->data[sizeof(int)] = 1;
+	  TEST_CHECK(markDirty(bm, h));
+	}
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  wrong += pinRangeRing(bm, 1000, 1899, &other);
+  ASSERT_EQUALS_INT(0, wrong, "900 pages scanned by each");
+  TEST_CHECK(endRingAccess(bm, &ring));
+  TEST_CHECK(endRingAccess(bm, &other));
+  rc = endRingAccess(bm, &ring);
+  ASSERT_ERROR(rc, "the ring is ended already");
+  TEST_CHECK(setReadahead(bm, 0));
+
+  reads = getNumReadIO(bm);
+  wrong = pinRange(bm, 0, 29);
+  ASSERT_EQUALS_INT(0, wrong, "hot pages after the scan");
+  ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "the scan did not evict them");
+
+  // the frames the rings used are the first to go after they ended
+  wrong = pinRange(bm, 2000, 2015);
+  reads = getNumReadIO(bm);
+  wrong += pinRange(bm, 0, 29);
+  ASSERT_EQUALS_INT(0, wrong, "hot pages after 16 more misses");
+  ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "the misses took ring frames");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  // pages changed inside the ring reach the file
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  TEST_CHECK(readBlock(700, &fh, page));
+  ASSERT_EQUALS_INT(1, page[sizeof(int)], "page 700 changed in the ring");
+  TEST_CHECK(readBlock(701, &fh, page));
+  ASSERT_EQUALS_INT(0, page[sizeof(int)], "page 701 untouched");
+  TEST_CHECK(closePageFile(&fh));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// a ring has its size in every partition: readahead through it reads whole windows, however
+// many partitions the scan's pages are spread over
+void
+testRingPartitions (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_Ring ring;
+  int reads, wrong;
+  testName = "Ring over a partitioned pool";
+
+  TEST_CHECK(initBufferPool(bm, TESTPF, 1024, RS_LRU, NULL));
+  ASSERT_EQUALS_INT(8, getNumPartitions(bm), "8 partitions");
+  wrong = pinRange(bm, 0, 99);
+  TEST_CHECK(setReadahead(bm, 16));
+  TEST_CHECK(startRingAccess(bm, &ring, 16));
+  wrong += pinRangeRing(bm, 100, 2099, &ring);
+  TEST_CHECK(endRingAccess(bm, &ring));
+  ASSERT_TRUE(getNumPrefetched(bm) >= 1900, "nearly every page read ahead");
+  ASSERT_TRUE(getNumPrefetchUnused(bm) == 0, "none recycled before the scan got to it");
+  TEST_CHECK(setReadahead(bm, 0));
+
+  reads = getNumReadIO(bm);
+  wrong += pinRange(bm, 0, 99);
+  ASSERT_EQUALS_INT(0, wrong, "pages hold their data");
+  ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "hot pages kept through the scan");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// the same scan without a ring flushes the hot pages out of an LRU pool
+void
+testNoRing (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  int reads, wrong;
+  testName = "Scan without a ring";
+
+  TEST_CHECK(initBufferPool(bm, TESTPF, 50, RS_LRU, NULL));
+  wrong = pinRange(bm, 0, 29);
+  wrong += pinRange(bm, 100, 999);
+  reads = getNumReadIO(bm);
+  wrong += pinRange(bm, 0, 29);
+  ASSERT_EQUALS_INT(0, wrong, "pages hold their data");
+  ASSERT_EQUALS_INT(reads + 30, getNumReadIO(bm), "every hot page read again");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+  TEST_DONE();
+}
@@ -0,0 +1,151 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// var to store the current test's name
+char *testName;
+
+// built with -DSM_SEGMENT_SIZE=65536, so a segment holds 16 pages and a few hundred pages span many files
+#define TESTPF "test_segments.bin"
+#define SEG_PAGES (SM_SEGMENT_SIZE / PAGE_SIZE)
+
+static const SM_IOMode modes[] = { SM_IO_BUFFERED, SM_IO_MAPPED, SM_IO_DIRECT };
+static const char *modeNames[] = { "buffered", "mapped", "direct" };
+
+// test and helper methods
+static int segmentExists (int seg);
+
+static void testSpanSegments (SM_IOMode mode, const char *name);
+static void testPoolOverSegments (SM_IOMode mode, const char *name);
+
+// main method
+int
+main (void)
+{
+  int m;
+
+  initStorageManager();
+  testName = "";
+
+  for (m = 0; m < 3; m++)
+    {
+      testSpanSegments(modes[m], modeNames[m]);
+      testPoolOverSegments(modes[m], modeNames[m]);
+    }
+
+  return 0;
+}
+
+// segment 0 is the page file itself, segment i is "<fileName>.i"
+int
+segmentExists (int seg)
+{
+  char name[64];
+
+  if (seg == 0)
+    return access(TESTPF, F_OK) == 0;
+  sprintf(name, "%s.%d", TESTPF, seg);
+  return access(name, F_OK) == 0;
+}
+
+// runs of pages cross segment boundaries, in both directions
+void
+testSpanSegments (SM_IOMode mode, const char *name)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ptr;
+  char *big;
+  int i, good;
+  testName = "Pages spread over segment files";
+
+  ASSERT_EQUALS_INT(16, SEG_PAGES, "16 pages per segment");
+  ASSERT_TRUE(posix_memalign((void **) &big, PAGE_SIZE, 100 * PAGE_SIZE) == 0, "page buffers");
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(openPageFileMode(TESTPF, &fh, mode));
+  TEST_CHECK(setExtentPolicy(&fh, 5, SM_EXTENT_FALLOCATE));
+  for (i = 0; i < 100; i++)
+    memset(big + i * PAGE_SIZE, i, PAGE_SIZE);
+  TEST_CHECK(writeBlocks(0, 100, &fh, big));
+  ASSERT_EQUALS_INT(100, fh.totalNumPages, name);
+  ASSERT_TRUE(segmentExists(6), "page 99 is in segment 6");
+  ASSERT_TRUE(!segmentExists(7), "no segment past the last page");
+
+  memset(big, 0, 100 * PAGE_SIZE);
+  TEST_CHECK(readBlocks(3, 90, &fh, big));
+  good = 0;
+  for (i = 0; i < 90; i++)
+    good += big[i * PAGE_SIZE + 1] == (char) (i + 3) && big[i * PAGE_SIZE + PAGE_SIZE - 1] == (char) (i + 3);
+  ASSERT_EQUALS_INT(90, good, "one run read from seven segments");
+
+  if (mode == SM_IO_MAPPED)
+    {
+      TEST_CHECK(getBlockPointer(33, &fh, &ptr));
+      ASSERT_EQUALS_INT(33, ptr[0], "pointer into the mapping of segment 2");
+    }
+
+  TEST_CHECK(ensureCapacity(150, &fh));
+  TEST_CHECK(readBlock(149, &fh, big));
+  ASSERT_EQUALS_INT(0, big[0], "new pages in new segments are empty");
+  TEST_CHECK(closePageFile(&fh));
+
+  TEST_CHECK(openPageFileMode(TESTPF, &fh, mode));
+  ASSERT_EQUALS_INT(150, fh.totalNumPages, "page count over all segments after reopening");
+  TEST_CHECK(readBlock(99, &fh, big));
+  ASSERT_EQUALS_INT(99, big[0], "page 99 after reopening");
+  TEST_CHECK(closePageFile(&fh));
+
+  TEST_CHECK(destroyPageFile(TESTPF));
+  ASSERT_TRUE(!segmentExists(0) && !segmentExists(1) && !segmentExists(9), "every segment removed");
+
+  free(big);
+  TEST_DONE();
+}
+
+// the buffer pool reads and writes pages wherever their segment is
+void
+testPoolOverSegments (SM_IOMode mode, const char *name)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  int i, good;
+  testName = "Buffer pool over segment files";
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(initBufferPoolMode(bm, TESTPF, 4, RS_LRU, NULL, mode));
+  for (i = 0; i < 200; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      memset(h->data, i, PAGE_SIZE);
+      TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_INT(1, getNumReadIO(bm), "only page 0 was in the file");
+  ASSERT_EQUALS_INT(196, getNumWriteIO(bm), "dirty victims written back");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  ASSERT_EQUALS_INT(200, fh.totalNumPages, name);
+  ASSERT_TRUE(segmentExists(12), "page 199 is in segment 12");
+  good = 0;
+  for (i = 0; i < 200; i++)
+    {
+      TEST_CHECK(readBlock(i, &fh, page));
+      good += page[0] == (char) i && page[PAGE_SIZE - 1] == (char) i;
+    }
+  ASSERT_EQUALS_INT(200, good, "every page in its segment");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(TESTPF));
+  ASSERT_TRUE(!segmentExists(12), "segments removed");
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
@@ -0,0 +1,299 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "record_mgr.h"
+#include "expr.h"
+#include "tables.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// var to store the current test's name
+char *testName;
+
+#define NUM_TABLES 12
+#define NUM_ROWS 300
+
+// test and helper methods
+static Schema *twoInts (void);
+static void tableName (char *name, int t);
+
+static void testTablesSideBySide (void);
+static void testPoolsSideBySide (void);
+static void testDeletedSlotsReused (void);
+
+// main method
+int
+main (void)
+{
+  initStorageManager();
+  testName = "";
+
+  testTablesSideBySide();
+  testPoolsSideBySide();
+  testDeletedSlotsReused();
+
+  return 0;
+}
+
+// schema (a int, b int), keyed on a
+Schema *
+twoInts (void)
+{
+  char **names = (char **) malloc(sizeof(char *) * 2);
+  DataType *dt = (DataType *) malloc(sizeof(DataType) * 2);
+  int *sizes = (int *) calloc(2, sizeof(int));
+  int *keys = (int *) calloc(1, sizeof(int));
+
+  names[0] = strdup("a");
+  names[1] = strdup("b");
+  dt[0] = DT_INT;
+  dt[1] = DT_INT;
+  return createSchema(2, names, dt, sizes, 1, keys);
+}
+
+void
+tableName (char *name, int t)
+{
+  sprintf(name, "test_tables_%i.bin", t);
+}
+
+// tables open at once each keep their own rows, inserts into one never land in another
+void
+testTablesSideBySide (void)
+{
+  RM_TableData tables[NUM_TABLES];
+  RID rids[NUM_TABLES][NUM_ROWS];
+  Schema *schema = twoInts();
+  Record *r;
+  Value *v;
+  char name[64];
+  int t, i, n, wrong;
+  testName = "Tables open side by side";
+
+  TEST_CHECK(initRecordManager(NULL));
+  for (t = 0; t < NUM_TABLES; t++)
+    {
+      tableName(name, t);
+      TEST_CHECK(createTable(name, schema));
+      TEST_CHECK(openTable(&tables[t], name));
+    }
+
+  // row i of table t is (i, t), inserted round robin over the tables
+  TEST_CHECK(createRecord(&r, schema));
+  for (i = 0; i < NUM_ROWS; i++)
+    for (t = 0; t < NUM_TABLES; t++)
+      {
+	MAKE_VALUE(v, DT_INT, i);
+	TEST_CHECK(setAttr(r, schema, 0, v));
+	freeVal(v);
+	MAKE_VALUE(v, DT_INT, t);
+	TEST_CHECK(setAttr(r, schema, 1, v));
+	freeVal(v);
+	TEST_CHECK(insertRecord(&tables[t], r));
+	rids[t][i] = r->id;
+      }
+
+  // closing every other table leaves the rest alone
+  for (t = 0; t < NUM_TABLES; t += 2)
+    TEST_CHECK(closeTable(&tables[t]));
+  for (t = 0; t < NUM_TABLES; t += 2)
+    {
+      tableName(name, t);
+      TEST_CHECK(openTable(&tables[t], name));
+    }
+
+  wrong = 0;
+  for (t = 0; t < NUM_TABLES; t++)
+    {
+      n = getNumTuples(&tables[t]);
+      if (n != NUM_ROWS)
+	wrong++;
+      for (i = 0; i < NUM_ROWS; i++)
+	{
+	  TEST_CHECK(getRecord(&tables[t], rids[t][i], r));
+	  TEST_CHECK(getAttr(r, schema, 0, &v));
+	  if (v->v.intV != i)
+	    wrong++;
+	  freeVal(v);
+	  TEST_CHECK(getAttr(r, schema, 1, &v));
+	  if (v->v.intV != t)
+	    wrong++;
+	  freeVal(v);
+	}
+    }
+  ASSERT_EQUALS_INT(0, wrong, "every table holds its own rows");
+
+  for (t = 0; t < NUM_TABLES; t++)
+    {
+      TEST_CHECK(closeTable(&tables[t]));
+      tableName(name, t);
+      TEST_CHECK(deleteTable(name));
+    }
+  TEST_CHECK(shutdownRecordManager());
+
+  freeRecord(r);
+  freeSchema(schema);
+  TEST_DONE();
+}
+
+// two pools over two files, pinned in turn: each counts and evicts only its own pages
+void
+testPoolsSideBySide (void)
+{
+  BM_BufferPool *bm1 = MAKE_POOL();
+  BM_BufferPool *bm2 = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  int i;
+  testName = "Buffer pools side by side";
+
+  TEST_CHECK(createPageFile("test_tables_1.bin"));
+  TEST_CHECK(createPageFile("test_tables_2.bin"));
+  TEST_CHECK(initBufferPool(bm1, "test_tables_1.bin", 4, RS_FIFO, NULL));
+  TEST_CHECK(initBufferPool(bm2, "test_tables_2.bin", 8, RS_LRU, NULL));
+
+  // pool 1 goes through 20 pages, pool 2 stays within its 8 frames
+  for (i = 0; i < 20; i++)
+    {
+      TEST_CHECK(pinPage(bm1, h, i));
+      h->data[0] = 1;
+      TEST_CHECK(markDirty(bm1, h));
+      TEST_CHECK(unpinPage(bm1, h));
+
+      TEST_CHECK(pinPage(bm2, h, i % 8));
+      h->data[0] = 2;
+      TEST_CHECK(markDirty(bm2, h));
+      TEST_CHECK(unpinPage(bm2, h));
+    }
+  ASSERT_EQUALS_INT(16, getNumWriteIO(bm1), "pool 1 wrote its victims");
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm2), "pool 2 evicted nothing");
+  ASSERT_EQUALS_INT(1, getNumReadIO(bm2), "only page 0 was in file 2");
+  TEST_CHECK(shutdownBufferPool(bm1));
+
+  // pool 2 still works after pool 1 is gone
+  TEST_CHECK(pinPage(bm2, h, 3));
+  ASSERT_EQUALS_INT(2, h->data[0], "pool 2 keeps its page");
+  TEST_CHECK(unpinPage(bm2, h));
+  TEST_CHECK(shutdownBufferPool(bm2));
+
+  TEST_CHECK(openPageFile("test_tables_1.bin", &fh));
+  ASSERT_EQUALS_INT(20, fh.totalNumPages, "file 1 has pool 1's pages");
+  TEST_CHECK(readBlock(7, &fh, page));
+  ASSERT_EQUALS_INT(1, page[0], "written by pool 1");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(openPageFile("test_tables_2.bin", &fh));
+  ASSERT_EQUALS_INT(8, fh.totalNumPages, "file 2 has pool 2's pages");
+  TEST_CHECK(readBlock(7, &fh, page));
+  ASSERT_EQUALS_INT(2, page[0], "written by pool 2");
+  TEST_CHECK(closePageFile(&fh));
+
+  TEST_CHECK(destroyPageFile("test_tables_1.bin"));
+  TEST_CHECK(destroyPageFile("test_tables_2.bin"));
+
+  free(bm1);
+  free(bm2);
+  free(h);
+  TEST_DONE();
+}
+
+// rows inserted after deletes in the middle of a table take the deleted slots, the rows left
+// are never overwritten and scans skip the holes
+void
+testDeletedSlotsReused (void)
+{
+  RM_TableData table;
+  RM_ScanHandle sc;
+  RID rids[NUM_ROWS];
+  Schema *schema = twoInts();
+  Record *r;
+  Value *v;
+  Expr *sel;
+  char name[64];
+  int i, j, reused, wrong, seen;
+  testName = "Deleted slots reused by later inserts";
+
+  TEST_CHECK(initRecordManager(NULL));
+  tableName(name, 0);
+  TEST_CHECK(createTable(name, schema));
+  TEST_CHECK(openTable(&table, name));
+
+  // row i is (i, 0)
+  TEST_CHECK(createRecord(&r, schema));
+  for (i = 0; i < NUM_ROWS; i++)
+    {
+      MAKE_VALUE(v, DT_INT, i);
+      TEST_CHECK(setAttr(r, schema, 0, v));
+      freeVal(v);
+      MAKE_VALUE(v, DT_INT, 0);
+      TEST_CHECK(setAttr(r, schema, 1, v));
+      freeVal(v);
+      TEST_CHECK(insertRecord(&table, r));
+      rids[i] = r->id;
+    }
+
+  // every third row goes, the last row stays so all of them are holes
+  for (i = 0; i < NUM_ROWS - 1; i += 3)
+    TEST_CHECK(deleteRecord(&table, rids[i]));
+  ASSERT_TRUE(getRecord(&table, rids[0], r) == RC_RM_RECORD_DELETED, "a deleted row is gone");
+
+  // the rows inserted now are (i, 1) and each must land in one of the holes
+  reused = 0;
+  for (i = 0; i < NUM_ROWS - 1; i += 3)
+    {
+      MAKE_VALUE(v, DT_INT, i);
+      TEST_CHECK(setAttr(r, schema, 0, v));
+      freeVal(v);
+      MAKE_VALUE(v, DT_INT, 1);
+      TEST_CHECK(setAttr(r, schema, 1, v));
+      freeVal(v);
+      TEST_CHECK(insertRecord(&table, r));
+      for (j = 0; j < NUM_ROWS - 1; j += 3)
+	if (r->id.page == rids[j].page && r->id.slot == rids[j].slot)
+	  reused++;
+    }
+  ASSERT_EQUALS_INT((NUM_ROWS + 1) / 3, reused, "every insert took a deleted slot");
+  ASSERT_EQUALS_INT(NUM_ROWS, getNumTuples(&table), "tuple count");
+
+  wrong = 0;
+  for (i = 0; i < NUM_ROWS; i++)
+    {
+      if (i % 3 == 0 && i < NUM_ROWS - 1)
+	continue;
+      TEST_CHECK(getRecord(&table, rids[i], r));
+      TEST_CHECK(getAttr(r, schema, 0, &v));
+      if (v->v.intV != i)
+	wrong++;
+      freeVal(v);
+      TEST_CHECK(getAttr(r, schema, 1, &v));
+      if (v->v.intV != 0)
+	wrong++;
+      freeVal(v);
+    }
+  ASSERT_EQUALS_INT(0, wrong, "the rows left were not overwritten");
+
+  // a scan after deletes at the end and in the middle sees exactly the rows left
+  for (i = NUM_ROWS - 10; i < NUM_ROWS; i++)
+    if (i % 3 != 0 || i == NUM_ROWS - 1)
+      TEST_CHECK(deleteRecord(&table, rids[i]));
+  TEST_CHECK(deleteRecord(&table, rids[1]));
+  MAKE_VALUE(v, DT_BOOL, TRUE);
+  MAKE_CONS(sel, v);
+  TEST_CHECK(startScan(&table, &sc, sel));
+  seen = 0;
+  while (next(&sc, r) == RC_OK)
+    seen++;
+  TEST_CHECK(closeScan(&sc));
+  ASSERT_EQUALS_INT(getNumTuples(&table), seen, "the scan skips deleted slots");
+  freeExpr(sel);
+
+  TEST_CHECK(closeTable(&table));
+  TEST_CHECK(deleteTable(name));
+  TEST_CHECK(shutdownRecordManager());
+
+  freeRecord(r);
+  freeSchema(schema);
+  TEST_DONE();
+}
@@ -0,0 +1,144 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// var to store the current test's name
+char *testName;
+
+#define TESTPF "test_vectored_io.bin"
+#define NUM_PAGES 200
+
+static const SM_IOMode modes[] = { SM_IO_BUFFERED, SM_IO_MAPPED, SM_IO_DIRECT };
+static const char *modeNames[] = { "buffered", "mapped", "direct" };
+
+// test and helper methods
+static void testBlocks (SM_IOMode mode, const char *name);
+static void testPrefetch (SM_IOMode mode);
+
+// main method
+int
+main (void)
+{
+  int m;
+
+  initStorageManager();
+  testName = "";
+
+  for (m = 0; m < 3; m++)
+    {
+      testBlocks(modes[m], modeNames[m]);
+      testPrefetch(modes[m]);
+    }
+
+  return 0;
+}
+
+// runs of pages from one contiguous buffer and from a vector of separate ones
+void
+testBlocks (SM_IOMode mode, const char *name)
+{
+  SM_FileHandle fh;
+  SM_PageHandle pv[NUM_PAGES];
+  char *big, *raw[NUM_PAGES];
+  int i, good;
+  testName = "readBlocks/writeBlocks and their vectored forms";
+
+  ASSERT_TRUE(posix_memalign((void **) &big, PAGE_SIZE, NUM_PAGES * PAGE_SIZE) == 0, "contiguous buffer");
+  for (i = 0; i < NUM_PAGES; i++)
+    {
+      // off by one byte, so direct I/O has to bounce these through its arena
+      raw[i] = malloc(PAGE_SIZE + 1);
+      pv[i] = raw[i] + 1;
+    }
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(openPageFileMode(TESTPF, &fh, mode));
+
+  for (i = 0; i < NUM_PAGES; i++)
+    memset(big + i * PAGE_SIZE, i, PAGE_SIZE);
+  TEST_CHECK(writeBlocks(0, NUM_PAGES, &fh, big));
+  ASSERT_EQUALS_INT(NUM_PAGES, fh.totalNumPages, name);
+
+  TEST_CHECK(readBlocksv(0, NUM_PAGES, &fh, pv));
+  good = 0;
+  for (i = 0; i < NUM_PAGES; i++)
+    good += pv[i][0] == (char) i && pv[i][PAGE_SIZE - 1] == (char) i;
+  ASSERT_EQUALS_INT(NUM_PAGES, good, "every page in its own buffer");
+
+  // the vectored write runs 50 pages past the end of the file
+  for (i = 0; i < NUM_PAGES; i++)
+    memset(pv[i], 255 - i, PAGE_SIZE);
+  TEST_CHECK(writeBlocksv(150, 100, &fh, pv));
+  ASSERT_EQUALS_INT(250, fh.totalNumPages, "a write past the end grows the file");
+
+  memset(big, 0, NUM_PAGES * PAGE_SIZE);
+  TEST_CHECK(readBlocks(50, NUM_PAGES, &fh, big));
+  ASSERT_EQUALS_INT((char) 50, big[0], "first page of the run");
+  ASSERT_EQUALS_INT((char) 149, big[99 * PAGE_SIZE], "last page before the vectored write");
+  ASSERT_EQUALS_INT((char) 255, big[100 * PAGE_SIZE + 3], "first page of the vectored write");
+  ASSERT_EQUALS_INT((char) (255 - 99), big[199 * PAGE_SIZE], "last page of the vectored write");
+  ASSERT_ERROR(readBlocks(200, 51, &fh, big), "a run past the end is not read");
+
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  for (i = 0; i < NUM_PAGES; i++)
+    free(raw[i]);
+  free(big);
+  TEST_DONE();
+}
+
+// prefetchPages reads up to half the pool in one go, the pages are hits afterwards
+void
+testPrefetch (SM_IOMode mode)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  int i;
+  testName = "Prefetch and flush through vectored I/O";
+
+  TEST_CHECK(createPageFile(TESTPF));
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  for (i = 0; i < 100; i++)
+    {
+      memset(page, i, PAGE_SIZE);
+      TEST_CHECK(writeBlock(i, &fh, page));
+    }
+  TEST_CHECK(closePageFile(&fh));
+
+  TEST_CHECK(initBufferPoolMode(bm, TESTPF, 20, RS_FIFO, NULL, mode));
+  TEST_CHECK(prefetchPages(bm, 10, 100));
+  ASSERT_EQUALS_INT(10, getNumReadIO(bm), "100 pages asked for, half of 20 frames read");
+  TEST_CHECK(pinPage(bm, h, 12));
+  ASSERT_EQUALS_INT(12, h->data[0], "prefetched page 12");
+  ASSERT_EQUALS_INT(10, getNumReadIO(bm), "a prefetched page is a hit");
+  TEST_CHECK(unpinPage(bm, h));
+
+  for (i = 30; i < 50; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      h->data[0] = 1;
+      TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  TEST_CHECK(forceFlushPool(bm));
+  ASSERT_EQUALS_INT(20, getNumWriteIO(bm), "every dirty frame written once");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(openPageFile(TESTPF, &fh));
+  TEST_CHECK(readBlock(44, &fh, page));
+  ASSERT_EQUALS_INT(1, page[0], "the flushed change is in the file");
+  ASSERT_EQUALS_INT(44, page[1], "the rest of the page is untouched");
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile(TESTPF));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}